@@ -0,0 +1,119 @@
+// Copyright 2017 Brian Smith.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+// SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+// OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+// CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+//! Throughput benchmarks for `aead::seal_in_place` and
+//! `aead::open_in_place`.
+//!
+//! `Bencher::bytes` is set to the plaintext length so `cargo bench` reports
+//! MB/s directly; cycles/byte is the CPU clock rate divided by that figure.
+//! Run with `mk/bench.sh` (requires Nightly Rust).
+
+#![cfg_attr(feature = "internal_benches", allow(unstable_features))]
+#![cfg_attr(feature = "internal_benches", feature(test))]
+#![cfg(feature = "internal_benches")]
+
+extern crate ring;
+extern crate test as bench;
+
+use ring::aead;
+
+fn seal_in_place_bench(b: &mut bench::Bencher,
+                       algorithm: &'static aead::Algorithm, len: usize) {
+    let key_bytes = vec![0u8; algorithm.key_len()];
+    let key = aead::SealingKey::new(algorithm, &key_bytes).unwrap();
+    let nonce = vec![0u8; algorithm.nonce_len()];
+    let mut in_out = vec![0u8; len + algorithm.tag_len()];
+    b.bytes = len as u64;
+    b.iter(|| {
+        aead::seal_in_place(&key, &nonce, &[], &mut in_out,
+                            algorithm.tag_len()).unwrap()
+    });
+}
+
+fn open_in_place_bench(b: &mut bench::Bencher,
+                       algorithm: &'static aead::Algorithm, len: usize) {
+    let key_bytes = vec![0u8; algorithm.key_len()];
+    let sealing_key = aead::SealingKey::new(algorithm, &key_bytes).unwrap();
+    let opening_key = aead::OpeningKey::new(algorithm, &key_bytes).unwrap();
+    let nonce = vec![0u8; algorithm.nonce_len()];
+    let mut ciphertext = vec![0u8; len + algorithm.tag_len()];
+    let _ = aead::seal_in_place(&sealing_key, &nonce, &[], &mut ciphertext,
+                                algorithm.tag_len()).unwrap();
+    let mut in_out = vec![0u8; ciphertext.len()];
+    b.bytes = len as u64;
+    b.iter(|| {
+        // The copy is part of the measured work, but it is cheap relative to
+        // the decryption for all but the smallest payloads.
+        in_out.copy_from_slice(&ciphertext);
+        aead::open_in_place(&opening_key, &nonce, &[], 0, &mut in_out)
+            .unwrap().len()
+    });
+}
+
+macro_rules! aead_benches {
+    ( $alg_mod:ident, $alg:expr ) => {
+        mod $alg_mod {
+            use super::{open_in_place_bench, seal_in_place_bench};
+            use bench;
+
+            // A single block, a small record, a typical-MTU TLS record, and
+            // bulk-transfer sizes up to 1 MB.
+            #[bench]
+            fn seal_16(b: &mut bench::Bencher) {
+                seal_in_place_bench(b, $alg, 16)
+            }
+            #[bench]
+            fn seal_256(b: &mut bench::Bencher) {
+                seal_in_place_bench(b, $alg, 256)
+            }
+            #[bench]
+            fn seal_1350(b: &mut bench::Bencher) {
+                seal_in_place_bench(b, $alg, 1350)
+            }
+            #[bench]
+            fn seal_8192(b: &mut bench::Bencher) {
+                seal_in_place_bench(b, $alg, 8192)
+            }
+            #[bench]
+            fn seal_65536(b: &mut bench::Bencher) {
+                seal_in_place_bench(b, $alg, 65536)
+            }
+            #[bench]
+            fn seal_1048576(b: &mut bench::Bencher) {
+                seal_in_place_bench(b, $alg, 1048576)
+            }
+
+            #[bench]
+            fn open_16(b: &mut bench::Bencher) {
+                open_in_place_bench(b, $alg, 16)
+            }
+            #[bench]
+            fn open_1350(b: &mut bench::Bencher) {
+                open_in_place_bench(b, $alg, 1350)
+            }
+            #[bench]
+            fn open_65536(b: &mut bench::Bencher) {
+                open_in_place_bench(b, $alg, 65536)
+            }
+            #[bench]
+            fn open_1048576(b: &mut bench::Bencher) {
+                open_in_place_bench(b, $alg, 1048576)
+            }
+        }
+    }
+}
+
+aead_benches!(aes_128_gcm, &::ring::aead::AES_128_GCM);
+aead_benches!(aes_256_gcm, &::ring::aead::AES_256_GCM);
+aead_benches!(chacha20_poly1305, &::ring::aead::CHACHA20_POLY1305);
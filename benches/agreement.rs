@@ -0,0 +1,77 @@
+// Copyright 2017 Brian Smith.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+// SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+// OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+// CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+//! Operation-rate benchmarks for ephemeral key agreement.
+//!
+//! ns/iter is the cost of one operation; ops/sec is its reciprocal. Run with
+//! `mk/bench.sh` (requires Nightly Rust).
+
+#![cfg_attr(feature = "internal_benches", allow(unstable_features))]
+#![cfg_attr(feature = "internal_benches", feature(test))]
+#![cfg(feature = "internal_benches")]
+
+extern crate ring;
+extern crate test as bench;
+extern crate untrusted;
+
+use ring::{agreement, error, rand};
+
+fn generate_key_bench(b: &mut bench::Bencher,
+                      alg: &'static agreement::Algorithm) {
+    let rng = rand::SystemRandom::new();
+    b.iter(|| {
+        agreement::EphemeralPrivateKey::generate(alg, &rng).unwrap()
+    });
+}
+
+// Measures a full ephemeral exchange from one side: key generation plus
+// shared-secret computation against a fixed peer public key.
+fn agree_ephemeral_bench(b: &mut bench::Bencher,
+                         alg: &'static agreement::Algorithm) {
+    let rng = rand::SystemRandom::new();
+    let peer_private_key =
+        agreement::EphemeralPrivateKey::generate(alg, &rng).unwrap();
+    let mut peer_public_key = vec![0u8; peer_private_key.public_key_len()];
+    peer_private_key.compute_public_key(&mut peer_public_key).unwrap();
+    b.iter(|| {
+        let my_private_key =
+            agreement::EphemeralPrivateKey::generate(alg, &rng).unwrap();
+        let peer_public_key = untrusted::Input::from(&peer_public_key);
+        agreement::agree_ephemeral(my_private_key, alg, peer_public_key,
+                                   error::Unspecified, |_| Ok(())).unwrap()
+    });
+}
+
+macro_rules! agreement_benches {
+    ( $alg_mod:ident, $alg:expr ) => {
+        mod $alg_mod {
+            use super::{agree_ephemeral_bench, generate_key_bench};
+            use bench;
+
+            #[bench]
+            fn generate_key(b: &mut bench::Bencher) {
+                generate_key_bench(b, $alg)
+            }
+
+            #[bench]
+            fn agree_ephemeral(b: &mut bench::Bencher) {
+                agree_ephemeral_bench(b, $alg)
+            }
+        }
+    }
+}
+
+agreement_benches!(x25519, &::ring::agreement::X25519);
+agreement_benches!(p256, &::ring::agreement::ECDH_P256);
+agreement_benches!(p384, &::ring::agreement::ECDH_P384);
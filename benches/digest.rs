@@ -0,0 +1,72 @@
+// Copyright 2017 Brian Smith.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+// SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+// OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+// CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+//! Throughput benchmarks for `digest::digest`.
+//!
+//! `Bencher::bytes` is set to the input length so `cargo bench` reports MB/s
+//! directly; cycles/byte is the CPU clock rate divided by that figure. Run
+//! with `mk/bench.sh` (requires Nightly Rust).
+
+#![cfg_attr(feature = "internal_benches", allow(unstable_features))]
+#![cfg_attr(feature = "internal_benches", feature(test))]
+#![cfg(feature = "internal_benches")]
+
+extern crate ring;
+extern crate test as bench;
+
+use ring::digest;
+
+fn digest_bench(b: &mut bench::Bencher, algorithm: &'static digest::Algorithm,
+                len: usize) {
+    let data = vec![0u8; len];
+    b.bytes = len as u64;
+    b.iter(|| digest::digest(algorithm, &data));
+}
+
+macro_rules! digest_benches {
+    ( $alg_mod:ident, $alg:expr ) => {
+        mod $alg_mod {
+            use super::digest_bench;
+            use bench;
+
+            #[bench]
+            fn digest_16(b: &mut bench::Bencher) { digest_bench(b, $alg, 16) }
+            #[bench]
+            fn digest_256(b: &mut bench::Bencher) {
+                digest_bench(b, $alg, 256)
+            }
+            #[bench]
+            fn digest_1350(b: &mut bench::Bencher) {
+                digest_bench(b, $alg, 1350)
+            }
+            #[bench]
+            fn digest_8192(b: &mut bench::Bencher) {
+                digest_bench(b, $alg, 8192)
+            }
+            #[bench]
+            fn digest_65536(b: &mut bench::Bencher) {
+                digest_bench(b, $alg, 65536)
+            }
+            #[bench]
+            fn digest_1048576(b: &mut bench::Bencher) {
+                digest_bench(b, $alg, 1048576)
+            }
+        }
+    }
+}
+
+digest_benches!(sha1, &::ring::digest::SHA1);
+digest_benches!(sha256, &::ring::digest::SHA256);
+digest_benches!(sha384, &::ring::digest::SHA384);
+digest_benches!(sha512, &::ring::digest::SHA512);
@@ -0,0 +1,139 @@
+// Copyright 2017 Brian Smith.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+// SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+// OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+// CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+//! Operation-rate benchmarks for signing and verification.
+//!
+//! ns/iter is the cost of one sign or verify operation; ops/sec is its
+//! reciprocal. Run with `mk/bench.sh` (requires Nightly Rust).
+
+#![cfg_attr(feature = "internal_benches", allow(unstable_features))]
+#![cfg_attr(feature = "internal_benches", feature(test))]
+#![cfg(feature = "internal_benches")]
+
+extern crate ring;
+extern crate test as bench;
+extern crate untrusted;
+
+use ring::{rand, signature, test};
+
+static MSG: &'static [u8] = b"hello, world";
+
+#[bench]
+fn ed25519_sign(b: &mut bench::Bencher) {
+    let rng = rand::SystemRandom::new();
+    let key_pair = signature::Ed25519KeyPair::generate(&rng).unwrap();
+    b.iter(|| key_pair.sign(MSG));
+}
+
+#[bench]
+fn ed25519_verify(b: &mut bench::Bencher) {
+    let rng = rand::SystemRandom::new();
+    let key_pair = signature::Ed25519KeyPair::generate(&rng).unwrap();
+    let sig = key_pair.sign(MSG);
+    let public_key = untrusted::Input::from(key_pair.public_key_bytes());
+    let msg = untrusted::Input::from(MSG);
+    b.iter(|| {
+        let sig = untrusted::Input::from(sig.as_slice());
+        signature::verify(&signature::ED25519, public_key, msg, sig).unwrap()
+    });
+}
+
+// The ECDSA vectors are the first valid cases for each curve in
+// src/ec/suite_b/ecdsa_verify_fixed_tests.txt; no in-tree ECDSA signing
+// exists to generate them on the fly.
+fn ecdsa_verify_fixed_bench(b: &mut bench::Bencher,
+                            alg: &'static signature::ECDSAParameters,
+                            q_hex: &str, sig_hex: &str) {
+    let public_key = test::from_hex(q_hex).unwrap();
+    let sig = test::from_hex(sig_hex).unwrap();
+    let msg = untrusted::Input::from(b"");
+    b.iter(|| {
+        let public_key = untrusted::Input::from(&public_key);
+        let sig = untrusted::Input::from(&sig);
+        signature::verify(alg, public_key, msg, sig).unwrap()
+    });
+}
+
+#[bench]
+fn ecdsa_p256_verify(b: &mut bench::Bencher) {
+    ecdsa_verify_fixed_bench(
+        b, &signature::ECDSA_P256_SHA256_FIXED,
+        "0430345fd47ea21a11129be651b0884bfac698377611acc9f689458e13b9ed7d4b\
+         9d7599a68dcf125e7f31055ccb374cd04f6d6fd2b217438a63f6f667d50ef2f0",
+        "341f6779b75e98bb42e01095dd48356cbf9002dc704ac8bd2a8240b88d3796c655\
+         5843b1b4e264fe6ffe6e2b705a376c05c09404303ffe5d2711f3e3b3a010a1");
+}
+
+#[bench]
+fn ecdsa_p384_verify(b: &mut bench::Bencher) {
+    ecdsa_verify_fixed_bench(
+        b, &signature::ECDSA_P384_SHA384_FIXED,
+        "045c5e788a805c77d34128b8401cb59b2373b8b468336c9318252bf39fd31d2507\
+         557987a5180a9435f9fb8eb971c426f1c485170dcb18fb688a257f89387a09fc4c\
+         5b8bd4b320616b54a0a7b1d1d7c6a0c59f6dff78c78ad4e3d6fca9c9a17b96",
+        "85ac708d4b0126bac1f5eeebdf911409070a286fdde5649582611b60046de35376\
+         1660dd03903f58b44148f25142eef8183475ec1f1392f3d6838abc0c01724709c4\
+         46888bed7f2ce4642c6839dc18044a2a6ab9ddc960bfac79f6988e62d452");
+}
+
+#[cfg(feature = "rsa_signing")]
+mod rsa {
+    use bench;
+    use ring::{rand, signature};
+    use std::sync::Arc;
+    use super::MSG;
+    use untrusted;
+
+    static PRIVATE_KEY_DER: &'static [u8] =
+        include_bytes!("../src/rsa/signature_rsa_example_private_key.der");
+    static PUBLIC_KEY_DER: &'static [u8] =
+        include_bytes!("../src/rsa/signature_rsa_example_public_key.der");
+
+    #[bench]
+    fn rsa_2048_pkcs1_sha256_sign(b: &mut bench::Bencher) {
+        let key_bytes = untrusted::Input::from(PRIVATE_KEY_DER);
+        let key_pair = signature::RSAKeyPair::from_der(key_bytes).unwrap();
+        let key_pair = Arc::new(key_pair);
+        let mut signing_state =
+            signature::RSASigningState::new(key_pair).unwrap();
+        let rng = rand::SystemRandom::new();
+        let mut sig =
+            vec![0u8; signing_state.key_pair().public_modulus_len()];
+        b.iter(|| {
+            signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MSG,
+                               &mut sig).unwrap()
+        });
+    }
+
+    #[bench]
+    fn rsa_2048_pkcs1_sha256_verify(b: &mut bench::Bencher) {
+        let key_bytes = untrusted::Input::from(PRIVATE_KEY_DER);
+        let key_pair = signature::RSAKeyPair::from_der(key_bytes).unwrap();
+        let key_pair = Arc::new(key_pair);
+        let mut signing_state =
+            signature::RSASigningState::new(key_pair).unwrap();
+        let rng = rand::SystemRandom::new();
+        let mut sig =
+            vec![0u8; signing_state.key_pair().public_modulus_len()];
+        signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MSG,
+                           &mut sig).unwrap();
+        let public_key = untrusted::Input::from(PUBLIC_KEY_DER);
+        let msg = untrusted::Input::from(MSG);
+        b.iter(|| {
+            let sig = untrusted::Input::from(&sig);
+            signature::verify(&signature::RSA_PKCS1_2048_8192_SHA256,
+                              public_key, msg, sig).unwrap()
+        });
+    }
+}
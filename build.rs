@@ -123,13 +123,16 @@ const RING_SRCS: &'static [(&'static [&'static str], &'static str)] = &[
     (&[X86_64], "crypto/bn/asm/x86_64-mont.pl"),
     (&[X86_64], "crypto/bn/asm/x86_64-mont5.pl"),
     (&[X86_64], "crypto/chacha/asm/chacha-x86_64.pl"),
+    (&[X86_64], "crypto/chacha/chacha-avx512.c"),
     (&[X86_64], "crypto/curve25519/asm/x25519-asm-x86_64.S"),
     (&[X86_64], "crypto/ec/asm/ecp_nistz256-x86_64.pl"),
     (&[X86_64], "crypto/ec/asm/p256-x86_64-asm.pl"),
+    (&[X86_64], "crypto/modes/aesni-gcm-avx512.c"),
     (&[X86_64], "crypto/modes/asm/aesni-gcm-x86_64.pl"),
     (&[X86_64], "crypto/modes/asm/ghash-x86_64.pl"),
     (&[X86_64], "crypto/poly1305/asm/poly1305-x86_64.pl"),
     (&[X86_64], SHA512_X86_64),
+    (&[X86_64], "crypto/sha/sha256-mb-avx2.c"),
 
     (&[AARCH64, ARM], "crypto/aes/asm/aesv8-armx.pl"),
     (&[AARCH64, ARM], "crypto/cpu-arm-linux.c"),
@@ -151,10 +154,17 @@ const RING_SRCS: &'static [(&'static [&'static str], &'static str)] = &[
     (&[AARCH64], "crypto/cpu-aarch64-linux.c"),
     (&[AARCH64], "crypto/chacha/asm/chacha-armv8.pl"),
     (&[AARCH64], "crypto/ec/asm/ecp_nistz256-armv8.pl"),
+    (&[AARCH64], "crypto/modes/aesv8-gcm-armv8.c"),
+    (&[AARCH64], "crypto/modes/ghash-neon-armv8.c"),
     (&[AARCH64], "crypto/poly1305/asm/poly1305-armv8.pl"),
     (&[AARCH64], SHA512_ARMV8),
 ];
 
+// There is no sha256-x86_64.pl file in crypto/sha/asm; sha512-x86_64.pl
+// generates the SHA-256 code (including its SHA-NI, AVX2/RORX, AVX, and
+// SSSE3 paths, dispatched off `GFp_ia32cap_P`) when it is run with an
+// output path containing "sha256". See `perlasm_src_dsts()`. Likewise for
+// sha512-armv8.pl and SHA-256 on AArch64.
 const SHA256_X86_64: &'static str = "crypto/sha/asm/sha256-x86_64.pl";
 const SHA512_X86_64: &'static str = "crypto/sha/asm/sha512-x86_64.pl";
 
@@ -171,6 +181,7 @@ const RING_INCLUDES: &'static [&'static str] =
       "crypto/cipher/internal.h",
       "crypto/curve25519/internal.h",
       "crypto/ec/ecp_nistz256_table.inl",
+      "crypto/ec/ecp_nistz384_table.inl",
       "crypto/ec/ecp_nistz384.inl",
       "crypto/ec/ecp_nistz.h",
       "crypto/ec/ecp_nistz384.h",
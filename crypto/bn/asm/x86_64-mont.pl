@@ -55,10 +55,10 @@ open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\"";
 
 # In upstream, this is controlled by shelling out to the compiler to check
 # versions, but BoringSSL is intended to be used with pre-generated perlasm
-# output, so this isn't useful anyway.
-#
-# TODO(davidben): Enable this option after testing. $addx goes up to 1.
-$addx = 0;
+# output, so this isn't useful anyway. The MULX/ADX code is selected at run
+# time off the BMI2 and ADX bits in |GFp_ia32cap_P|, so enabling it here is
+# safe on pre-Broadwell hardware.
+$addx = 1;
 
 # void GFp_bn_mul_mont(
 $rp="%rdi";	# BN_ULONG *rp,
@@ -40,10 +40,10 @@ open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\"";
 
 # In upstream, this is controlled by shelling out to the compiler to check
 # versions, but BoringSSL is intended to be used with pre-generated perlasm
-# output, so this isn't useful anyway.
-#
-# TODO(davidben): Enable this after testing. $addx goes up to 1.
-$addx = 0;
+# output, so this isn't useful anyway. The MULX/ADX code is selected at run
+# time off the BMI2 and ADX bits in |GFp_ia32cap_P|, so enabling it here is
+# safe on pre-Broadwell hardware.
+$addx = 1;
 
 # int GFp_bn_mul_mont_gather5(
 $rp="%rdi";	# BN_ULONG *rp,
@@ -2883,6 +2883,8 @@ bn_powerx5:
 .cfi_endproc
 .size	bn_powerx5,.-bn_powerx5
 
+.globl	GFp_bn_sqrx8x_internal
+.hidden GFp_bn_sqrx8x_internal
 .hidden	GFp_bn_sqrx8x_internal
 .type	GFp_bn_sqrx8x_internal,\@abi-omnipotent
 .align	32
@@ -3185,11 +3187,19 @@ $code.=<<___;
 
 .align	32
 .Lsqrx8x_break:
-	sub	16+8(%rsp),%r8		# consume last carry
+	xor	$zero,$zero
+	sub	16+8(%rsp),%rbx		# mov 16(%rsp),%cf
+	adcx	$zero,%r8
 	mov	24+8(%rsp),$carry	# initial $tptr, borrow $carry
+	adcx	$zero,%r9
 	mov	0*8($aptr),%rdx		# a[8], modulo-scheduled
-	xor	%ebp,%ebp		# xor	$zero,$zero
+	adc	\$0,%r10
 	mov	%r8,0*8($tptr)
+	adc	\$0,%r11
+	adc	\$0,%r12
+	adc	\$0,%r13
+	adc	\$0,%r14
+	adc	\$0,%r15
 	cmp	$carry,$tptr		# cf=0, of=0
 	je	.Lsqrx8x_outer_loop
 
@@ -247,75 +247,66 @@ static int copy_from_prebuf(BIGNUM *b, int top, unsigned char *buf, int idx,
    (MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH - \
     (((uintptr_t)(x_)) & (MOD_EXP_CTIME_MIN_CACHE_LINE_MASK))))
 
-/* This variant of GFp_BN_mod_exp_mont() uses fixed windows and the special
- * precomputation memory layout to limit data-dependency to a minimum
- * to protect secret exponents (cf. the hyper-threading timing attacks
- * pointed out by Colin Percival,
- * http://www.daemonology.net/hyperthreading-considered-harmful/).
- *
- * |p| must be positive. |a_mont| must in [0, m). |one_mont| must be
- * the value 1 Montgomery-encoded and fully reduced (mod m).
- *
- * Assumes 0 < a_mont < n, 0 < p, 0 < p_bits. */
-int GFp_BN_mod_exp_mont_consttime(BIGNUM *rr, const BIGNUM *a_mont,
-                                  const BIGNUM *p, size_t p_bits,
-                                  const BIGNUM *one_mont, const BIGNUM *n,
-                                  const BN_ULONG n0[BN_MONT_CTX_N0_LIMBS]) {
-  assert(p_bits > 0);
-  assert(p_bits <= (size_t)INT_MAX);
-  int bits = (int)p_bits;
-
-  int i, ret = 0, wvalue;
+/* mod_exp_window returns the window size to use for an exponent of |bits|
+ * bits. */
+static int mod_exp_window(int bits) {
+#if defined(OPENSSL_BN_ASM_MONT5)
+  (void)bits;
+  return 5;
+#else
+  return GFp_BN_window_bits_for_ctime_exponent_size(bits);
+#endif
+}
 
-  int numPowers;
-  unsigned char *powerbufFree = NULL;
+/* mod_exp_powerbuf_len returns the number of bytes needed for the power table
+ * and the |tmp| and |am| temporaries for a |top|-word modulus and a window of
+ * |window| bits, excluding cache line alignment slack. */
+static int mod_exp_powerbuf_len(int top, int window) {
+  int numPowers = 1 << window;
   int powerbufLen = 0;
-  unsigned char *powerbuf = NULL;
-  BIGNUM tmp, am;
-
-  const int top = n->top;
-  /* The |OPENSSL_BN_ASM_MONT5| code requires top > 1. */
-  if (top <= 1) {
-    goto err;
-  }
-
-
-  /* Get the window size to use with size of p. */
 #if defined(OPENSSL_BN_ASM_MONT5)
-  static const int window = 5;
   /* reserve space for n->d[] copy */
-  powerbufLen += top * sizeof(n->d[0]);
-#else
-  const int window = GFp_BN_window_bits_for_ctime_exponent_size(bits);
+  powerbufLen += top * (int)sizeof(BN_ULONG);
 #endif
-
-  /* Allocate a buffer large enough to hold all of the pre-computed
-   * powers of am, am itself and tmp.
-   */
-  numPowers = 1 << window;
+  /* All of the pre-computed powers of am, am itself and tmp. */
   powerbufLen +=
-      sizeof(n->d[0]) *
+      (int)sizeof(BN_ULONG) *
       (top * numPowers + ((2 * top) > numPowers ? (2 * top) : numPowers));
-#ifdef alloca
-  if (powerbufLen < 3072) {
-    powerbufFree = alloca(powerbufLen + MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH);
-  } else
+  return powerbufLen;
+}
+
+size_t GFp_BN_mod_exp_scratch_size(int top) {
+  /* Size for the largest window that |mod_exp_window| can return, so the
+   * result is independent of the exponent's bit length. */
+#if defined(OPENSSL_BN_ASM_MONT5)
+  const int max_window = 5;
+#else
+  const int max_window = BN_MAX_WINDOW_BITS_FOR_CTIME_EXPONENT_SIZE;
 #endif
-  {
-    if ((powerbufFree = OPENSSL_malloc(
-            powerbufLen + MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH)) == NULL) {
-      goto err;
-    }
+  if (top <= 1) {
+    return 0;
   }
+  return (size_t)mod_exp_powerbuf_len(top, max_window) +
+         MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH;
+}
 
-  powerbuf = MOD_EXP_CTIME_ALIGN(powerbufFree);
-  memset(powerbuf, 0, powerbufLen);
+/* mod_exp_mont_consttime computes |rr| = |a_mont|**|p| (mod |n|), using
+ * |powerbuf| for the power table and temporaries. |powerbuf| must be aligned
+ * to |MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH| and at least
+ * |mod_exp_powerbuf_len(n->top, window)| bytes. */
+static int mod_exp_mont_consttime(BIGNUM *rr, const BIGNUM *a_mont,
+                                  const BIGNUM *p, int bits,
+                                  const BIGNUM *one_mont, const BIGNUM *n,
+                                  const BN_ULONG n0[BN_MONT_CTX_N0_LIMBS],
+                                  int window, unsigned char *powerbuf) {
+  int i, ret = 0, wvalue;
+  BIGNUM tmp, am;
 
-#ifdef alloca
-  if (powerbufLen < 3072) {
-    powerbufFree = NULL;
-  }
-#endif
+  const int top = n->top;
+  const int numPowers = 1 << window;
+  const int powerbufLen = mod_exp_powerbuf_len(top, window);
+
+  memset(powerbuf, 0, powerbufLen);
 
   /* lay down tmp and am right after powers table */
   tmp.d = (BN_ULONG *)(powerbuf + sizeof(n->d[0]) * top * numPowers);
@@ -506,6 +497,80 @@ int GFp_BN_mod_exp_mont_consttime(BIGNUM *rr, const BIGNUM *a_mont,
   ret = 1;
 
 err:
+  return ret;
+}
+
+/* This variant of GFp_BN_mod_exp_mont() uses fixed windows and the special
+ * precomputation memory layout to limit data-dependency to a minimum
+ * to protect secret exponents (cf. the hyper-threading timing attacks
+ * pointed out by Colin Percival,
+ * http://www.daemonology.net/hyperthreading-considered-harmful/).
+ *
+ * |p| must be positive. |a_mont| must in [0, m). |one_mont| must be
+ * the value 1 Montgomery-encoded and fully reduced (mod m).
+ *
+ * Assumes 0 < a_mont < n, 0 < p, 0 < p_bits. */
+int GFp_BN_mod_exp_mont_consttime(BIGNUM *rr, const BIGNUM *a_mont,
+                                  const BIGNUM *p, size_t p_bits,
+                                  const BIGNUM *one_mont, const BIGNUM *n,
+                                  const BN_ULONG n0[BN_MONT_CTX_N0_LIMBS]) {
+  assert(p_bits > 0);
+  assert(p_bits <= (size_t)INT_MAX);
+  int bits = (int)p_bits;
+
+  int ret = 0;
+  unsigned char *powerbufFree = NULL;
+  unsigned char *powerbuf;
+
+  const int top = n->top;
+  /* The |OPENSSL_BN_ASM_MONT5| code requires top > 1. */
+  if (top <= 1) {
+    return 0;
+  }
+
+  /* Allocate a buffer large enough to hold all of the pre-computed
+   * powers of am, am itself and tmp.
+   */
+  const int window = mod_exp_window(bits);
+  const int powerbufLen = mod_exp_powerbuf_len(top, window);
+#ifdef alloca
+  if (powerbufLen < 3072) {
+    powerbufFree = alloca(powerbufLen + MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH);
+    powerbuf = MOD_EXP_CTIME_ALIGN(powerbufFree);
+    powerbufFree = NULL;
+  } else
+#endif
+  {
+    if ((powerbufFree = OPENSSL_malloc(
+            powerbufLen + MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH)) == NULL) {
+      return 0;
+    }
+    powerbuf = MOD_EXP_CTIME_ALIGN(powerbufFree);
+  }
+
+  ret = mod_exp_mont_consttime(rr, a_mont, p, bits, one_mont, n, n0, window,
+                               powerbuf);
+
   OPENSSL_free(powerbufFree);
-  return (ret);
+  return ret;
+}
+
+int GFp_BN_mod_exp_mont_consttime_scratch(
+    BIGNUM *rr, const BIGNUM *a_mont, const BIGNUM *p, size_t p_bits,
+    const BIGNUM *one_mont, const BIGNUM *n,
+    const BN_ULONG n0[BN_MONT_CTX_N0_LIMBS], uint8_t *scratch,
+    size_t scratch_len) {
+  assert(p_bits > 0);
+  assert(p_bits <= (size_t)INT_MAX);
+
+  const int top = n->top;
+  /* The |OPENSSL_BN_ASM_MONT5| code requires top > 1; also,
+   * |GFp_BN_mod_exp_scratch_size| returns zero for top <= 1. */
+  if (top <= 1 || scratch_len < GFp_BN_mod_exp_scratch_size(top)) {
+    return 0;
+  }
+
+  return mod_exp_mont_consttime(rr, a_mont, p, (int)p_bits, one_mont, n, n0,
+                                mod_exp_window((int)p_bits),
+                                MOD_EXP_CTIME_ALIGN(scratch));
 }
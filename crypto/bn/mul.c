@@ -111,6 +111,140 @@ static void GFp_bn_mul_normal(BN_ULONG *r, BN_ULONG *a, int na, BN_ULONG *b,
   }
 }
 
+/* Karatsuba multiplication is used for operands of
+ * |BN_MUL_KARATSUBA_MIN_LIMBS| or more limbs, recursively until the halves
+ * fall below the threshold. The threshold is where the savings from trading
+ * one half-size multiplication for a few additions start to pay for the
+ * bookkeeping; below it, |GFp_bn_mul_normal| wins. The maximum bounds the
+ * stack-allocated scratch space; larger operands (which don't occur for the
+ * modulus sizes the library accepts) fall back to |GFp_bn_mul_normal|. */
+#define BN_MUL_KARATSUBA_MIN_LIMBS 16
+#define BN_MUL_KARATSUBA_MAX_LIMBS 128
+
+/* bn_add_words_ct sets |r| = |a| + |b|, where all three are |num| words, and
+ * returns the carry. |r| may alias |a| or |b|. */
+static BN_ULONG bn_add_words_ct(BN_ULONG *r, const BN_ULONG *a,
+                                const BN_ULONG *b, int num) {
+  BN_ULONG carry = 0;
+  for (int i = 0; i < num; i++) {
+    BN_ULONG sum = a[i] + b[i];
+    BN_ULONG carry_out = sum < a[i];
+    sum += carry;
+    carry_out |= sum < carry;
+    r[i] = sum;
+    carry = carry_out;
+  }
+  return carry;
+}
+
+/* bn_abs_sub_words sets |r| = ||a| - |b||, where all three are |num| words,
+ * and sets |*neg_mask| to all ones if |a| < |b| and to zero otherwise,
+ * without branching on the values. */
+static void bn_abs_sub_words(BN_ULONG *r, const BN_ULONG *a, const BN_ULONG *b,
+                             int num, BN_ULONG *neg_mask) {
+  BN_ULONG borrow = GFp_bn_sub_words(r, a, b, num);
+  BN_ULONG mask = 0 - borrow;
+  /* If |a| < |b|, negate the result: -x == ~x + 1 (two's complement). */
+  BN_ULONG carry = borrow;
+  for (int i = 0; i < num; i++) {
+    BN_ULONG w = (r[i] ^ mask) + carry;
+    carry = w < carry;
+    r[i] = w;
+  }
+  *neg_mask = mask;
+}
+
+/* bn_mul_recursive sets |r| = |a| * |b|, where |a| and |b| are |num| words
+ * and |r| is 2*|num| words, using Karatsuba's method with |t| as scratch
+ * space. |num| must be even; each recursion level uses 3*|num| + 1 words of
+ * |t| before recursing on the halves. Like |GFp_bn_mul_normal|, the sequence
+ * of operations depends only on |num|, not on the values. */
+static void bn_mul_recursive(BN_ULONG *r, const BN_ULONG *a, const BN_ULONG *b,
+                             int num, BN_ULONG *t) {
+  if (num < BN_MUL_KARATSUBA_MIN_LIMBS || (num & 1)) {
+    GFp_bn_mul_normal(r, (BN_ULONG *)a, num, (BN_ULONG *)b, num);
+    return;
+  }
+
+  const int half = num / 2;
+  BN_ULONG *da = t;            /* |a0 - a1|, |half| words. */
+  BN_ULONG *db = t + half;     /* |b0 - b1|, |half| words. */
+  BN_ULONG *m = t + num;       /* |a0 - a1| * |b0 - b1|, |num| words. */
+  BN_ULONG *mid = t + 2 * num; /* a0*b0 + a1*b1, |num| + 1 words. */
+  BN_ULONG *next = t + 3 * num + 1;
+
+  /* Split a = a1*B + a0 and b = b1*B + b0, where B = 2**(BN_BITS2 * half).
+   * Then a*b = a1*b1*B**2 + (a0*b1 + a1*b0)*B + a0*b0, and the middle term
+   * is a0*b0 + a1*b1 - (a0 - a1)*(b0 - b1). */
+  BN_ULONG a_neg, b_neg;
+  bn_abs_sub_words(da, a, a + half, half, &a_neg);
+  bn_abs_sub_words(db, b, b + half, half, &b_neg);
+
+  bn_mul_recursive(r, a, b, half, next);                    /* a0 * b0 */
+  bn_mul_recursive(r + num, a + half, b + half, half, next); /* a1 * b1 */
+  bn_mul_recursive(m, da, db, half, next);
+
+  mid[num] = bn_add_words_ct(mid, r, r + num, num);
+
+  /* (a0 - a1)*(b0 - b1) == |a0 - a1| * |b0 - b1| exactly when the signs
+   * agree, in which case |m| is subtracted from |mid|; otherwise it is
+   * added. Do both cases as a two's complement addition of |m| or of -|m|,
+   * selected by |sub_mask|, over |num| + 1 words. The true value of |mid| is
+   * non-negative and fits in |num| + 1 words, so discarding the carry out of
+   * the top word gives the exact result. */
+  BN_ULONG sub_mask = ~(a_neg ^ b_neg);
+  BN_ULONG carry = sub_mask & 1;
+  for (int i = 0; i < num; i++) {
+    BN_ULONG w = m[i] ^ sub_mask;
+    BN_ULONG sum = mid[i] + w;
+    BN_ULONG carry_out = sum < w;
+    sum += carry;
+    carry_out |= sum < carry;
+    mid[i] = sum;
+    carry = carry_out;
+  }
+  mid[num] = (mid[num] + sub_mask + carry) & BN_MASK2;
+
+  /* r += mid * B. */
+  carry = bn_add_words_ct(r + half, r + half, mid, num + 1);
+  for (int i = half + num + 1; i < 2 * num; i++) {
+    BN_ULONG sum = r[i] + carry;
+    carry = sum < carry;
+    r[i] = sum;
+  }
+  /* The product fits in 2*|num| words, so the final carry is zero. */
+}
+
+/* bn_mul_karatsuba sets |r| = |a| * |b| if the operands are large enough for
+ * Karatsuba multiplication to be worthwhile, and returns one if it did so and
+ * zero to have the caller fall back to |GFp_bn_mul_normal|. |r| must have
+ * room for 2 * ((max(|na|, |nb|) + 1) & ~1) words. */
+static int bn_mul_karatsuba(BN_ULONG *r, const BN_ULONG *a, int na,
+                            const BN_ULONG *b, int nb) {
+  int max = na > nb ? na : nb;
+  if (max < BN_MUL_KARATSUBA_MIN_LIMBS || max > BN_MUL_KARATSUBA_MAX_LIMBS) {
+    return 0;
+  }
+
+  /* Zero-pad both operands to a common even width. The width, and therefore
+   * the memory access pattern, depends only on the operands' limb counts. */
+  const int num = (max + 1) & ~1;
+  BN_ULONG pa[BN_MUL_KARATSUBA_MAX_LIMBS + 1];
+  BN_ULONG pb[BN_MUL_KARATSUBA_MAX_LIMBS + 1];
+  /* Each level of recursion uses 3*|num| + 1 words before recursing on
+   * operands half as wide, so the total is bounded by 6*|num| + 2 plus
+   * slack for the levels' rounding. */
+  BN_ULONG t[6 * BN_MUL_KARATSUBA_MAX_LIMBS + 32];
+
+  memcpy(pa, a, na * sizeof(BN_ULONG));
+  memset(pa + na, 0, (num - na) * sizeof(BN_ULONG));
+  memcpy(pb, b, nb * sizeof(BN_ULONG));
+  memset(pb + nb, 0, (num - nb) * sizeof(BN_ULONG));
+
+  bn_mul_recursive(r, pa, pb, num, t);
+  return 1;
+}
+
 int GFp_BN_mul_no_alias(BIGNUM *r, const BIGNUM *a, const BIGNUM *b) {
   assert(r != a);
   assert(r != b);
@@ -127,6 +261,21 @@ int GFp_BN_mul_no_alias(BIGNUM *r, const BIGNUM *a, const BIGNUM *b) {
   }
   top = al + bl;
 
+  int max = al > bl ? al : bl;
+  if (max >= BN_MUL_KARATSUBA_MIN_LIMBS &&
+      max <= BN_MUL_KARATSUBA_MAX_LIMBS) {
+    /* |bn_mul_karatsuba| writes the zero-padded full product. */
+    const int padded_top = 2 * ((max + 1) & ~1);
+    if (!GFp_bn_wexpand(r, padded_top)) {
+      goto err;
+    }
+    if (bn_mul_karatsuba(r->d, a->d, al, b->d, bl)) {
+      r->top = padded_top;
+      GFp_bn_correct_top(r);
+      return 1;
+    }
+  }
+
   if (!GFp_bn_wexpand(r, top)) {
     goto err;
   }
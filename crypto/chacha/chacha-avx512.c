@@ -0,0 +1,173 @@
+/* Copyright 2017 Brian Smith.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. */
+
+/* AVX-512 bulk ChaCha20 kernel. Four blocks are processed per iteration,
+ * with row |r| of all four blocks held in the four 128-bit lanes of one ZMM
+ * register, so every 32-bit ALU operation works on sixteen state words --
+ * twice the width of the AVX2 path in chacha-x86_64.pl -- and the rotates
+ * use the AVX-512 VPROLD instruction instead of a shift/shift/or sequence.
+ *
+ * Like aesni-gcm-avx512.c this is written with compiler intrinsics; the
+ * Rust-level dispatch in src/chacha.rs only calls it (via
+ * |GFp_chacha20_avx512_capable|) for inputs long enough to fill it. */
+
+#include <GFp/base.h>
+#include <GFp/cpu.h>
+
+#include "../internal.h"
+
+/* Prototypes to satisfy -Wmissing-prototypes; the real declarations are the
+ * |extern| block in src/chacha.rs. */
+int GFp_chacha20_avx512_capable(void);
+void GFp_ChaCha20_ctr32_avx512(uint8_t *out, const uint8_t *in, size_t in_len,
+                               const uint32_t key[8],
+                               const uint32_t counter[4]);
+
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_X86_64) &&  \
+    ((defined(__clang_major__) && __clang_major__ >= 8) ||  \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define CHACHA20_AVX512_IMPLEMENTED
+#endif
+
+#if defined(CHACHA20_AVX512_IMPLEMENTED)
+
+#include <immintrin.h>
+
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+int GFp_chacha20_avx512_capable(void) {
+  /* AVX512F (leaf 7 EBX bit 16). |GFp_cpuid_setup| clears the bit when the
+   * OS does not enable ZMM state. */
+  return (GFp_ia32cap_P[2] & (1u << 16)) != 0;
+}
+
+/* chacha_core_4 computes four consecutive 64-byte keystream-transformed
+ * blocks from the row vectors and writes them, block-contiguous, to
+ * |blocks|. */
+static TARGET_AVX512 void chacha_core_4(__m512i row0, __m512i row1,
+                                        __m512i row2, __m512i row3,
+                                        __m512i blocks[4]) {
+  __m512i v0 = row0;
+  __m512i v1 = row1;
+  __m512i v2 = row2;
+  __m512i v3 = row3;
+
+#define QUARTER_ROUND                           \
+  v0 = _mm512_add_epi32(v0, v1);                \
+  v3 = _mm512_rol_epi32(_mm512_xor_si512(v3, v0), 16); \
+  v2 = _mm512_add_epi32(v2, v3);                \
+  v1 = _mm512_rol_epi32(_mm512_xor_si512(v1, v2), 12); \
+  v0 = _mm512_add_epi32(v0, v1);                \
+  v3 = _mm512_rol_epi32(_mm512_xor_si512(v3, v0), 8);  \
+  v2 = _mm512_add_epi32(v2, v3);                \
+  v1 = _mm512_rol_epi32(_mm512_xor_si512(v1, v2), 7);
+
+  for (int i = 0; i < 10; i++) {
+    /* Column round, then shuffle the rows into diagonals (within each
+     * 128-bit lane, i.e. within each block), do the diagonal round, and
+     * shuffle back. This is the same structure as the 128-bit SSSE3 path. */
+    QUARTER_ROUND
+    v1 = _mm512_shuffle_epi32(v1, _MM_PERM_ADCB);
+    v2 = _mm512_shuffle_epi32(v2, _MM_PERM_BADC);
+    v3 = _mm512_shuffle_epi32(v3, _MM_PERM_CBAD);
+    QUARTER_ROUND
+    v1 = _mm512_shuffle_epi32(v1, _MM_PERM_CBAD);
+    v2 = _mm512_shuffle_epi32(v2, _MM_PERM_BADC);
+    v3 = _mm512_shuffle_epi32(v3, _MM_PERM_ADCB);
+  }
+
+#undef QUARTER_ROUND
+
+  v0 = _mm512_add_epi32(v0, row0);
+  v1 = _mm512_add_epi32(v1, row1);
+  v2 = _mm512_add_epi32(v2, row2);
+  v3 = _mm512_add_epi32(v3, row3);
+
+  /* Transpose from row-major (lane j of row vector r is row r of block j) to
+   * block-contiguous outputs. */
+  __m512i a0 = _mm512_shuffle_i32x4(v0, v1, 0x44); /* x0L0 x0L1 x1L0 x1L1 */
+  __m512i a1 = _mm512_shuffle_i32x4(v2, v3, 0x44);
+  __m512i a2 = _mm512_shuffle_i32x4(v0, v1, 0xee); /* x0L2 x0L3 x1L2 x1L3 */
+  __m512i a3 = _mm512_shuffle_i32x4(v2, v3, 0xee);
+  blocks[0] = _mm512_shuffle_i32x4(a0, a1, 0x88); /* x0L0 x1L0 x2L0 x3L0 */
+  blocks[1] = _mm512_shuffle_i32x4(a0, a1, 0xdd); /* x0L1 x1L1 x2L1 x3L1 */
+  blocks[2] = _mm512_shuffle_i32x4(a2, a3, 0x88);
+  blocks[3] = _mm512_shuffle_i32x4(a2, a3, 0xdd);
+}
+
+TARGET_AVX512 void GFp_ChaCha20_ctr32_avx512(uint8_t *out, const uint8_t *in,
+                                             size_t in_len,
+                                             const uint32_t key[8],
+                                             const uint32_t counter[4]) {
+  const __m512i row0 = _mm512_broadcast_i32x4(
+      _mm_set_epi32(0x6b206574, 0x79622d32, 0x3320646e, 0x61707865));
+  const __m512i row1 =
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)key));
+  const __m512i row2 =
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)(key + 4)));
+
+  /* Row 3 is [counter, nonce0, nonce1, nonce2], with the per-block counter
+   * pre-incremented per lane. Like the assembly implementations, only the
+   * low 32-bit word counts (and wraps). */
+  __m512i row3 = _mm512_add_epi32(
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)counter)),
+      _mm512_set_epi32(0, 0, 0, 3, 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0));
+  const __m512i counter_incr =
+      _mm512_set_epi32(0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 4);
+
+  __m512i blocks[4];
+  while (in_len >= 256) {
+    chacha_core_4(row0, row1, row2, row3, blocks);
+    for (size_t j = 0; j < 4; j++) {
+      _mm512_storeu_si512(
+          (__m512i *)(out + 64 * j),
+          _mm512_xor_si512(blocks[j],
+                           _mm512_loadu_si512((const __m512i *)(in + 64 * j))));
+    }
+    row3 = _mm512_add_epi32(row3, counter_incr);
+    in += 256;
+    out += 256;
+    in_len -= 256;
+  }
+
+  if (in_len > 0) {
+    alignas(64) uint8_t keystream[256];
+    chacha_core_4(row0, row1, row2, row3, blocks);
+    for (size_t j = 0; j < 4; j++) {
+      _mm512_store_si512((__m512i *)(keystream + 64 * j), blocks[j]);
+    }
+    for (size_t i = 0; i < in_len; i++) {
+      out[i] = in[i] ^ keystream[i];
+    }
+  }
+}
+
+#else /* !CHACHA20_AVX512_IMPLEMENTED */
+
+/* Stubs so the symbols always exist. |GFp_chacha20_avx512_capable| returning
+ * zero keeps the kernel from ever being called; the forwarding body is for
+ * linkers that want a definition anyway. */
+
+void GFp_ChaCha20_ctr32(uint8_t *out, const uint8_t *in, size_t in_len,
+                        const uint32_t key[8], const uint32_t counter[4]);
+
+int GFp_chacha20_avx512_capable(void) { return 0; }
+
+void GFp_ChaCha20_ctr32_avx512(uint8_t *out, const uint8_t *in, size_t in_len,
+                               const uint32_t key[8],
+                               const uint32_t counter[4]) {
+  GFp_ChaCha20_ctr32(out, in, in_len, key, counter);
+}
+
+#endif /* CHACHA20_AVX512_IMPLEMENTED */
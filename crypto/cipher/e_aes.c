@@ -76,7 +76,25 @@ int GFp_aes_gcm_seal(const void *ctx_buf, uint8_t *in_out, size_t in_out_len,
                      uint8_t tag_out[EVP_AEAD_AES_GCM_TAG_LEN],
                      const uint8_t nonce[EVP_AEAD_AES_GCM_NONCE_LEN],
                      const uint8_t *ad, size_t ad_len);
+int GFp_aes_gcm_sign(const void *ctx_buf,
+                     uint8_t tag_out[EVP_AEAD_AES_GCM_TAG_LEN],
+                     const uint8_t nonce[EVP_AEAD_AES_GCM_NONCE_LEN],
+                     const uint8_t *ad, size_t ad_len);
+int GFp_aes_gcm_stream_init(void *state_buf, size_t state_buf_len,
+                            const void *ctx_buf,
+                            const uint8_t nonce[EVP_AEAD_AES_GCM_NONCE_LEN],
+                            const uint8_t *ad, size_t ad_len);
+int GFp_aes_gcm_stream_seal_update(void *state_buf, uint8_t *in_out,
+                                   size_t len);
+int GFp_aes_gcm_stream_open_update(void *state_buf, const uint8_t *in,
+                                   uint8_t *out, size_t len);
+void GFp_aes_gcm_stream_tag(void *state_buf,
+                            uint8_t tag_out[EVP_AEAD_AES_GCM_TAG_LEN]);
+int GFp_aes_gcm_ctr32_encrypt(const void *state_buf, uint8_t *in_out,
+                              size_t len, uint32_t block_offset);
+int GFp_aes_gcm_stream_ghash(void *state_buf, const uint8_t *in, size_t len);
 int GFp_has_aes_hardware(void);
+int GFp_aes_impl_id(void);
 
 
 #if !defined(OPENSSL_NO_ASM) && \
@@ -139,6 +157,17 @@ int GFp_vpaes_set_encrypt_key(const uint8_t *userKey, unsigned bits,
 void GFp_vpaes_encrypt(const uint8_t *in, uint8_t *out, const AES_KEY *key);
 #endif
 
+#if defined(OPENSSL_NO_ASM) || \
+    (!defined(OPENSSL_X86) && !defined(OPENSSL_X86_64) && !defined(OPENSSL_ARM))
+/* On platforms where aes.c's bitsliced implementation provides
+ * |GFp_AES_set_encrypt_key| and |GFp_AES_encrypt| (keep this condition in
+ * sync with aes.c), it also provides a two-blocks-at-a-time CTR function. */
+#define AES_NOHW_CTR
+void GFp_AES_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                  size_t blocks, const AES_KEY *key,
+                                  const uint8_t ivec[16]);
+#endif
+
 #if !defined(OPENSSL_NO_ASM) && \
     (defined(OPENSSL_X86_64) || defined(OPENSSL_X86))
 #define AESNI
@@ -229,7 +258,11 @@ static aes_ctr_f aes_ctr(void) {
   }
 #endif
 
+#if defined(AES_NOHW_CTR)
+  return GFp_AES_ctr32_encrypt_blocks;
+#else
   return NULL;
+#endif
 }
 
 #if defined(AESNI)
@@ -238,11 +271,45 @@ static char aesni_capable(void) {
 }
 #endif
 
+/* GFp_aes_impl_id reports which AES implementation |aes_set_key|, |aes_block|,
+ * and |aes_ctr| select on this machine; it is only called by the (optional)
+ * dispatch instrumentation in src/dispatch.rs. Keep the mapping in sync with
+ * those functions and with |aes_impl_name| in src/dispatch.rs:
+ *   0 = aes_nohw (aes.c), 1 = vpaes, 2 = bsaes (CTR only; the single-block
+ *   functions fall back to aes.c), 3 = aes_hw (aesv8/vcrypto), 4 = aesni. */
+int GFp_aes_impl_id(void) {
+#if defined(AESNI)
+  if (aesni_capable()) {
+    return 4;
+  }
+#endif
+
+#if defined(HWAES)
+  if (hwaes_capable()) {
+    return 3;
+  }
+#endif
+
+#if defined(BSAES)
+  if (bsaes_capable()) {
+    return 2;
+  }
+#endif
+
+#if defined(VPAES)
+  if (vpaes_capable()) {
+    return 1;
+  }
+#endif
+
+  return 0;
+}
+
 int GFp_aes_gcm_init(void *ctx_buf, size_t ctx_buf_len, const uint8_t *key,
                      size_t key_len) {
   alignas(16) AES_KEY ks;
-  assert(ctx_buf_len >= sizeof(ks) + GCM128_SERIALIZED_LEN);
-  if (ctx_buf_len < sizeof(ks) + GCM128_SERIALIZED_LEN) {
+  assert(ctx_buf_len >= sizeof(ks) + sizeof(GCM128_CONTEXT));
+  if (ctx_buf_len < sizeof(ks) + sizeof(GCM128_CONTEXT)) {
     return 0;
   }
 
@@ -250,7 +317,8 @@ int GFp_aes_gcm_init(void *ctx_buf, size_t ctx_buf_len, const uint8_t *key,
    * anyway. */
   (void)(aes_set_key())(key, (unsigned)key_len * 8, &ks);
 
-  GFp_gcm128_init_serialized((uint8_t *)ctx_buf + sizeof(ks), &ks, aes_block());
+  GFp_gcm128_init_template((uint8_t *)ctx_buf + sizeof(ks),
+                           ctx_buf_len - sizeof(ks), &ks, aes_block());
   memcpy(ctx_buf, &ks, sizeof(ks));
   return 1;
 }
@@ -260,8 +328,7 @@ static int gfp_aes_gcm_init_and_aad(GCM128_CONTEXT *gcm, AES_KEY *ks,
                                     const uint8_t ad[], size_t ad_len) {
   assert(ad != NULL || ad_len == 0);
   memcpy(ks, ctx_buf, sizeof(*ks));
-  GFp_gcm128_init(gcm, ks, aes_block(), (const uint8_t *)ctx_buf + sizeof(*ks),
-                  nonce);
+  GFp_gcm128_start(gcm, (const uint8_t *)ctx_buf + sizeof(*ks), ks, nonce);
   if (ad_len > 0) {
     if (!GFp_gcm128_aad(gcm, ad, ad_len)) {
       return 0;
@@ -300,6 +367,25 @@ int GFp_aes_gcm_seal(const void *ctx_buf, uint8_t *in_out, size_t in_out_len,
   return 1;
 }
 
+/* GMAC: authenticates |ad| without encrypting any payload. This is
+ * equivalent to |GFp_aes_gcm_seal| with an empty payload, but it never
+ * touches the CTR machinery, so the data makes exactly one pass through
+ * GHASH, plus the single block encryption of Y0 that the tag needs. */
+int GFp_aes_gcm_sign(const void *ctx_buf,
+                     uint8_t tag_out[EVP_AEAD_AES_GCM_TAG_LEN],
+                     const uint8_t nonce[EVP_AEAD_AES_GCM_NONCE_LEN],
+                     const uint8_t *ad, size_t ad_len) {
+  assert(ad != NULL || ad_len == 0);
+
+  GCM128_CONTEXT gcm;
+  alignas(16) AES_KEY ks;
+  if (!gfp_aes_gcm_init_and_aad(&gcm, &ks, ctx_buf, nonce, ad, ad_len)) {
+    return 0;
+  }
+  GFp_gcm128_tag(&gcm, tag_out);
+  return 1;
+}
+
 int GFp_aes_gcm_open(const void *ctx_buf, uint8_t *out, size_t in_out_len,
                      uint8_t tag_out[EVP_AEAD_AES_GCM_TAG_LEN],
                      const uint8_t nonce[EVP_AEAD_AES_GCM_NONCE_LEN],
@@ -332,6 +418,150 @@ int GFp_aes_gcm_open(const void *ctx_buf, uint8_t *out, size_t in_out_len,
 }
 
 
+/* Streaming (multi-part) AES-GCM.
+ *
+ * |state_buf| is an opaque caller-held buffer laid out like |ctx_buf| --
+ * |AES_KEY| followed by |GCM128_CONTEXT| -- except that the context part is
+ * the live per-record state rather than the key's template. |state_buf| isn't
+ * required to be aligned; every call copies the state to aligned stack
+ * variables before use, as the assembly implementations require, and copies
+ * the updated context back out.
+ *
+ * Every update except the last must pass a multiple of 16 bytes; see
+ * |GFp_gcm128_encrypt|. The Rust callers enforce this. */
+
+int GFp_aes_gcm_stream_init(void *state_buf, size_t state_buf_len,
+                            const void *ctx_buf,
+                            const uint8_t nonce[EVP_AEAD_AES_GCM_NONCE_LEN],
+                            const uint8_t *ad, size_t ad_len) {
+  assert(ad != NULL || ad_len == 0);
+
+  GCM128_CONTEXT gcm;
+  alignas(16) AES_KEY ks;
+  if (state_buf_len < sizeof(ks) + sizeof(gcm)) {
+    return 0;
+  }
+  if (!gfp_aes_gcm_init_and_aad(&gcm, &ks, ctx_buf, nonce, ad, ad_len)) {
+    return 0;
+  }
+  memcpy(state_buf, &ks, sizeof(ks));
+  memcpy((uint8_t *)state_buf + sizeof(ks), &gcm, sizeof(gcm));
+  return 1;
+}
+
+static int gfp_aes_gcm_stream_update(void *state_buf, const uint8_t *in,
+                                     uint8_t *out, size_t len, int encrypt) {
+  GCM128_CONTEXT gcm;
+  alignas(16) AES_KEY ks;
+  memcpy(&ks, state_buf, sizeof(ks));
+  memcpy(&gcm, (const uint8_t *)state_buf + sizeof(ks), sizeof(gcm));
+
+  int ret = 1;
+  if (len > 0) {
+    aes_ctr_f ctr = aes_ctr();
+    if (encrypt) {
+      if (ctr != NULL) {
+        ret = GFp_gcm128_encrypt_ctr32(&gcm, &ks, in, out, len, ctr);
+      } else {
+        ret = GFp_gcm128_encrypt(&gcm, &ks, in, out, len);
+      }
+    } else {
+      if (ctr != NULL) {
+        ret = GFp_gcm128_decrypt_ctr32(&gcm, &ks, in, out, len, ctr);
+      } else {
+        ret = GFp_gcm128_decrypt(&gcm, &ks, in, out, len);
+      }
+    }
+  }
+  memcpy((uint8_t *)state_buf + sizeof(ks), &gcm, sizeof(gcm));
+  return ret;
+}
+
+int GFp_aes_gcm_stream_seal_update(void *state_buf, uint8_t *in_out,
+                                   size_t len) {
+  assert(in_out != NULL || len == 0);
+  return gfp_aes_gcm_stream_update(state_buf, in_out, in_out, len, 1);
+}
+
+int GFp_aes_gcm_stream_open_update(void *state_buf, const uint8_t *in,
+                                   uint8_t *out, size_t len) {
+  assert(out != NULL || len == 0);
+  assert(aead_check_alias(in, len, out));
+  return gfp_aes_gcm_stream_update(state_buf, in, out, len, 0);
+}
+
+void GFp_aes_gcm_stream_tag(void *state_buf,
+                            uint8_t tag_out[EVP_AEAD_AES_GCM_TAG_LEN]) {
+  GCM128_CONTEXT gcm;
+  memcpy(&gcm, (const uint8_t *)state_buf + sizeof(AES_KEY), sizeof(gcm));
+  GFp_gcm128_tag(&gcm, tag_out);
+}
+
+/* GFp_aes_gcm_ctr32_encrypt generates keystream only: it encrypts (or, being
+ * CTR mode, equivalently decrypts) |len| bytes of |in_out| in place, starting
+ * |block_offset| blocks past the stream's base counter, without touching the
+ * GHASH state. Together with |GFp_aes_gcm_stream_ghash| this lets a caller
+ * run disjoint counter ranges of one payload on several threads and then
+ * authenticate the whole ciphertext in a single pass; since this function
+ * only reads |state_buf|, any number of threads may share one state. |len|
+ * may only be a non-multiple of 16 for the range at the end of the payload. */
+int GFp_aes_gcm_ctr32_encrypt(const void *state_buf, uint8_t *in_out,
+                              size_t len, uint32_t block_offset) {
+  assert(in_out != NULL || len == 0);
+
+  GCM128_CONTEXT gcm;
+  alignas(16) AES_KEY ks;
+  memcpy(&ks, state_buf, sizeof(ks));
+  memcpy(&gcm, (const uint8_t *)state_buf + sizeof(ks), sizeof(gcm));
+
+  alignas(16) uint8_t ivec[16];
+  memcpy(ivec, gcm.Yi, sizeof(ivec));
+  uint32_t ctr = from_be_u32_ptr(ivec + 12) + block_offset;
+  to_be_u32_ptr(ivec + 12, ctr);
+
+  size_t blocks = len / 16;
+  aes_ctr_f ctr_fn = aes_ctr();
+  if (ctr_fn != NULL) {
+    if (blocks > 0) {
+      (*ctr_fn)(in_out, in_out, blocks, &ks, ivec);
+    }
+  } else {
+    alignas(16) uint8_t eki[16];
+    for (size_t i = 0; i < blocks; ++i) {
+      (*gcm.block)(ivec, eki, &ks);
+      ++ctr;
+      to_be_u32_ptr(ivec + 12, ctr);
+      for (size_t j = 0; j < 16; ++j) {
+        in_out[i * 16 + j] ^= eki[j];
+      }
+    }
+  }
+  if (len % 16 != 0) {
+    if (ctr_fn != NULL) {
+      /* The CTR implementations don't write the advanced counter back. (In
+       * the fallback path above, |ivec| was advanced block by block.) */
+      to_be_u32_ptr(ivec + 12, ctr + (uint32_t)blocks);
+    }
+    alignas(16) uint8_t eki[16];
+    (*gcm.block)(ivec, eki, &ks);
+    for (size_t j = 0; j < len % 16; ++j) {
+      in_out[blocks * 16 + j] ^= eki[j];
+    }
+  }
+  return 1;
+}
+
+int GFp_aes_gcm_stream_ghash(void *state_buf, const uint8_t *in, size_t len) {
+  assert(in != NULL || len == 0);
+
+  GCM128_CONTEXT gcm;
+  memcpy(&gcm, (const uint8_t *)state_buf + sizeof(AES_KEY), sizeof(gcm));
+  int ret = GFp_gcm128_ghash(&gcm, in, len);
+  memcpy((uint8_t *)state_buf + sizeof(AES_KEY), &gcm, sizeof(gcm));
+  return ret;
+}
+
+
 int GFp_has_aes_hardware(void) {
 #if defined(AESNI)
   return aesni_capable() && GFp_gcm_clmul_enabled();
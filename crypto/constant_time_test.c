@@ -49,6 +49,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <GFp/mem.h>
+
 
 int bssl_constant_time_test_main(void);
 
@@ -166,6 +168,33 @@ static int test_eq_int(int a, int b) {
   return 0;
 }
 
+static int test_memcmp_16(void) {
+  uint8_t a[16], b[16];
+  for (size_t i = 0; i < 16; i++) {
+    a[i] = (uint8_t)(i * 31);
+    b[i] = a[i];
+  }
+
+  int num_failed = 0;
+  if (GFp_memcmp_16(a, b) != 0) {
+    fprintf(stderr, "GFp_memcmp_16 returned non-zero for equal inputs\n");
+    num_failed++;
+  }
+  for (size_t i = 0; i < 16; i++) {
+    for (unsigned bit = 0; bit < 8; bit++) {
+      b[i] ^= (uint8_t)(1u << bit);
+      if (GFp_memcmp_16(a, b) == 0) {
+        fprintf(stderr,
+                "GFp_memcmp_16 returned zero with byte %zu bit %u flipped\n",
+                i, bit);
+        num_failed++;
+      }
+      b[i] ^= (uint8_t)(1u << bit);
+    }
+  }
+  return num_failed;
+}
+
 static unsigned int test_values[] = {0, 1, 1024, 12345, 32000, UINT_MAX / 2 - 1,
                                      UINT_MAX / 2, UINT_MAX / 2 + 1,
                                      UINT_MAX - 1, UINT_MAX};
@@ -181,6 +210,8 @@ static int signed_test_values[] = {
 int bssl_constant_time_test_main(void) {
   int num_failed = 0;
 
+  num_failed += test_memcmp_16();
+
   for (size_t i = 0; i < sizeof(test_values) / sizeof(test_values[0]); ++i) {
     unsigned a = test_values[i];
     num_failed += test_is_zero(a);
@@ -252,6 +252,7 @@ static unsigned long get_hwcap_cpuinfo(const STRING_PIECE *cpuinfo) {
   return 0;
 }
 
+#if defined(__ANDROID__)
 static unsigned long get_hwcap2_cpuinfo(const STRING_PIECE *cpuinfo) {
   STRING_PIECE features;
   if (!extract_cpuinfo_field(&features, cpuinfo, "Features")) {
@@ -283,24 +284,47 @@ static int has_broken_neon(const STRING_PIECE *cpuinfo) {
          cpuinfo_field_equals(cpuinfo, "CPU part", "0x04d") &&
          cpuinfo_field_equals(cpuinfo, "CPU revision", "0");
 }
+#endif  /* __ANDROID__ */
+
+/* ensure_cpuinfo reads and wraps /proc/cpuinfo on the first call, so callers
+ * that never need it never pay for the read or the parsing. It returns one on
+ * success and zero on error. */
+static int ensure_cpuinfo(STRING_PIECE *cpuinfo, char **data, size_t *len) {
+  if (*data == NULL) {
+    if (!read_file(data, len, "/proc/cpuinfo")) {
+      return 0;
+    }
+    cpuinfo->data = *data;
+    cpuinfo->len = *len;
+  }
+  return 1;
+}
 
 extern uint32_t GFp_armcap_P;
 
 static int g_has_broken_neon;
 
 void GFp_cpuid_setup(void) {
-  char *cpuinfo_data;
-  size_t cpuinfo_len;
-  if (!read_file(&cpuinfo_data, &cpuinfo_len, "/proc/cpuinfo")) {
+  /* Normally this runs at most once, via |init|, but guard against direct
+   * callers too: detection may do file I/O, which matters in deployments
+   * that repeatedly fork short-lived workers. (Forked children inherit both
+   * |GFp_armcap_P| and this flag, so they skip detection entirely.) */
+  static int g_done = 0;
+  if (g_done) {
     return;
   }
+  g_done = 1;
+
+  /* /proc/cpuinfo is only read (and parsed) if one of the fallback paths
+   * below actually needs it. */
+  char *cpuinfo_data = NULL;
+  size_t cpuinfo_len = 0;
   STRING_PIECE cpuinfo;
-  cpuinfo.data = cpuinfo_data;
-  cpuinfo.len = cpuinfo_len;
 
-  /* |getauxval| is not available on Android until API level 20. If it is
-   * unavailable, read from /proc/self/auxv as a fallback. This is unreadable
-   * on some versions of Android, so further fall back to /proc/cpuinfo.
+  /* |getauxval| is the cheap path: no file I/O and no parsing. It is not
+   * available on Android until API level 20; if it is unavailable, read from
+   * /proc/self/auxv as a fallback. This is unreadable on some versions of
+   * Android, so further fall back to /proc/cpuinfo.
    *
    * See
    * https://android.googlesource.com/platform/ndk/+/882ac8f3392858991a0e1af33b4b7387ec856bd2
@@ -313,28 +337,41 @@ void GFp_cpuid_setup(void) {
     hwcap = getauxval_proc(AT_HWCAP);
   }
   if (hwcap == 0) {
+    if (!ensure_cpuinfo(&cpuinfo, &cpuinfo_data, &cpuinfo_len)) {
+      return;
+    }
     hwcap = get_hwcap_cpuinfo(&cpuinfo);
   }
 
-  /* Clear NEON support if known broken. */
-  g_has_broken_neon = has_broken_neon(&cpuinfo);
-  if (g_has_broken_neon) {
-    hwcap &= ~HWCAP_NEON;
+#if defined(__ANDROID__)
+  /* Clear NEON support if known broken. All the affected devices (see
+   * https://crbug.com/341598) are Android, so other systems are not forced
+   * to read /proc/cpuinfo just for this check. */
+  if ((hwcap & HWCAP_NEON) &&
+      ensure_cpuinfo(&cpuinfo, &cpuinfo_data, &cpuinfo_len)) {
+    g_has_broken_neon = has_broken_neon(&cpuinfo);
+    if (g_has_broken_neon) {
+      hwcap &= ~HWCAP_NEON;
+    }
   }
+#endif
 
   /* Matching OpenSSL, only report other features if NEON is present. */
   if (hwcap & HWCAP_NEON) {
     GFp_armcap_P |= ARMV7_NEON;
 
-    /* Some ARMv8 Android devices don't expose AT_HWCAP2. Fall back to
-     * /proc/cpuinfo. See https://crbug.com/596156. */
     unsigned long hwcap2 = 0;
     if (getauxval != NULL) {
       hwcap2 = getauxval(AT_HWCAP2);
     }
-    if (hwcap2 == 0) {
+#if defined(__ANDROID__)
+    /* Some ARMv8 Android devices don't expose AT_HWCAP2. Fall back to
+     * /proc/cpuinfo. See https://crbug.com/596156. */
+    if (hwcap2 == 0 &&
+        ensure_cpuinfo(&cpuinfo, &cpuinfo_data, &cpuinfo_len)) {
       hwcap2 = get_hwcap2_cpuinfo(&cpuinfo);
     }
+#endif
 
     if (hwcap2 & HWCAP2_AES) {
       GFp_armcap_P |= ARMV8_AES;
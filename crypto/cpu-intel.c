@@ -148,9 +148,11 @@ void GFp_cpuid_setup(void) {
   }
 
   uint32_t extended_features = 0;
+  uint32_t extended_features_ecx = 0;
   if (num_ids >= 7) {
     OPENSSL_cpuid(&eax, &ebx, &ecx, &edx, 7);
     extended_features = ebx;
+    extended_features_ecx = ecx;
   }
 
   /* Determine the number of cores sharing an L1 data cache to adjust the
@@ -208,11 +210,20 @@ void GFp_cpuid_setup(void) {
     ecx &= ~(1 << 11); /* AMD XOP */
     extended_features &= ~(1 << 5); /* AVX2 */
   }
+  if ((xcr0 & 0xe6) != 0xe6) {
+    /* ZMM registers and the opmask state cannot be used. */
+    extended_features &= ~(1u << 16); /* AVX512F */
+    extended_features &= ~(1u << 17); /* AVX512DQ */
+    extended_features &= ~(1u << 30); /* AVX512BW */
+    extended_features &= ~(1u << 31); /* AVX512VL */
+    extended_features_ecx &= ~(1u << 9);  /* VAES */
+    extended_features_ecx &= ~(1u << 10); /* VPCLMULQDQ */
+  }
 
   GFp_ia32cap_P[0] = edx;
   GFp_ia32cap_P[1] = ecx;
   GFp_ia32cap_P[2] = extended_features;
-  GFp_ia32cap_P[3] = 0;
+  GFp_ia32cap_P[3] = extended_features_ecx;
 }
 
 #endif  /* !OPENSSL_NO_ASM && (OPENSSL_X86 || OPENSSL_X86_64) */
@@ -36,6 +36,8 @@ void GFp_fe_mul(fe h, const fe f, const fe g);
 void GFp_fe_tobytes(uint8_t *s, const fe h);
 void GFp_ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
                                       const ge_p3 *A, const uint8_t *b);
+void GFp_ge_multi_scalarmult_vartime(ge_p3 *r, const ge_p3 *A,
+                                     const uint8_t (*a)[32], size_t num);
 int GFp_x25519_ge_frombytes_vartime(ge_p3 *h, const uint8_t *s);
 void GFp_x25519_ge_scalarmult_base(ge_p3 *h, const uint8_t a[32]);
 void GFp_x25519_sc_muladd(uint8_t *s, const uint8_t *a, const uint8_t *b,
@@ -3686,6 +3688,91 @@ void GFp_ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
   }
 }
 
+/* The number of points processed per pass of the joint sliding-window loop in
+ * |GFp_ge_multi_scalarmult_vartime|. Each point needs a 256-byte slide array
+ * and an 8-entry |ge_cached| table on the stack, so this bounds the stack
+ * usage regardless of how large the batch is. */
+#define GE_MULTI_SCALARMULT_STRIDE 8
+
+/* r = a[0] * A[0] + a[1] * A[1] + ... + a[num - 1] * A[num - 1]
+ * where each a[i] = a[i][0]+256*a[i][1]+...+256^31 a[i][31].
+ *
+ * If |num| is zero then |r| is the point at infinity. */
+void GFp_ge_multi_scalarmult_vartime(ge_p3 *r, const ge_p3 *A,
+                                     const uint8_t (*a)[32], size_t num) {
+  ge_p3_0(r);
+
+  while (num > 0) {
+    size_t stride =
+        num < GE_MULTI_SCALARMULT_STRIDE ? num : GE_MULTI_SCALARMULT_STRIDE;
+    signed char aslide[GE_MULTI_SCALARMULT_STRIDE][256];
+    ge_cached Ai[GE_MULTI_SCALARMULT_STRIDE][8]; /* A,3A,5A,...,15A */
+    ge_p2 s;
+    ge_p1p1 t;
+    ge_p3 u;
+    ge_p3 partial;
+    ge_cached partial_cached;
+    int i;
+    size_t j;
+
+    for (j = 0; j < stride; ++j) {
+      ge_p3 A2;
+
+      slide(aslide[j], a[j]);
+
+      x25519_ge_p3_to_cached(&Ai[j][0], &A[j]);
+      ge_p3_dbl(&t, &A[j]);
+      x25519_ge_p1p1_to_p3(&A2, &t);
+      for (i = 0; i < 7; ++i) {
+        x25519_ge_add(&t, &A2, &Ai[j][i]);
+        x25519_ge_p1p1_to_p3(&u, &t);
+        x25519_ge_p3_to_cached(&Ai[j][i + 1], &u);
+      }
+    }
+
+    ge_p2_0(&s);
+    ge_p3_0(&partial);
+
+    for (i = 255; i >= 0; --i) {
+      int any = 0;
+      for (j = 0; j < stride; ++j) {
+        any |= aslide[j][i];
+      }
+      if (any) {
+        break;
+      }
+    }
+
+    for (; i >= 0; --i) {
+      ge_p2_dbl(&t, &s);
+
+      for (j = 0; j < stride; ++j) {
+        if (aslide[j][i] > 0) {
+          x25519_ge_p1p1_to_p3(&u, &t);
+          x25519_ge_add(&t, &u, &Ai[j][aslide[j][i] / 2]);
+        } else if (aslide[j][i] < 0) {
+          x25519_ge_p1p1_to_p3(&u, &t);
+          x25519_ge_sub(&t, &u, &Ai[j][(-aslide[j][i]) / 2]);
+        }
+      }
+
+      if (i == 0) {
+        x25519_ge_p1p1_to_p3(&partial, &t);
+      } else {
+        x25519_ge_p1p1_to_p2(&s, &t);
+      }
+    }
+
+    x25519_ge_p3_to_cached(&partial_cached, &partial);
+    x25519_ge_add(&t, r, &partial_cached);
+    x25519_ge_p1p1_to_p3(r, &t);
+
+    A += stride;
+    a += stride;
+    num -= stride;
+  }
+}
+
 /* The set of scalars is \Z/l
  * where l = 2^252 + 27742317777372353535851937790883648493. */
 
@@ -4528,6 +4615,12 @@ void GFp_ed25519_scalar_mask(uint8_t a[32]) {
   a[31] |= 64;
 }
 
+static void x25519_scalar_mask(uint8_t e[32]) {
+  e[0] &= 248;
+  e[31] &= 127;
+  e[31] |= 64;
+}
+
 #if defined(BORINGSSL_X25519_X86_64)
 
 static void x25519_scalar_mult(uint8_t out[32], const uint8_t scalar[32],
@@ -4616,12 +4709,6 @@ static void GFp_fe_mul121666(fe h, fe f) {
   h[9] = (int32_t)h9;
 }
 
-static void x25519_scalar_mask(uint8_t e[32]) {
-  e[0] &= 248;
-  e[31] &= 127;
-  e[31] |= 64;
-}
-
 static void x25519_scalar_mult_generic(uint8_t out[32],
                                        const uint8_t scalar[32],
                                        const uint8_t point[32]) {
@@ -4702,19 +4789,9 @@ int GFp_x25519_ecdh(uint8_t out_shared_key[32], const uint8_t private_key[32],
   return GFp_memcmp(kZeros, out_shared_key, 32) != 0;
 }
 
-#if defined(BORINGSSL_X25519_X86_64)
-
-/* When |BORINGSSL_X25519_X86_64| is set, base point multiplication is done with
- * the Montgomery ladder because it's faster. Otherwise it's done using the
- * Ed25519 tables. */
-
-void GFp_x25519_public_from_private(uint8_t out_public_value[32],
-                                    const uint8_t private_key[32]) {
-  static const uint8_t kMongomeryBasePoint[32] = {9};
-  x25519_scalar_mult(out_public_value, private_key, kMongomeryBasePoint);
-}
-
-#else
+/* Base point multiplication is done with the Ed25519 precomputed tables,
+ * which beat running the Montgomery ladder on the generic and x86-64 code
+ * paths alike; only the NEON ladder is faster where it's available. */
 
 void GFp_x25519_public_from_private(uint8_t out_public_value[32],
                                     const uint8_t private_key[32]) {
@@ -4742,5 +4819,3 @@ void GFp_x25519_public_from_private(uint8_t out_public_value[32],
   GFp_fe_mul(zplusy, zplusy, zminusy_inv);
   GFp_fe_tobytes(out_public_value, zplusy);
 }
-
-#endif  /* BORINGSSL_X25519_X86_64 */
@@ -44,6 +44,12 @@ void GFp_nistz256_point_mul_base(P256_POINT *r,
 void GFp_nistz256_point_mul(P256_POINT *r, const BN_ULONG p_scalar[P256_LIMBS],
                             const BN_ULONG p_x[P256_LIMBS],
                             const BN_ULONG p_y[P256_LIMBS]);
+void GFp_nistz256_point_mul_table_init(P256_POINT table[16],
+                                       const BN_ULONG p_x[P256_LIMBS],
+                                       const BN_ULONG p_y[P256_LIMBS]);
+void GFp_nistz256_point_mul_precomputed(P256_POINT *r,
+                                        const BN_ULONG p_scalar[P256_LIMBS],
+                                        const P256_POINT table[16]);
 
 
 /* Functions implemented in assembly */
@@ -102,25 +108,14 @@ void GFp_nistz256_point_add_affine(P256_POINT *r, const P256_POINT *a,
                                    const P256_POINT_AFFINE *b);
 
 
-/* r = p * p_scalar */
-void GFp_nistz256_point_mul(P256_POINT *r, const BN_ULONG p_scalar[P256_LIMBS],
-                            const BN_ULONG p_x[P256_LIMBS],
-                            const BN_ULONG p_y[P256_LIMBS]) {
-  static const unsigned kWindowSize = 5;
-  static const unsigned kMask = (1 << (5 /* kWindowSize */ + 1)) - 1;
-
-  uint8_t p_str[(P256_LIMBS * BN_BYTES) + 1];
-  gfp_little_endian_bytes_from_scalar(p_str, sizeof(p_str) / sizeof(p_str[0]),
-                                      p_scalar, P256_LIMBS);
-
-  /* A |P256_POINT| is (3 * 32) = 96 bytes, and the 64-byte alignment should
-   * add no more than 63 bytes of overhead. Thus, |table| should require
-   * ~1599 ((96 * 16) + 63) bytes of stack space. */
-  alignas(64) P256_POINT table[16];
-
+/* Fills |table| with the multiples 1*p .. 16*p of the point (p_x, p_y), for
+ * use with |GFp_nistz256_point_mul_precomputed|. */
+void GFp_nistz256_point_mul_table_init(P256_POINT table[16],
+                                       const BN_ULONG p_x[P256_LIMBS],
+                                       const BN_ULONG p_y[P256_LIMBS]) {
   /* table[0] is implicitly (0,0,0) (the point at infinity), therefore it is
-   * not stored. All other values are actually stored with an offset of -1 in
-   * table. */
+  * not stored. All other values are actually stored with an offset of -1 in
+  * table. */
   P256_POINT *row = table;
 
   memcpy(row[1 - 1].X, p_x, P256_LIMBS * BN_BYTES);
@@ -142,6 +137,21 @@ void GFp_nistz256_point_mul(P256_POINT *r, const BN_ULONG p_scalar[P256_LIMBS],
   GFp_nistz256_point_add(&row[15 - 1], &row[14 - 1], &row[1 - 1]);
   GFp_nistz256_point_add(&row[11 - 1], &row[10 - 1], &row[1 - 1]);
   GFp_nistz256_point_double(&row[16 - 1], &row[8 - 1]);
+}
+
+/* r = p_scalar * p, where |table| contains the multiples 1*p .. 16*p of the
+ * point p as filled in by |GFp_nistz256_point_mul_table_init|. |table| must
+ * be 64-byte aligned; see |GFp_nistz256_point_mul_precomputed| for the entry
+ * point that doesn't require that. */
+static void point_mul_precomputed(P256_POINT *r,
+                                  const BN_ULONG p_scalar[P256_LIMBS],
+                                  const P256_POINT table[16]) {
+  static const unsigned kWindowSize = 5;
+  static const unsigned kMask = (1 << (5 /* kWindowSize */ + 1)) - 1;
+
+  uint8_t p_str[(P256_LIMBS * BN_BYTES) + 1];
+  gfp_little_endian_bytes_from_scalar(p_str, sizeof(p_str) / sizeof(p_str[0]),
+                                      p_scalar, P256_LIMBS);
 
   BN_ULONG tmp[P256_LIMBS];
   alignas(32) P256_POINT h;
@@ -194,6 +204,33 @@ void GFp_nistz256_point_mul(P256_POINT *r, const BN_ULONG p_scalar[P256_LIMBS],
   GFp_nistz256_point_add(r, r, &h);
 }
 
+/* r = p * p_scalar */
+void GFp_nistz256_point_mul(P256_POINT *r, const BN_ULONG p_scalar[P256_LIMBS],
+                            const BN_ULONG p_x[P256_LIMBS],
+                            const BN_ULONG p_y[P256_LIMBS]) {
+  /* A |P256_POINT| is (3 * 32) = 96 bytes, and the 64-byte alignment should
+   * add no more than 63 bytes of overhead. Thus, |table| should require
+   * ~1599 ((96 * 16) + 63) bytes of stack space. */
+  alignas(64) P256_POINT table[16];
+  GFp_nistz256_point_mul_table_init(table, p_x, p_y);
+  point_mul_precomputed(r, p_scalar, table);
+}
+
+/* Like |GFp_nistz256_point_mul|, but takes a table precomputed by
+ * |GFp_nistz256_point_mul_table_init| instead of the point itself, skipping
+ * the table construction (15 point operations) on every call. */
+void GFp_nistz256_point_mul_precomputed(P256_POINT *r,
+                                        const BN_ULONG p_scalar[P256_LIMBS],
+                                        const P256_POINT table[16]) {
+  /* The w5 selection kernels require an aligned table on some targets (the
+   * x86-64 ones use aligned vector loads), which the caller can't guarantee
+   * for a table it stored itself, so work from an aligned copy. The copy is
+   * cheap relative to the ~51 point operations in the multiplication. */
+  alignas(64) P256_POINT aligned_table[16];
+  memcpy(aligned_table, table, sizeof(aligned_table));
+  point_mul_precomputed(r, p_scalar, aligned_table);
+}
+
 void GFp_nistz256_point_mul_base(P256_POINT *r,
                                  const BN_ULONG g_scalar[P256_LIMBS]) {
   static const unsigned kWindowSize = 7;
@@ -24,9 +24,19 @@
 #include "ecp_nistz.h"
 
 /* Avoid -Wmissing-prototypes warnings. */
+void GFp_nistz384_point_add_affine(P384_POINT *r, const P384_POINT *a,
+                                   const P384_POINT_AFFINE *b);
 void GFp_nistz384_point_mul(P384_POINT *r, const BN_ULONG p_scalar[P384_LIMBS],
                             const BN_ULONG p_x[P384_LIMBS],
                             const BN_ULONG p_y[P384_LIMBS]);
+void GFp_nistz384_point_mul_base(P384_POINT *r,
+                                 const BN_ULONG g_scalar[P384_LIMBS]);
+void GFp_nistz384_point_mul_table_init(P384_POINT table[16],
+                                       const BN_ULONG p_x[P384_LIMBS],
+                                       const BN_ULONG p_y[P384_LIMBS]);
+void GFp_nistz384_point_mul_precomputed(P384_POINT *r,
+                                        const BN_ULONG p_scalar[P384_LIMBS],
+                                        const P384_POINT table[16]);
 
 
 static BN_ULONG is_zero(const BN_ULONG a[P384_LIMBS]) {
@@ -165,6 +175,84 @@ void GFp_nistz384_point_add(P384_POINT *r, const P384_POINT *a,
   memcpy(r->Z, res_z, sizeof(res_z));
 }
 
+/* This assumes that |x| and |y| have each been reduced to their minimal
+ * unique representations. */
+static BN_ULONG is_infinity(const BN_ULONG x[P384_LIMBS],
+                            const BN_ULONG y[P384_LIMBS]) {
+  BN_ULONG acc = 0;
+  for (size_t i = 0; i < P384_LIMBS; ++i) {
+    acc |= x[i] | y[i];
+  }
+  return constant_time_is_zero_size_t(acc);
+}
+
+/* Point addition when |b| is known to be affine: r = a+b */
+void GFp_nistz384_point_add_affine(P384_POINT *r, const P384_POINT *a,
+                                   const P384_POINT_AFFINE *b) {
+  BN_ULONG U2[P384_LIMBS], S2[P384_LIMBS];
+  BN_ULONG Z1sqr[P384_LIMBS];
+  BN_ULONG H[P384_LIMBS], R[P384_LIMBS];
+  BN_ULONG Hsqr[P384_LIMBS];
+  BN_ULONG Rsqr[P384_LIMBS];
+  BN_ULONG Hcub[P384_LIMBS];
+
+  BN_ULONG res_x[P384_LIMBS];
+  BN_ULONG res_y[P384_LIMBS];
+  BN_ULONG res_z[P384_LIMBS];
+
+  const BN_ULONG *in1_x = a->X;
+  const BN_ULONG *in1_y = a->Y;
+  const BN_ULONG *in1_z = a->Z;
+
+  const BN_ULONG *in2_x = b->X;
+  const BN_ULONG *in2_y = b->Y;
+
+  /* In affine representation we encode infinity as (0,0), which is not on the
+   * curve, so it is not the same as the (implicit) encoding used for Jacobian
+   * |a|. */
+  BN_ULONG in1infty = is_zero(a->Z);
+  BN_ULONG in2infty = is_infinity(b->X, b->Y);
+
+  elem_sqr_mont(Z1sqr, in1_z);        /* Z1^2 */
+
+  elem_mul_mont(U2, in2_x, Z1sqr);    /* U2 = X2*Z1^2 */
+  elem_sub(H, U2, in1_x);             /* H = U2 - U1 */
+
+  elem_mul_mont(S2, Z1sqr, in1_z);    /* S2 = Z1^3 */
+
+  elem_mul_mont(res_z, H, in1_z);     /* Z3 = H*Z1 */
+
+  elem_mul_mont(S2, S2, in2_y);       /* S2 = Y2*Z1^3 */
+  elem_sub(R, S2, in1_y);             /* R = S2 - S1 */
+
+  elem_sqr_mont(Hsqr, H);             /* H^2 */
+  elem_sqr_mont(Rsqr, R);             /* R^2 */
+  elem_mul_mont(Hcub, Hsqr, H);       /* H^3 */
+
+  elem_mul_mont(U2, in1_x, Hsqr);     /* U1*H^2 */
+  elem_mul_by_2(Hsqr, U2);            /* 2*U1*H^2 */
+
+  elem_sub(res_x, Rsqr, Hsqr);
+  elem_sub(res_x, res_x, Hcub);
+  elem_sub(H, U2, res_x);
+
+  elem_mul_mont(S2, in1_y, Hcub);
+  elem_mul_mont(H, H, R);
+  elem_sub(res_y, H, S2);
+
+  copy_conditional(res_x, in2_x, in1infty);
+  copy_conditional(res_y, in2_y, in1infty);
+  copy_conditional(res_z, ONE, in1infty);
+
+  copy_conditional(res_x, in1_x, in2infty);
+  copy_conditional(res_y, in1_y, in2infty);
+  copy_conditional(res_z, in1_z, in2infty);
+
+  memcpy(r->X, res_x, sizeof(res_x));
+  memcpy(r->Y, res_y, sizeof(res_y));
+  memcpy(r->Z, res_z, sizeof(res_z));
+}
+
 static void add_precomputed_w5(P384_POINT *r, unsigned wvalue,
                                const P384_POINT table[16]) {
   BN_ULONG recoded_is_negative;
@@ -181,22 +269,11 @@ static void add_precomputed_w5(P384_POINT *r, unsigned wvalue,
   GFp_nistz384_point_add(r, r, &h);
 }
 
-/* r = p * p_scalar */
-void GFp_nistz384_point_mul(P384_POINT *r, const BN_ULONG p_scalar[P384_LIMBS],
-                            const BN_ULONG p_x[P384_LIMBS],
-                            const BN_ULONG p_y[P384_LIMBS]) {
-  static const unsigned kWindowSize = 5;
-  static const unsigned kMask = (1 << (5 /* kWindowSize */ + 1)) - 1;
-
-  uint8_t p_str[(P384_LIMBS * BN_BYTES) + 1];
-  gfp_little_endian_bytes_from_scalar(p_str, sizeof(p_str) / sizeof(p_str[0]),
-                                      p_scalar, P384_LIMBS);
-
-  /* A |P384_POINT| is (3 * 48) = 144 bytes, and the 64-byte alignment should
-  * add no more than 63 bytes of overhead. Thus, |table| should require
-  * ~2367 ((144 * 16) + 63) bytes of stack space. */
-  alignas(64) P384_POINT table[16];
-
+/* Fills |table| with the multiples 1*p .. 16*p of the point (p_x, p_y), for
+ * use with |GFp_nistz384_point_mul_precomputed|. */
+void GFp_nistz384_point_mul_table_init(P384_POINT table[16],
+                                       const BN_ULONG p_x[P384_LIMBS],
+                                       const BN_ULONG p_y[P384_LIMBS]) {
   /* table[0] is implicitly (0,0,0) (the point at infinity), therefore it is
   * not stored. All other values are actually stored with an offset of -1 in
   * table. */
@@ -221,6 +298,20 @@ void GFp_nistz384_point_mul(P384_POINT *r, const BN_ULONG p_scalar[P384_LIMBS],
   GFp_nistz384_point_add(&row[15 - 1], &row[14 - 1], &row[1 - 1]);
   GFp_nistz384_point_add(&row[11 - 1], &row[10 - 1], &row[1 - 1]);
   GFp_nistz384_point_double(&row[16 - 1], &row[8 - 1]);
+}
+
+/* r = p_scalar * p, where |table| contains the multiples 1*p .. 16*p of the
+ * point p as filled in by |GFp_nistz384_point_mul_table_init|, skipping the
+ * table construction (15 point operations) on every call. */
+void GFp_nistz384_point_mul_precomputed(P384_POINT *r,
+                                        const BN_ULONG p_scalar[P384_LIMBS],
+                                        const P384_POINT table[16]) {
+  static const unsigned kWindowSize = 5;
+  static const unsigned kMask = (1 << (5 /* kWindowSize */ + 1)) - 1;
+
+  uint8_t p_str[(P384_LIMBS * BN_BYTES) + 1];
+  gfp_little_endian_bytes_from_scalar(p_str, sizeof(p_str) / sizeof(p_str[0]),
+                                      p_scalar, P384_LIMBS);
 
   static const unsigned START_INDEX = 384 - 4;
   unsigned index = START_INDEX;
@@ -259,3 +350,81 @@ void GFp_nistz384_point_mul(P384_POINT *r, const BN_ULONG p_scalar[P384_LIMBS],
   wvalue = (wvalue << 1) & kMask;
   add_precomputed_w5(r, wvalue, table);
 }
+
+/* r = p * p_scalar */
+void GFp_nistz384_point_mul(P384_POINT *r, const BN_ULONG p_scalar[P384_LIMBS],
+                            const BN_ULONG p_x[P384_LIMBS],
+                            const BN_ULONG p_y[P384_LIMBS]) {
+  /* A |P384_POINT| is (3 * 48) = 144 bytes, and the 64-byte alignment should
+  * add no more than 63 bytes of overhead. Thus, |table| should require
+  * ~2367 ((144 * 16) + 63) bytes of stack space. */
+  alignas(64) P384_POINT table[16];
+  GFp_nistz384_point_mul_table_init(table, p_x, p_y);
+  GFp_nistz384_point_mul_precomputed(r, p_scalar, table);
+}
+
+/* Precomputed tables for the default generator */
+#include "ecp_nistz384_table.inl"
+
+typedef P384_POINT_AFFINE PRECOMP384_ROW[64];
+
+/* r = g_scalar * G */
+void GFp_nistz384_point_mul_base(P384_POINT *r,
+                                 const BN_ULONG g_scalar[P384_LIMBS]) {
+  static const unsigned kWindowSize = 7;
+  static const unsigned kMask = (1 << (7 /* kWindowSize */ + 1)) - 1;
+
+  uint8_t p_str[(P384_LIMBS * BN_BYTES) + 1];
+  gfp_little_endian_bytes_from_scalar(p_str, sizeof(p_str) / sizeof(p_str[0]),
+                                      g_scalar, P384_LIMBS);
+
+  typedef union {
+    P384_POINT p;
+    P384_POINT_AFFINE a;
+  } P384_POINT_UNION;
+
+  alignas(64) P384_POINT_UNION p;
+  alignas(64) P384_POINT_UNION t;
+
+  /* First window */
+  unsigned index = kWindowSize;
+
+  unsigned raw_wvalue;
+  BN_ULONG recoded_is_negative;
+  unsigned recoded;
+
+  raw_wvalue = (p_str[0] << 1) & kMask;
+
+  booth_recode(&recoded_is_negative, &recoded, raw_wvalue, kWindowSize);
+  const PRECOMP384_ROW *const precomputed_table =
+      (const PRECOMP384_ROW *)GFp_nistz384_precomputed;
+  gfp_p384_point_select_w7(&p.a, precomputed_table[0], recoded);
+  GFp_p384_elem_neg(p.p.Z, p.p.Y);
+  copy_conditional(p.p.Y, p.p.Z, recoded_is_negative);
+
+  memcpy(p.p.Z, ONE, sizeof(ONE));
+  /* If it is at the point at infinity then p.p.X will be zero. */
+  copy_conditional(p.p.Z, p.p.X, is_infinity(p.p.X, p.p.Y));
+
+  for (size_t i = 1; i < 55; i++) {
+    unsigned off = (index - 1) / 8;
+    raw_wvalue = p_str[off] | p_str[off + 1] << 8;
+    raw_wvalue = (raw_wvalue >> ((index - 1) % 8)) & kMask;
+    index += kWindowSize;
+
+    booth_recode(&recoded_is_negative, &recoded, raw_wvalue, kWindowSize);
+    gfp_p384_point_select_w7(&t.a, precomputed_table[i], recoded);
+    GFp_p384_elem_neg(t.p.Z, t.a.Y);
+    copy_conditional(t.a.Y, t.p.Z, recoded_is_negative);
+    GFp_nistz384_point_add_affine(&p.p, &p.p, &t.a);
+  }
+
+  LIMBS_reduce_once(p.p.X, Q, P384_LIMBS);
+  LIMBS_reduce_once(p.p.Y, Q, P384_LIMBS);
+  LIMBS_reduce_once(p.p.Z, Q, P384_LIMBS);
+
+  /* If it is at the point at infinity then p.p.X will be zero. */
+  copy_conditional(p.p.Z, p.p.X, is_infinity(p.p.X, p.p.Y));
+
+  memcpy(r, &p.p, sizeof(p.p));
+}
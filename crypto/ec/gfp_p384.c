@@ -41,6 +41,8 @@ void GFp_p384_elem_neg(Elem r, const Elem a);
 void GFp_p384_scalar_inv_to_mont(ScalarMont r, const Scalar a);
 void GFp_p384_scalar_mul_mont(ScalarMont r, const ScalarMont a,
                               const ScalarMont b);
+void GFp_p384_scalar_sqr_mont(ScalarMont r, const ScalarMont a);
+void GFp_p384_scalar_sqr_rep_mont(ScalarMont r, const ScalarMont a, int rep);
 
 
 static const BN_ULONG Q[P384_LIMBS] = {
@@ -173,12 +175,68 @@ static void elem_div_by_2(Elem r, const Elem a) {
   copy_conditional(r, adjusted, is_odd);
 }
 
+#if defined(OPENSSL_64_BIT) && defined(BN_ULLONG)
+
+/* A dedicated 6-limb Montgomery multiplication (the CIOS method). Fixing the
+ * limb count lets the compiler fully unroll the loops, which makes this
+ * considerably faster than the generic |GFp_bn_mul_mont| loop. |n0| is the
+ * first word of the negated inverse of the modulus |m| mod 2**64. The inputs
+ * must be fully reduced mod |m|; the result is fully reduced too. */
+static void mont_mul(Limb r[P384_LIMBS], const Limb a[P384_LIMBS],
+                     const Limb b[P384_LIMBS], const Limb m[P384_LIMBS],
+                     BN_ULONG n0) {
+  BN_ULONG t[P384_LIMBS + 2];
+  memset(t, 0, sizeof(t));
+
+  for (size_t i = 0; i < P384_LIMBS; ++i) {
+    BN_ULLONG uv;
+    BN_ULONG carry = 0;
+    for (size_t j = 0; j < P384_LIMBS; ++j) {
+      uv = (BN_ULLONG)a[j] * b[i] + t[j] + carry;
+      t[j] = (BN_ULONG)uv;
+      carry = (BN_ULONG)(uv >> BN_BITS2);
+    }
+    uv = (BN_ULLONG)t[P384_LIMBS] + carry;
+    t[P384_LIMBS] = (BN_ULONG)uv;
+    t[P384_LIMBS + 1] = (BN_ULONG)(uv >> BN_BITS2);
+
+    BN_ULONG w = t[0] * n0;
+    uv = (BN_ULLONG)w * m[0] + t[0];
+    carry = (BN_ULONG)(uv >> BN_BITS2);
+    for (size_t j = 1; j < P384_LIMBS; ++j) {
+      uv = (BN_ULLONG)w * m[j] + t[j] + carry;
+      t[j - 1] = (BN_ULONG)uv;
+      carry = (BN_ULONG)(uv >> BN_BITS2);
+    }
+    uv = (BN_ULLONG)t[P384_LIMBS] + carry;
+    t[P384_LIMBS - 1] = (BN_ULONG)uv;
+    t[P384_LIMBS] = t[P384_LIMBS + 1] + (BN_ULONG)(uv >> BN_BITS2);
+  }
+
+  /* The intermediate result is less than 2*m (with the extra bit in
+   * |t[P384_LIMBS]|, which is 0 or 1), so a single conditional subtraction of
+   * |m| fully reduces it. */
+  Limb sub[P384_LIMBS];
+  Limb borrow = limbs_sub(sub, t, m, P384_LIMBS);
+  Limb underflow =
+      constant_time_is_nonzero_size_t(borrow & (t[P384_LIMBS] ^ 1));
+  for (size_t i = 0; i < P384_LIMBS; ++i) {
+    r[i] = constant_time_select_size_t(underflow, t[i], sub[i]);
+  }
+}
+
+#endif
+
 static inline void elem_mul_mont(Elem r, const Elem a, const Elem b) {
   static const BN_ULONG Q_N0[] = {
     BN_MONT_CTX_N0(0x1, 0x1)
   };
+#if defined(OPENSSL_64_BIT) && defined(BN_ULLONG)
+  mont_mul(r, a, b, Q, Q_N0[0]);
+#else
   /* XXX: Not (clearly) constant-time; inefficient.*/
   GFp_bn_mul_mont(r, a, b, Q, Q_N0, P384_LIMBS);
+#endif
 }
 
 static inline void elem_mul_by_2(Elem r, const Elem a) {
@@ -231,8 +289,29 @@ void GFp_p384_scalar_mul_mont(ScalarMont r, const ScalarMont a,
   static const BN_ULONG N_N0[] = {
     BN_MONT_CTX_N0(0x6ed46089, 0xe88fdc45)
   };
+#if defined(OPENSSL_64_BIT) && defined(BN_ULLONG)
+  mont_mul(r, a, b, N, N_N0[0]);
+#else
   /* XXX: Inefficient. TODO: Add dedicated multiplication routine. */
   GFp_bn_mul_mont(r, a, b, N, N_N0, P384_LIMBS);
+#endif
+}
+
+void GFp_p384_scalar_sqr_mont(ScalarMont r, const ScalarMont a) {
+  /* XXX: Inefficient. TODO: Add a dedicated squaring routine. */
+  GFp_p384_scalar_mul_mont(r, a, a);
+}
+
+/* The addition-chain exponentiation in p384.rs does all of its repeated
+ * squarings through here so they cost one call, not one call per squaring;
+ * this is also the one place a dedicated squaring routine would slot in.
+ * Keep the contract in sync with |GFp_p256_scalar_sqr_rep_mont|. */
+void GFp_p384_scalar_sqr_rep_mont(ScalarMont r, const ScalarMont a, int rep) {
+  assert(rep >= 1);
+  GFp_p384_scalar_sqr_mont(r, a);
+  for (int i = 1; i < rep; ++i) {
+    GFp_p384_scalar_sqr_mont(r, r);
+  }
 }
 
 
@@ -258,5 +337,23 @@ static void gfp_p384_point_select_w5(P384_POINT *out,
   memcpy(out->Z, z, sizeof(z));
 }
 
+static void gfp_p384_point_select_w7(P384_POINT_AFFINE *out,
+                                     const P384_POINT_AFFINE table[64],
+                                     size_t index) {
+  Elem x; memset(x, 0, sizeof(x));
+  Elem y; memset(y, 0, sizeof(y));
+
+  for (size_t i = 0; i < 64; ++i) {
+    Limb mask = constant_time_eq_size_t(index, i + 1);
+    for (size_t j = 0; j < P384_LIMBS; ++j) {
+      x[j] |= table[i].X[j] & mask;
+      y[j] |= table[i].Y[j] & mask;
+    }
+  }
+
+  memcpy(out->X, x, sizeof(x));
+  memcpy(out->Y, y, sizeof(y));
+}
+
 
 #include "ecp_nistz384.inl"
@@ -14,6 +14,7 @@
 
 #include "limbs.h"
 
+#include <GFp/cpu.h>
 #include <GFp/type_check.h>
 
 #include "../internal.h"
@@ -39,6 +40,52 @@ OPENSSL_COMPILE_ASSERT(sizeof(size_t) == sizeof(Limb),
                        size_t_and_limb_are_different_sizes);
 
 
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_X86_64) &&      \
+    (defined(__clang__) ||                                      \
+     (defined(__GNUC__) &&                                      \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define LIMBS_AVX2_IMPLEMENTED
+#endif
+
+#if defined(LIMBS_AVX2_IMPLEMENTED)
+
+#include <immintrin.h>
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+/* The AVX2 paths compute both candidate results of the conditional modular
+ * correction and then do a lane-parallel masked select, instead of threading
+ * |mask| through the scalar carry chain; see the comment in
+ * |LIMBS_reduce_once|. They need |num_limbs| of temporary space, so they are
+ * limited to operands up to |LIMBS_AVX2_MAX_LIMBS| limbs (enough for the
+ * suite-b field elements and scalars, which are the hot callers); larger
+ * operands, and CPUs without AVX2, use the scalar loops. */
+#define LIMBS_AVX2_MAX_LIMBS 12
+
+static int limbs_avx2_capable(void) {
+  return (GFp_ia32cap_P[2] & (1u << 5)) != 0; /* AVX2 */
+}
+
+/* r[i] = mask ? a[i] : r[i], for |mask| all-ones or all-zeros. */
+static TARGET_AVX2 void limbs_copy_conditional_avx2(Limb r[], const Limb a[],
+                                                    Limb mask,
+                                                    size_t num_limbs) {
+  __m256i vmask = _mm256_set1_epi64x((long long)mask);
+  size_t i = 0;
+  for (; i + 4 <= num_limbs; i += 4) {
+    __m256i vr = _mm256_loadu_si256((const __m256i *)&r[i]);
+    __m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+    __m256i selected = _mm256_blendv_epi8(vr, va, vmask);
+    _mm256_storeu_si256((__m256i *)&r[i], selected);
+  }
+  for (; i < num_limbs; ++i) {
+    r[i] = constant_time_select_size_t(mask, a[i], r[i]);
+  }
+}
+
+#endif
+
+
 /* Returns 0xfff..f if |a| is all zero limbs, and zero otherwise. */
 Limb LIMBS_are_zero(const Limb a[], size_t num_limbs) {
   assert(num_limbs >= 1);
@@ -78,6 +125,19 @@ Limb LIMBS_less_than(const Limb a[], const Limb b[], size_t num_limbs) {
 /* if (r >= m) { r -= m; } */
 void LIMBS_reduce_once(Limb r[], const Limb m[], size_t num_limbs) {
   assert(num_limbs >= 1);
+#if defined(LIMBS_AVX2_IMPLEMENTED)
+  if (num_limbs <= LIMBS_AVX2_MAX_LIMBS && limbs_avx2_capable()) {
+    /* Store |r - m| and then conditionally copy it over |r|; the copy is
+     * lane-parallel and the scalar borrow chain doesn't have to thread the
+     * mask through the carry flag. */
+    Limb r_minus_m[LIMBS_AVX2_MAX_LIMBS];
+    Limb borrow = (Limb)limbs_sub(r_minus_m, r, m, num_limbs);
+    limbs_copy_conditional_avx2(r, r_minus_m,
+                                constant_time_is_zero_size_t(borrow),
+                                num_limbs);
+    return;
+  }
+#endif
   /* This could be done more efficiently if we had |num_limbs| of extra space
    * available, by storing |r - m| and then doing a conditional copy of either
    * |r| or |r - m|. But, in order to operate in constant space, with an eye
@@ -106,6 +166,14 @@ void LIMBS_add_mod(Limb r[], const Limb a[], const Limb b[], const Limb m[],
       constant_time_is_nonzero_size_t(limbs_add(r, a, b, num_limbs));
   Limb overflow2 = ~LIMBS_less_than(r, m, num_limbs);
   Limb overflow = overflow1 | overflow2;
+#if defined(LIMBS_AVX2_IMPLEMENTED)
+  if (num_limbs <= LIMBS_AVX2_MAX_LIMBS && limbs_avx2_capable()) {
+    Limb r_minus_m[LIMBS_AVX2_MAX_LIMBS];
+    (void)limbs_sub(r_minus_m, r, m, num_limbs);
+    limbs_copy_conditional_avx2(r, r_minus_m, overflow, num_limbs);
+    return;
+  }
+#endif
   Carry borrow = limb_sub(&r[0], r[0], m[0] & overflow);
   for (size_t i = 1; i < num_limbs; ++i) {
     borrow = limb_sbb(&r[i], r[i], m[i] & overflow, borrow);
@@ -121,6 +189,14 @@ void LIMBS_sub_mod(Limb r[], const Limb a[], const Limb b[], const Limb m[],
                    size_t num_limbs) {
   Limb underflow =
       constant_time_is_nonzero_size_t(limbs_sub(r, a, b, num_limbs));
+#if defined(LIMBS_AVX2_IMPLEMENTED)
+  if (num_limbs <= LIMBS_AVX2_MAX_LIMBS && limbs_avx2_capable()) {
+    Limb r_plus_m[LIMBS_AVX2_MAX_LIMBS];
+    (void)limbs_add(r_plus_m, r, m, num_limbs);
+    limbs_copy_conditional_avx2(r, r_plus_m, underflow, num_limbs);
+    return;
+  }
+#endif
   Carry carry = limb_add(&r[0], r[0], m[0] & underflow);
   for (size_t i = 1; i < num_limbs; ++i) {
     carry = limb_adc(&r[i], r[i], m[i] & underflow, carry);
@@ -156,6 +232,14 @@ void LIMBS_shl_mod(Limb r[], const Limb a[], const Limb m[], size_t num_limbs) {
   }
   Limb overflow2 = ~LIMBS_less_than(r, m, num_limbs);
   Limb overflow = overflow1 | overflow2;
+#if defined(LIMBS_AVX2_IMPLEMENTED)
+  if (num_limbs <= LIMBS_AVX2_MAX_LIMBS && limbs_avx2_capable()) {
+    Limb r_minus_m[LIMBS_AVX2_MAX_LIMBS];
+    (void)limbs_sub(r_minus_m, r, m, num_limbs);
+    limbs_copy_conditional_avx2(r, r_minus_m, overflow, num_limbs);
+    return;
+  }
+#endif
   Carry borrow = limb_sub(&r[0], r[0], m[0] & overflow);
   for (size_t i = 1; i < num_limbs; ++i) {
     borrow = limb_sbb(&r[i], r[i], m[i] & overflow, borrow);
@@ -56,6 +56,15 @@
 
 #include <GFp/mem.h>
 
+#if (defined(OPENSSL_X86) || defined(OPENSSL_X86_64)) && defined(__SSE2__)
+#include <emmintrin.h>
+#define GFP_MEMCMP_16_SSE2
+#elif defined(OPENSSL_AARCH64) || \
+    (defined(OPENSSL_ARM) && defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define GFP_MEMCMP_16_NEON
+#endif
+
 int GFp_memcmp(const void *in_a, const void *in_b, size_t len) {
   const uint8_t *a = in_a;
   const uint8_t *b = in_b;
@@ -67,3 +76,22 @@ int GFp_memcmp(const void *in_a, const void *in_b, size_t len) {
 
   return x;
 }
+
+int GFp_memcmp_16(const void *in_a, const void *in_b) {
+#if defined(GFP_MEMCMP_16_SSE2)
+  const __m128i a = _mm_loadu_si128((const __m128i *)in_a);
+  const __m128i b = _mm_loadu_si128((const __m128i *)in_b);
+  /* All sixteen lanes of the byte-equality compare are set iff the blocks
+   * are equal; the compare and mask extraction are branch-free and take time
+   * independent of the contents. */
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xffff;
+#elif defined(GFP_MEMCMP_16_NEON)
+  const uint8x16_t a = vld1q_u8(in_a);
+  const uint8x16_t b = vld1q_u8(in_b);
+  const uint64x2_t eq = vreinterpretq_u64_u8(vceqq_u8(a, b));
+  uint64_t folded = vgetq_lane_u64(eq, 0) & vgetq_lane_u64(eq, 1);
+  return folded != UINT64_C(0xffffffffffffffff);
+#else
+  return GFp_memcmp(in_a, in_b, 16);
+#endif
+}
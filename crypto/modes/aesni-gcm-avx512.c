@@ -0,0 +1,286 @@
+/* Copyright 2017 Brian Smith.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. */
+
+/* Stitched AES-CTR + GHASH bulk kernel for CPUs with VAES, VPCLMULQDQ, and
+ * AVX-512 (Ice Lake and later). Four AES blocks are encrypted per ZMM
+ * register and the GHASH of each 64-byte group is interleaved into the same
+ * loop using lane-parallel VPCLMULQDQ with a single deferred reduction, so
+ * the payload makes one trip through memory.
+ *
+ * This is written with compiler intrinsics rather than perlasm. The
+ * instruction selection is fixed by the intrinsics so there is little for the
+ * assembler-level scheduling to add, and keeping it in C keeps the GHASH
+ * bookkeeping auditable. The GHASH math follows the POLYVAL formulation of
+ * RFC 8452: blocks are byte-reflected, H is multiplied by x once up front
+ * (|REDUCE1BIT| in gcm.c does the same thing for the 4-bit tables), and
+ * products are reduced Montgomery-style by two carry-less multiplications
+ * with the 0xc2... constant. */
+
+#include <GFp/base.h>
+#include <GFp/cpu.h>
+
+#include "internal.h"
+
+/* Prototypes to satisfy -Wmissing-prototypes; the real declarations that the
+ * dispatch code uses are in modes/internal.h. */
+int GFp_aesni_gcm_avx512_capable(void);
+size_t GFp_aesni_gcm_encrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]);
+size_t GFp_aesni_gcm_decrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]);
+
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_X86_64) &&  \
+    ((defined(__clang_major__) && __clang_major__ >= 8) ||  \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define AES_GCM_AVX512_IMPLEMENTED
+#endif
+
+#if defined(AES_GCM_AVX512_IMPLEMENTED)
+
+#include <immintrin.h>
+
+#define TARGET_VAES \
+  __attribute__((target("avx512f,avx512bw,vaes,vpclmulqdq,aes,pclmul")))
+
+/* The kernel only pays for itself on payloads of at least this many bytes;
+ * shorter inputs are left to |GFp_aesni_gcm_encrypt| and the generic code. */
+#define AVX512_MIN_LEN 256
+
+int GFp_aesni_gcm_avx512_capable(void) {
+  /* AVX512F + AVX512BW (leaf 7 EBX bits 16 and 30), VAES + VPCLMULQDQ
+   * (leaf 7 ECX bits 9 and 10). |GFp_cpuid_setup| clears these bits when the
+   * OS does not enable ZMM state. */
+  return (GFp_ia32cap_P[2] & (1u << 16)) != 0 &&
+         (GFp_ia32cap_P[2] & (1u << 30)) != 0 &&
+         (GFp_ia32cap_P[3] & (1u << 9)) != 0 &&
+         (GFp_ia32cap_P[3] & (1u << 10)) != 0;
+}
+
+/* bswap_mask reverses the bytes within each 128-bit lane, converting between
+ * the GCM byte serialization and the reflected representation the carry-less
+ * multiplications operate on. */
+static TARGET_VAES __m512i bswap_mask_512(void) {
+  const __m128i mask =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm512_broadcast_i32x4(mask);
+}
+
+static TARGET_VAES __m128i bswap_128(__m128i x) {
+  const __m128i mask =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm_shuffle_epi8(x, mask);
+}
+
+/* gfmul_128 returns the GHASH product of |a| and |b|, where |b| is in the
+ * "multiplied by x" (twisted) representation, using Karatsuba-free schoolbook
+ * multiplication and the two-step 0xc2 reduction. */
+static TARGET_VAES __m128i gfmul_128(__m128i a, __m128i b) {
+  const __m128i poly = _mm_set_epi64x((int64_t)0xc200000000000000, 1);
+  __m128i lo = _mm_clmulepi64_si128(a, b, 0x00);
+  __m128i hi = _mm_clmulepi64_si128(a, b, 0x11);
+  __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x01),
+                              _mm_clmulepi64_si128(a, b, 0x10));
+  lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+  hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+  __m128i t = _mm_clmulepi64_si128(lo, poly, 0x10);
+  lo = _mm_xor_si128(t, _mm_shuffle_epi32(lo, 78));
+  t = _mm_clmulepi64_si128(lo, poly, 0x10);
+  lo = _mm_xor_si128(t, _mm_shuffle_epi32(lo, 78));
+  return _mm_xor_si128(lo, hi);
+}
+
+/* xor_lanes folds the four 128-bit lanes of |v| together. */
+static TARGET_VAES __m128i xor_lanes(__m512i v) {
+  __m256i folded = _mm256_xor_si256(_mm512_extracti64x4_epi64(v, 0),
+                                    _mm512_extracti64x4_epi64(v, 1));
+  return _mm_xor_si128(_mm256_extracti128_si256(folded, 0),
+                       _mm256_extracti128_si256(folded, 1));
+}
+
+/* ghash_4 folds four byte-reflected blocks (|data|, lane 0 first) into the
+ * GHASH accumulator |acc| using the lane-parallel powers |hpow| =
+ * [H^4, H^3, H^2, H] (lane 0 holding H^4), with a single reduction. */
+static TARGET_VAES __m128i ghash_4(__m128i acc, __m512i data, __m512i hpow) {
+  const __m128i poly = _mm_set_epi64x((int64_t)0xc200000000000000, 1);
+  data = _mm512_xor_si512(data, _mm512_zextsi128_si512(acc));
+  __m512i lo4 = _mm512_clmulepi64_epi128(data, hpow, 0x00);
+  __m512i hi4 = _mm512_clmulepi64_epi128(data, hpow, 0x11);
+  __m512i mid4 = _mm512_xor_si512(_mm512_clmulepi64_epi128(data, hpow, 0x01),
+                                  _mm512_clmulepi64_epi128(data, hpow, 0x10));
+  __m128i lo = xor_lanes(lo4);
+  __m128i hi = xor_lanes(hi4);
+  __m128i mid = xor_lanes(mid4);
+  lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+  hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+  __m128i t = _mm_clmulepi64_si128(lo, poly, 0x10);
+  lo = _mm_xor_si128(t, _mm_shuffle_epi32(lo, 78));
+  t = _mm_clmulepi64_si128(lo, poly, 0x10);
+  lo = _mm_xor_si128(t, _mm_shuffle_epi32(lo, 78));
+  return _mm_xor_si128(lo, hi);
+}
+
+/* aes_encrypt_block encrypts one block with |key| using AES-NI; it is used
+ * to derive H = E(K, 0^128) so that the kernel does not depend on the layout
+ * of any particular serialized Htable. */
+static TARGET_VAES __m128i aes_encrypt_block(__m128i block,
+                                             const AES_KEY *key) {
+  const __m128i *rk = (const __m128i *)key->rd_key;
+  /* |aesni_set_encrypt_key| stores the number of rounds minus one (9/11/13),
+   * unlike |GFp_AES_set_encrypt_key|; this kernel is only reached with
+   * AES-NI key schedules. */
+  unsigned rounds = (unsigned)key->rounds + 1;
+  block = _mm_xor_si128(block, _mm_loadu_si128(&rk[0]));
+  for (unsigned i = 1; i < rounds; ++i) {
+    block = _mm_aesenc_si128(block, _mm_loadu_si128(&rk[i]));
+  }
+  return _mm_aesenclast_si128(block, _mm_loadu_si128(&rk[rounds]));
+}
+
+/* load_h_powers computes [H^4, H^3, H^2, H] (lane 0 = H^4) in the twisted
+ * representation, deriving H from |key| directly. */
+static TARGET_VAES __m512i load_h_powers(const AES_KEY *key) {
+  __m128i h = aes_encrypt_block(_mm_setzero_si128(), key);
+  h = bswap_128(h);
+
+  /* Multiply H by x (the REDUCE1BIT twist), operating on the reflected
+   * 128-bit value (hi:lo). */
+  alignas(16) uint64_t w[2];
+  _mm_store_si128((__m128i *)w, h);
+  uint64_t lo = w[0], hi = w[1];
+  uint64_t carry = hi >> 63;
+  hi = (hi << 1) | (lo >> 63);
+  lo <<= 1;
+  hi ^= carry * UINT64_C(0xc200000000000000);
+  lo ^= carry;
+  __m128i h1 = _mm_set_epi64x((int64_t)hi, (int64_t)lo);
+
+  __m128i h2 = gfmul_128(h1, h1);
+  __m128i h3 = gfmul_128(h2, h1);
+  __m128i h4 = gfmul_128(h3, h1);
+  __m512i r = _mm512_zextsi128_si512(h4);
+  /* |_mm512_inserti32x4| rather than |_mm512_inserti64x2|; the latter is
+   * AVX512DQ, which |GFp_aesni_gcm_avx512_capable| does not check for. */
+  r = _mm512_inserti32x4(r, h3, 1);
+  r = _mm512_inserti32x4(r, h2, 2);
+  r = _mm512_inserti32x4(r, h1, 3);
+  return r;
+}
+
+static TARGET_VAES size_t aesni_gcm_crypt_avx512(const uint8_t *in,
+                                                 uint8_t *out, size_t len,
+                                                 const AES_KEY *key,
+                                                 uint8_t ivec[16],
+                                                 uint8_t Xi[16], int enc) {
+  size_t bulk = len & ~(size_t)63;
+  if (bulk < AVX512_MIN_LEN) {
+    return 0;
+  }
+
+  const __m512i bswap = bswap_mask_512();
+  const __m512i hpow = load_h_powers(key);
+
+  /* Broadcast the key schedule once; VAES operates on all four lanes. As in
+   * |aes_encrypt_block|, |key->rounds| is the AES-NI rounds-minus-one. */
+  __m512i rks[15];
+  unsigned rounds = (unsigned)key->rounds + 1;
+  for (unsigned i = 0; i <= rounds; ++i) {
+    rks[i] = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i *)&key->rd_key[4 * i]));
+  }
+
+  const __m512i y_base = _mm512_broadcast_i32x4(
+      _mm_loadu_si128((const __m128i *)ivec));
+  uint32_t ctr = from_be_u32_ptr(ivec + 12);
+  __m128i acc = bswap_128(_mm_loadu_si128((const __m128i *)Xi));
+
+  for (size_t done = 0; done < bulk; done += 64) {
+    /* Counter blocks for this group; dword 3 of each lane is the big-endian
+     * 32-bit counter. */
+    __m512i ctrs = _mm512_mask_mov_epi32(
+        y_base, 0x8888,
+        _mm512_set_epi32((int)__builtin_bswap32(ctr + 3), 0, 0, 0,
+                         (int)__builtin_bswap32(ctr + 2), 0, 0, 0,
+                         (int)__builtin_bswap32(ctr + 1), 0, 0, 0,
+                         (int)__builtin_bswap32(ctr), 0, 0, 0));
+    ctr += 4;
+
+    __m512i state = _mm512_xor_si512(ctrs, rks[0]);
+    for (unsigned i = 1; i < rounds; ++i) {
+      state = _mm512_aesenc_epi128(state, rks[i]);
+    }
+    state = _mm512_aesenclast_epi128(state, rks[rounds]);
+
+    __m512i input = _mm512_loadu_si512((const void *)(in + done));
+    __m512i output = _mm512_xor_si512(state, input);
+    _mm512_storeu_si512((void *)(out + done), output);
+
+    /* GHASH is always over the ciphertext. */
+    __m512i auth = enc ? output : input;
+    acc = ghash_4(acc, _mm512_shuffle_epi8(auth, bswap), hpow);
+  }
+
+  _mm_storeu_si128((__m128i *)Xi, bswap_128(acc));
+  to_be_u32_ptr(ivec + 12, ctr);
+  return bulk;
+}
+
+size_t GFp_aesni_gcm_encrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]) {
+  return aesni_gcm_crypt_avx512(in, out, len, key, ivec, Xi, 1);
+}
+
+size_t GFp_aesni_gcm_decrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]) {
+  return aesni_gcm_crypt_avx512(in, out, len, key, ivec, Xi, 0);
+}
+
+#else
+
+/* Stubs so that the dispatch code links on toolchains that cannot compile
+ * the AVX-512 intrinsics; |GFp_aesni_gcm_avx512_capable| returning zero keeps
+ * them unreachable. */
+
+int GFp_aesni_gcm_avx512_capable(void) { return 0; }
+
+size_t GFp_aesni_gcm_encrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]) {
+  (void)in;
+  (void)out;
+  (void)len;
+  (void)key;
+  (void)ivec;
+  (void)Xi;
+  return 0;
+}
+
+size_t GFp_aesni_gcm_decrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]) {
+  (void)in;
+  (void)out;
+  (void)len;
+  (void)key;
+  (void)ivec;
+  (void)Xi;
+  return 0;
+}
+
+#endif /* AES_GCM_AVX512_IMPLEMENTED */
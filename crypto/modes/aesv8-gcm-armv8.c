@@ -0,0 +1,281 @@
+/* Copyright 2017 Brian Smith.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. */
+
+/* Stitched AES-CTR + PMULL GHASH bulk kernel for AArch64 CPUs with the
+ * Crypto Extensions. Four counter blocks are encrypted per iteration with
+ * the four AESE/AESMC pipelines running in parallel, and the GHASH of each
+ * 64-byte group is folded in with per-block PMULL products and a single
+ * deferred reduction, so the payload makes one trip through memory instead
+ * of separate AES and GHASH passes.
+ *
+ * The GHASH bookkeeping -- the byte reflection, the multiply-by-x twist of
+ * H, and the two-step 0xc2 Montgomery reduction -- is the same as in
+ * aesni-gcm-avx512.c; only the expression of the carry-less multiplications
+ * differs (PMULL/PMULL2 instead of VPCLMULQDQ). */
+
+#include <GFp/base.h>
+#include <GFp/cpu.h>
+
+#include "internal.h"
+
+/* Prototypes to satisfy -Wmissing-prototypes; the real declarations that the
+ * dispatch code uses are in modes/internal.h. */
+int GFp_aesv8_gcm_capable(void);
+size_t GFp_aesv8_gcm_encrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]);
+size_t GFp_aesv8_gcm_decrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]);
+
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_AARCH64) && \
+    ((defined(__clang_major__) && __clang_major__ >= 8) ||  \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define AESV8_GCM_IMPLEMENTED
+#endif
+
+#if defined(AESV8_GCM_IMPLEMENTED)
+
+#include <arm_neon.h>
+
+#define TARGET_CRYPTO __attribute__((target("+crypto")))
+
+/* The kernel only pays for itself on payloads of at least this many bytes;
+ * shorter inputs are left to the separate AES and GHASH passes. */
+#define AESV8_GCM_MIN_LEN 256
+
+int GFp_aesv8_gcm_capable(void) {
+  return GFp_is_ARMv8_AES_capable() && GFp_is_ARMv8_PMULL_capable();
+}
+
+/* bswap_128 reverses the bytes of a 128-bit vector, converting between the
+ * GCM byte serialization and the reflected representation the carry-less
+ * multiplications operate on. */
+static TARGET_CRYPTO uint8x16_t bswap_128(uint8x16_t x) {
+  uint8x16_t swapped = vrev64q_u8(x);
+  return vextq_u8(swapped, swapped, 8);
+}
+
+static TARGET_CRYPTO uint8x16_t clmul_lo_lo(uint8x16_t a, uint8x16_t b) {
+  return vreinterpretq_u8_p128(
+      vmull_p64((poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(a), 0),
+                (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(b), 0)));
+}
+
+static TARGET_CRYPTO uint8x16_t clmul_hi_hi(uint8x16_t a, uint8x16_t b) {
+  return vreinterpretq_u8_p128(
+      vmull_high_p64(vreinterpretq_p64_u8(a), vreinterpretq_p64_u8(b)));
+}
+
+static TARGET_CRYPTO uint8x16_t clmul_mid(uint8x16_t a, uint8x16_t b) {
+  uint8x16_t lo_hi = vreinterpretq_u8_p128(
+      vmull_p64((poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(a), 0),
+                (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(b), 1)));
+  uint8x16_t hi_lo = vreinterpretq_u8_p128(
+      vmull_p64((poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(a), 1),
+                (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(b), 0)));
+  return veorq_u8(lo_hi, hi_lo);
+}
+
+/* gfmul_reduce folds the 256-bit product (|hi|:|lo|, with the middle terms
+ * already merged in) down to 128 bits with the two-step 0xc2 reduction. */
+static TARGET_CRYPTO uint8x16_t gfmul_reduce(uint8x16_t lo, uint8x16_t hi) {
+  const poly64_t poly = (poly64_t)UINT64_C(0xc200000000000000);
+  uint8x16_t t = vreinterpretq_u8_p128(vmull_p64(
+      (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(lo), 0), poly));
+  lo = veorq_u8(t, vextq_u8(lo, lo, 8));
+  t = vreinterpretq_u8_p128(vmull_p64(
+      (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(lo), 0), poly));
+  lo = veorq_u8(t, vextq_u8(lo, lo, 8));
+  return veorq_u8(lo, hi);
+}
+
+/* gfmul_128 returns the GHASH product of |a| and |b|, where |b| is in the
+ * "multiplied by x" (twisted) representation. */
+static TARGET_CRYPTO uint8x16_t gfmul_128(uint8x16_t a, uint8x16_t b) {
+  const uint8x16_t zero = vdupq_n_u8(0);
+  uint8x16_t lo = clmul_lo_lo(a, b);
+  uint8x16_t hi = clmul_hi_hi(a, b);
+  uint8x16_t mid = clmul_mid(a, b);
+  lo = veorq_u8(lo, vextq_u8(zero, mid, 8));
+  hi = veorq_u8(hi, vextq_u8(mid, zero, 8));
+  return gfmul_reduce(lo, hi);
+}
+
+/* ghash_4 folds four byte-reflected ciphertext blocks (|b0| first) into the
+ * GHASH accumulator |acc| using the powers |h4|..|h1| (|b0| is multiplied by
+ * H^4), with a single reduction. */
+static TARGET_CRYPTO uint8x16_t ghash_4(uint8x16_t acc, uint8x16_t b0,
+                                        uint8x16_t b1, uint8x16_t b2,
+                                        uint8x16_t b3, uint8x16_t h4,
+                                        uint8x16_t h3, uint8x16_t h2,
+                                        uint8x16_t h1) {
+  const uint8x16_t zero = vdupq_n_u8(0);
+  b0 = veorq_u8(b0, acc);
+  uint8x16_t lo = veorq_u8(veorq_u8(clmul_lo_lo(b0, h4), clmul_lo_lo(b1, h3)),
+                           veorq_u8(clmul_lo_lo(b2, h2), clmul_lo_lo(b3, h1)));
+  uint8x16_t hi = veorq_u8(veorq_u8(clmul_hi_hi(b0, h4), clmul_hi_hi(b1, h3)),
+                           veorq_u8(clmul_hi_hi(b2, h2), clmul_hi_hi(b3, h1)));
+  uint8x16_t mid = veorq_u8(veorq_u8(clmul_mid(b0, h4), clmul_mid(b1, h3)),
+                            veorq_u8(clmul_mid(b2, h2), clmul_mid(b3, h1)));
+  lo = veorq_u8(lo, vextq_u8(zero, mid, 8));
+  hi = veorq_u8(hi, vextq_u8(mid, zero, 8));
+  return gfmul_reduce(lo, hi);
+}
+
+/* aes_encrypt_block encrypts one block with |key|; it is used to derive
+ * H = E(K, 0^128) so that the kernel does not depend on the layout of any
+ * particular serialized Htable. */
+static TARGET_CRYPTO uint8x16_t aes_encrypt_block(uint8x16_t block,
+                                                  const uint8x16_t *rk,
+                                                  unsigned rounds) {
+  for (unsigned i = 0; i < rounds - 1; ++i) {
+    block = vaesmcq_u8(vaeseq_u8(block, rk[i]));
+  }
+  return veorq_u8(vaeseq_u8(block, rk[rounds - 1]), rk[rounds]);
+}
+
+static TARGET_CRYPTO size_t aesv8_gcm_crypt(const uint8_t *in, uint8_t *out,
+                                            size_t len, const AES_KEY *key,
+                                            uint8_t ivec[16], uint8_t Xi[16],
+                                            int enc) {
+  size_t bulk = len & ~(size_t)63;
+  if (bulk < AESV8_GCM_MIN_LEN) {
+    return 0;
+  }
+
+  uint8x16_t rk[15];
+  unsigned rounds = (unsigned)key->rounds;
+  for (unsigned i = 0; i <= rounds; ++i) {
+    rk[i] = vld1q_u8((const uint8_t *)&key->rd_key[4 * i]);
+  }
+
+  /* Derive H and its powers in the twisted representation; the
+   * multiply-by-x is the |REDUCE1BIT| twist from gcm.c. */
+  uint8x16_t h_be = aes_encrypt_block(vdupq_n_u8(0), rk, rounds);
+  alignas(16) uint8_t h_bytes[16];
+  vst1q_u8(h_bytes, h_be);
+  uint64_t h_hi = from_be_u64_ptr(h_bytes);
+  uint64_t h_lo = from_be_u64_ptr(h_bytes + 8);
+  uint64_t carry = h_hi >> 63;
+  h_hi = (h_hi << 1) | (h_lo >> 63);
+  h_lo <<= 1;
+  h_hi ^= carry * UINT64_C(0xc200000000000000);
+  h_lo ^= carry;
+  uint8x16_t h1 = vreinterpretq_u8_u64(
+      vsetq_lane_u64(h_hi, vdupq_n_u64(h_lo), 1));
+  uint8x16_t h2 = gfmul_128(h1, h1);
+  uint8x16_t h3 = gfmul_128(h2, h1);
+  uint8x16_t h4 = gfmul_128(h3, h1);
+
+  uint8x16_t y = vld1q_u8(ivec);
+  uint32_t ctr = from_be_u32_ptr(ivec + 12);
+  uint8x16_t acc = bswap_128(vld1q_u8(Xi));
+
+  for (size_t done = 0; done < bulk; done += 64) {
+    uint8x16_t s0 = vreinterpretq_u8_u32(vsetq_lane_u32(
+        __builtin_bswap32(ctr), vreinterpretq_u32_u8(y), 3));
+    uint8x16_t s1 = vreinterpretq_u8_u32(vsetq_lane_u32(
+        __builtin_bswap32(ctr + 1), vreinterpretq_u32_u8(y), 3));
+    uint8x16_t s2 = vreinterpretq_u8_u32(vsetq_lane_u32(
+        __builtin_bswap32(ctr + 2), vreinterpretq_u32_u8(y), 3));
+    uint8x16_t s3 = vreinterpretq_u8_u32(vsetq_lane_u32(
+        __builtin_bswap32(ctr + 3), vreinterpretq_u32_u8(y), 3));
+    ctr += 4;
+
+    /* Keep the four pipelines interleaved so the AESE/AESMC fusion and the
+     * PMULL unit stay busy together. */
+    for (unsigned i = 0; i < rounds - 1; ++i) {
+      s0 = vaesmcq_u8(vaeseq_u8(s0, rk[i]));
+      s1 = vaesmcq_u8(vaeseq_u8(s1, rk[i]));
+      s2 = vaesmcq_u8(vaeseq_u8(s2, rk[i]));
+      s3 = vaesmcq_u8(vaeseq_u8(s3, rk[i]));
+    }
+    s0 = veorq_u8(vaeseq_u8(s0, rk[rounds - 1]), rk[rounds]);
+    s1 = veorq_u8(vaeseq_u8(s1, rk[rounds - 1]), rk[rounds]);
+    s2 = veorq_u8(vaeseq_u8(s2, rk[rounds - 1]), rk[rounds]);
+    s3 = veorq_u8(vaeseq_u8(s3, rk[rounds - 1]), rk[rounds]);
+
+    uint8x16_t in0 = vld1q_u8(in + done);
+    uint8x16_t in1 = vld1q_u8(in + done + 16);
+    uint8x16_t in2 = vld1q_u8(in + done + 32);
+    uint8x16_t in3 = vld1q_u8(in + done + 48);
+    uint8x16_t out0 = veorq_u8(s0, in0);
+    uint8x16_t out1 = veorq_u8(s1, in1);
+    uint8x16_t out2 = veorq_u8(s2, in2);
+    uint8x16_t out3 = veorq_u8(s3, in3);
+    vst1q_u8(out + done, out0);
+    vst1q_u8(out + done + 16, out1);
+    vst1q_u8(out + done + 32, out2);
+    vst1q_u8(out + done + 48, out3);
+
+    /* GHASH is always over the ciphertext. */
+    uint8x16_t a0 = enc ? out0 : in0;
+    uint8x16_t a1 = enc ? out1 : in1;
+    uint8x16_t a2 = enc ? out2 : in2;
+    uint8x16_t a3 = enc ? out3 : in3;
+    acc = ghash_4(acc, bswap_128(a0), bswap_128(a1), bswap_128(a2),
+                  bswap_128(a3), h4, h3, h2, h1);
+  }
+
+  vst1q_u8(Xi, bswap_128(acc));
+  to_be_u32_ptr(ivec + 12, ctr);
+  return bulk;
+}
+
+size_t GFp_aesv8_gcm_encrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]) {
+  return aesv8_gcm_crypt(in, out, len, key, ivec, Xi, 1);
+}
+
+size_t GFp_aesv8_gcm_decrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]) {
+  return aesv8_gcm_crypt(in, out, len, key, ivec, Xi, 0);
+}
+
+#else
+
+/* Stubs so that the dispatch code links on toolchains that cannot compile
+ * the Crypto Extensions intrinsics; |GFp_aesv8_gcm_capable| returning zero
+ * keeps them unreachable. */
+
+int GFp_aesv8_gcm_capable(void) { return 0; }
+
+size_t GFp_aesv8_gcm_encrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]) {
+  (void)in;
+  (void)out;
+  (void)len;
+  (void)key;
+  (void)ivec;
+  (void)Xi;
+  return 0;
+}
+
+size_t GFp_aesv8_gcm_decrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]) {
+  (void)in;
+  (void)out;
+  (void)len;
+  (void)key;
+  (void)ivec;
+  (void)Xi;
+  return 0;
+}
+
+#endif /* AESV8_GCM_IMPLEMENTED */
@@ -294,6 +294,10 @@ size_t GFp_aesni_gcm_encrypt(const uint8_t *in, uint8_t *out, size_t len,
                              const void *key, uint8_t ivec[16], uint8_t Xi[16]);
 size_t GFp_aesni_gcm_decrypt(const uint8_t *in, uint8_t *out, size_t len,
                              const void *key, uint8_t ivec[16], uint8_t Xi[16]);
+
+/* The VAES/VPCLMULQDQ stitched kernel (aesni-gcm-avx512.c) has the same
+ * contract as |GFp_aesni_gcm_encrypt|: it may not process all (or any) of its
+ * input. It is only used when |aesni_gcm_enabled| also holds. */
 #endif
 
 #if defined(OPENSSL_X86)
@@ -314,11 +318,27 @@ void GFp_gcm_init_v8(u128 Htable[16], const uint64_t Xi[2]);
 void GFp_gcm_gmult_v8(uint8_t Xi[16], const u128 Htable[16]);
 void GFp_gcm_ghash_v8(uint8_t Xi[16], const u128 Htable[16], const uint8_t *inp,
                       size_t len);
+
+#if defined(OPENSSL_AARCH64)
+#define AESV8_GCM
+void GFp_aes_hw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                     size_t blocks, const AES_KEY *key,
+                                     const uint8_t *ivec);
+/* The stitched AES+PMULL kernel (aesv8-gcm-armv8.c) has the same contract as
+ * |GFp_aesni_gcm_encrypt|: it may not process all (or any) of its input. */
+static int aesv8_gcm_enabled(GCM128_CONTEXT *ctx, aes_ctr_f stream) {
+  return stream == GFp_aes_hw_ctr32_encrypt_blocks &&
+         ctx->ghash == GFp_gcm_ghash_v8 && GFp_aesv8_gcm_capable();
+}
+#endif
 #endif
 
-#if defined(OPENSSL_ARM) && __ARM_MAX_ARCH__ >= 7
+#if (defined(OPENSSL_ARM) && __ARM_MAX_ARCH__ >= 7) || \
+    defined(OPENSSL_AARCH64)
 #define GCM_FUNCREF_4BIT
-/* 32-bit ARM also has support for doing GCM with NEON instructions. */
+/* GCM with NEON polynomial multiplies, for CPUs without PMULL: assembly
+ * (ghash-armv4.pl) on 32-bit ARM, intrinsics (ghash-neon-armv8.c) on
+ * AArch64. Unlike the 4-bit table code, these are constant-time. */
 void GFp_gcm_init_neon(u128 Htable[16], const uint64_t Xi[2]);
 void GFp_gcm_gmult_neon(uint8_t Xi[16], const u128 Htable[16]);
 void GFp_gcm_ghash_neon(uint8_t Xi[16], const u128 Htable[16],
@@ -347,10 +367,10 @@ void GFp_gcm_ghash_p8(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
 
 static void gcm128_init_htable(u128 Htable[GCM128_HTABLE_LEN],
                                const uint64_t H[2]);
+static void gcm128_init_gmult_ghash(GCM128_CONTEXT *ctx);
 
-void GFp_gcm128_init_serialized(
-    uint8_t serialized_ctx[GCM128_SERIALIZED_LEN], const AES_KEY *key,
-    aes_block_f block) {
+void GFp_gcm128_init_template(uint8_t *template_out, size_t template_len,
+                              const AES_KEY *key, aes_block_f block) {
   static const alignas(16) uint8_t ZEROS[16] = { 0 };
   uint8_t H_be[16];
   (*block)(ZEROS, H_be, key);
@@ -360,13 +380,17 @@ void GFp_gcm128_init_serialized(
   H[0] = from_be_u64_ptr(H_be);
   H[1] = from_be_u64_ptr(H_be + 8);
 
-  alignas(16) u128 Htable[GCM128_HTABLE_LEN];
-  gcm128_init_htable(Htable, H);
-
-  OPENSSL_COMPILE_ASSERT(sizeof(Htable) == GCM128_SERIALIZED_LEN,
-                         GCM128_SERIALIZED_LEN_is_wrong);
+  alignas(16) GCM128_CONTEXT ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  gcm128_init_htable(ctx.Htable, H);
+  ctx.block = block;
+  gcm128_init_gmult_ghash(&ctx);
 
-  memcpy(serialized_ctx, Htable, GCM128_SERIALIZED_LEN);
+  assert(template_len >= sizeof(ctx));
+  if (template_len < sizeof(ctx)) {
+    return;
+  }
+  memcpy(template_out, &ctx, sizeof(ctx));
 }
 
 static void gcm128_init_htable(u128 Htable[GCM128_HTABLE_LEN],
@@ -391,7 +415,7 @@ static void gcm128_init_htable(u128 Htable[GCM128_HTABLE_LEN],
     return;
   }
 #endif
-#if defined(OPENSSL_ARM)
+#if defined(OPENSSL_ARM) || defined(OPENSSL_AARCH64)
   if (GFp_is_NEON_capable()) {
     GFp_gcm_init_neon(Htable, H);
     return;
@@ -431,7 +455,7 @@ static void gcm128_init_gmult_ghash(GCM128_CONTEXT *ctx) {
     return;
   }
 #endif
-#if defined(OPENSSL_ARM)
+#if defined(OPENSSL_ARM) || defined(OPENSSL_AARCH64)
   if (GFp_is_NEON_capable()) {
     ctx->gmult = GFp_gcm_gmult_neon;
     ctx->ghash = GFp_gcm_ghash_neon;
@@ -455,36 +479,32 @@ static void gcm128_init_gmult_ghash(GCM128_CONTEXT *ctx) {
 #endif
 }
 
-void GFp_gcm128_init(GCM128_CONTEXT *ctx, const AES_KEY *key,
-                        aes_block_f block,
-                        const uint8_t serialized_ctx[GCM128_SERIALIZED_LEN],
-                        const uint8_t *iv) {
+void GFp_gcm128_start(GCM128_CONTEXT *ctx, const uint8_t *serialized_template,
+                      const AES_KEY *key, const uint8_t *iv) {
   uint32_t ctr = 1;
 
-  memset(ctx, 0, sizeof(*ctx));
+  /* The template already has the Htable, the |gmult|/|ghash|/|block|
+   * selection, and zeroed per-nonce state; only the nonce-dependent state
+   * needs to be computed here. */
+  memcpy(ctx, serialized_template, sizeof(*ctx));
   memcpy(ctx->Yi, iv, 12);
   to_be_u32_ptr(ctx->Yi + 12, ctr);
-  (block)(ctx->Yi, ctx->EK0, key);
+  (*ctx->block)(ctx->Yi, ctx->EK0, key);
   ++ctr;
   to_be_u32_ptr(ctx->Yi + 12, ctr);
-
-  OPENSSL_COMPILE_ASSERT(sizeof(ctx->Htable) == GCM128_SERIALIZED_LEN,
-                         GCM128_SERIALIZED_LEN_is_wrong);
-
-  memcpy(ctx->Htable, serialized_ctx, GCM128_SERIALIZED_LEN);
-  ctx->block = block;
-  gcm128_init_gmult_ghash(ctx);
 }
 
 int GFp_gcm128_aad(GCM128_CONTEXT *ctx, const uint8_t *aad, size_t len) {
-  assert(ctx->len.u[0] == 0);
+  /* All of the AAD must be processed before any payload is encrypted or
+   * decrypted. The AAD may be split across multiple calls as long as every
+   * call but the last passes a multiple of 16 bytes. */
   assert(ctx->len.u[1] == 0);
 
 #ifdef GCM_FUNCREF_4BIT
   gcm128_gmult_f gcm_gmult_p = ctx->gmult;
 #endif
 
-  ctx->len.u[0] = len;
+  ctx->len.u[0] += len;
   if (ctx->len.u[0] > (UINT64_C(1) << 61)) {
     return 0;
   }
@@ -509,8 +529,6 @@ int GFp_gcm128_aad(GCM128_CONTEXT *ctx, const uint8_t *aad, size_t len) {
 int GFp_gcm128_encrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
                           const unsigned char *in, unsigned char *out,
                           size_t len) {
-  assert(ctx->len.u[1] == 0);
-
   unsigned int ctr;
   size_t i;
   aes_block_f block = ctx->block;
@@ -521,7 +539,7 @@ int GFp_gcm128_encrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
 #endif
 #endif
 
-  ctx->len.u[1] = len;
+  ctx->len.u[1] += len;
   if (ctx->len.u[1] > ((UINT64_C(1) << 36) - 32)) {
     return 0;
   }
@@ -595,8 +613,6 @@ int GFp_gcm128_encrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
 int GFp_gcm128_decrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
                           const unsigned char *in, unsigned char *out,
                           size_t len) {
-  assert(ctx->len.u[1] == 0);
-
   unsigned int ctr;
   size_t i;
   aes_block_f block = ctx->block;
@@ -607,7 +623,7 @@ int GFp_gcm128_decrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
 #endif
 #endif
 
-  ctx->len.u[1] = len;
+  ctx->len.u[1] += len;
   if (ctx->len.u[1] > ((UINT64_C(1) << 36) - 32)) {
     return 0;
   }
@@ -683,8 +699,6 @@ int GFp_gcm128_decrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
 int GFp_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
                                 const uint8_t *in, uint8_t *out, size_t len,
                                 aes_ctr_f stream) {
-  assert(ctx->len.u[1] == 0);
-
   unsigned int ctr;
 #ifdef GCM_FUNCREF_4BIT
   gcm128_gmult_f gcm_gmult_p = ctx->gmult;
@@ -693,7 +707,7 @@ int GFp_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
 #endif
 #endif
 
-  ctx->len.u[1] = len;
+  ctx->len.u[1] += len;
   if (ctx->len.u[1] > ((UINT64_C(1) << 36) - 32)) {
     return 0;
   }
@@ -702,7 +716,20 @@ int GFp_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
   if (aesni_gcm_enabled(ctx, stream)) {
     /* |aesni_gcm_encrypt| may not process all the input given to it. It may
      * not process *any* of its input if it is deemed too small. */
-    size_t bulk = GFp_aesni_gcm_encrypt(in, out, len, key, ctx->Yi, ctx->Xi);
+    size_t bulk;
+    if (GFp_aesni_gcm_avx512_capable()) {
+      bulk = GFp_aesni_gcm_encrypt_avx512(in, out, len, key, ctx->Yi, ctx->Xi);
+    } else {
+      bulk = GFp_aesni_gcm_encrypt(in, out, len, key, ctx->Yi, ctx->Xi);
+    }
+    in += bulk;
+    out += bulk;
+    len -= bulk;
+  }
+#endif
+#if defined(AESV8_GCM)
+  if (aesv8_gcm_enabled(ctx, stream)) {
+    size_t bulk = GFp_aesv8_gcm_encrypt(in, out, len, key, ctx->Yi, ctx->Xi);
     in += bulk;
     out += bulk;
     len -= bulk;
@@ -762,8 +789,6 @@ int GFp_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
 int GFp_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
                                 const uint8_t *in, uint8_t *out, size_t len,
                                 aes_ctr_f stream) {
-  assert(ctx->len.u[1] == 0);
-
   unsigned int ctr;
 #ifdef GCM_FUNCREF_4BIT
   gcm128_gmult_f gcm_gmult_p = ctx->gmult;
@@ -772,7 +797,7 @@ int GFp_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
 #endif
 #endif
 
-  ctx->len.u[1] = len;
+  ctx->len.u[1] += len;
   if (ctx->len.u[1] > ((UINT64_C(1) << 36) - 32)) {
     return 0;
   }
@@ -781,7 +806,20 @@ int GFp_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
   if (aesni_gcm_enabled(ctx, stream)) {
     /* |aesni_gcm_decrypt| may not process all the input given to it. It may
      * not process *any* of its input if it is deemed too small. */
-    size_t bulk = GFp_aesni_gcm_decrypt(in, out, len, key, ctx->Yi, ctx->Xi);
+    size_t bulk;
+    if (GFp_aesni_gcm_avx512_capable()) {
+      bulk = GFp_aesni_gcm_decrypt_avx512(in, out, len, key, ctx->Yi, ctx->Xi);
+    } else {
+      bulk = GFp_aesni_gcm_decrypt(in, out, len, key, ctx->Yi, ctx->Xi);
+    }
+    in += bulk;
+    out += bulk;
+    len -= bulk;
+  }
+#endif
+#if defined(AESV8_GCM)
+  if (aesv8_gcm_enabled(ctx, stream)) {
+    size_t bulk = GFp_aesv8_gcm_decrypt(in, out, len, key, ctx->Yi, ctx->Xi);
     in += bulk;
     out += bulk;
     len -= bulk;
@@ -843,6 +881,42 @@ int GFp_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const AES_KEY *key,
   return 1;
 }
 
+int GFp_gcm128_ghash(GCM128_CONTEXT *ctx, const uint8_t *in, size_t len) {
+#ifdef GCM_FUNCREF_4BIT
+  gcm128_gmult_f gcm_gmult_p = ctx->gmult;
+#ifdef GHASH
+  gcm128_ghash_f gcm_ghash_p = ctx->ghash;
+#endif
+#endif
+
+  ctx->len.u[1] += len;
+  if (ctx->len.u[1] > ((UINT64_C(1) << 36) - 32)) {
+    return 0;
+  }
+
+  size_t aligned = len & kSizeTWithoutLower4Bits;
+#if defined(GHASH)
+  if (aligned != 0) {
+    GHASH(ctx, in, aligned);
+  }
+#else
+  for (size_t j = 0; j < aligned; j += 16) {
+    for (size_t i = 0; i < 16; ++i) {
+      ctx->Xi[i] ^= in[j + i];
+    }
+    GCM_MUL(ctx, Xi);
+  }
+#endif
+  if (len > aligned) {
+    for (size_t i = 0; i < len - aligned; ++i) {
+      ctx->Xi[i] ^= in[aligned + i];
+    }
+    GCM_MUL(ctx, Xi);
+  }
+
+  return 1;
+}
+
 void GFp_gcm128_tag(GCM128_CONTEXT *ctx, uint8_t tag[16]) {
   uint64_t alen = ctx->len.u[0] << 3;
   uint64_t clen = ctx->len.u[1] << 3;
@@ -873,3 +947,46 @@ int GFp_gcm_clmul_enabled(void) {
 #endif
 }
 #endif
+
+/* GFp_gcm_impl_id reports which GHASH implementation
+ * |gcm128_init_gmult_ghash| selects on this machine; it is only called by the
+ * (optional) dispatch instrumentation in src/dispatch.rs. Keep the mapping in
+ * sync with |gcm128_init_gmult_ghash| and with |gcm_impl_name| in
+ * src/dispatch.rs:
+ *   0 = 4bit, 1 = 4bit_mmx, 2 = neon, 3 = v8 (PMULL), 4 = clmul,
+ *   5 = avx (CLMUL + AVX + MOVBE), 6 = p8 (vcrypto). */
+int GFp_gcm_impl_id(void);
+
+int GFp_gcm_impl_id(void) {
+#if defined(GHASH_ASM_X86_64) || defined(GHASH_ASM_X86)
+  if (GFp_gcm_clmul_enabled()) {
+#if defined(GHASH_ASM_X86_64)
+    if (((GFp_ia32cap_P[1] >> 22) & 0x41) == 0x41) { /* AVX+MOVBE */
+      return 5;
+    }
+#endif
+    return 4;
+  }
+#endif
+#if defined(ARM_PMULL_ASM)
+  if (GFp_is_ARMv8_PMULL_capable()) {
+    return 3;
+  }
+#endif
+#if defined(OPENSSL_ARM) || defined(OPENSSL_AARCH64)
+  if (GFp_is_NEON_capable()) {
+    return 2;
+  }
+#endif
+#if defined(GHASH_ASM_PPC64LE)
+  if (CRYPTO_is_PPC64LE_vcrypto_capable()) {
+    return 6;
+  }
+#endif
+
+#if defined(GHASH_ASM_X86)
+  return 1;
+#else
+  return 0;
+#endif
+}
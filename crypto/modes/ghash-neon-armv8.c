@@ -0,0 +1,189 @@
+/* Copyright 2017 Brian Smith.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. */
+
+/* Constant-time NEON GHASH for AArch64 CPUs *without* the Crypto Extensions
+ * (e.g. Cortex-A53/A72 parts as shipped in the Raspberry Pi 3/4). Those cores
+ * have no PMULL, so they previously fell back to |gcm_gmult_4bit|'s 256-byte
+ * per-key table, whose data-dependent loads leak through the cache.
+ *
+ * This is a port of the VMULL.P8 kernel in ghash-armv4.pl (which covers
+ * 32-bit ARM only) to AArch64 via intrinsics. Each 64x64 carry-less multiply
+ * is synthesized from eight 8x8 polynomial multiplies using the scheme of
+ * Câmara, Fuentes, Gouvêa, López and Rodríguez: the byte-rotated partial
+ * products are folded with three mask-and-shift steps so every step is
+ * straight-line vector arithmetic -- no tables, no secret-dependent
+ * addressing. The 128-bit multiply on top is a Karatsuba combination with
+ * the same multiply-by-x "twist" of H and two-phase 0xc2 reduction used by
+ * the PMULL and CLMUL kernels. */
+
+#include <GFp/base.h>
+
+#include <assert.h>
+
+#include <GFp/cpu.h>
+
+#include "internal.h"
+
+/* Prototypes to avoid -Wmissing-prototypes warnings. The dispatch code in
+ * gcm.c declares these itself, matching the assembly implementations that
+ * cover the same names on 32-bit ARM. */
+void GFp_gcm_init_neon(u128 Htable[16], const uint64_t Xi[2]);
+void GFp_gcm_gmult_neon(uint8_t Xi[16], const u128 Htable[16]);
+void GFp_gcm_ghash_neon(uint8_t Xi[16], const u128 Htable[16],
+                        const uint8_t *inp, size_t len);
+
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_AARCH64)
+
+#include <arm_neon.h>
+
+/* bswap_128 reverses the bytes of a 128-bit vector, converting between the
+ * GCM byte serialization and the host-order 64-bit halves the multiplies
+ * operate on. */
+static uint8x16_t bswap_128(uint8x16_t x) {
+  uint8x16_t swapped = vrev64q_u8(x);
+  return vextq_u8(swapped, swapped, 8);
+}
+
+/* pmull64 computes the 128-bit carry-less product of the 64-bit polynomials
+ * |a| and |b| without PMULL, from eight VMULL.P8 partial products. Mirrors
+ * |clmul64x64| in ghash-armv4.pl; see the comment at the top of the file. */
+static uint64x2_t pmull64(poly8x8_t a, poly8x8_t b) {
+  uint8x16_t t0, t1, t2, t3, r;
+
+  t0 = vreinterpretq_u8_p16(vmull_p8(vext_p8(a, a, 1), b)); /* F = A1*B */
+  r = vreinterpretq_u8_p16(vmull_p8(a, vext_p8(b, b, 1)));  /* E = A*B1 */
+  t0 = veorq_u8(t0, r);                                     /* L = E + F */
+  t1 = vreinterpretq_u8_p16(vmull_p8(vext_p8(a, a, 2), b)); /* H = A2*B */
+  r = vreinterpretq_u8_p16(vmull_p8(a, vext_p8(b, b, 2)));  /* G = A*B2 */
+  t1 = veorq_u8(t1, r);                                     /* M = G + H */
+  t2 = vreinterpretq_u8_p16(vmull_p8(vext_p8(a, a, 3), b)); /* J = A3*B */
+  r = vreinterpretq_u8_p16(vmull_p8(a, vext_p8(b, b, 3)));  /* I = A*B3 */
+  t2 = veorq_u8(t2, r);                                     /* N = I + J */
+  t3 = vreinterpretq_u8_p16(vmull_p8(a, vext_p8(b, b, 4))); /* K = A*B4 */
+
+  /* Each partial product tX is reduced modulo the wrap-around its byte
+   * rotation would otherwise cause: fold the high half into the low half,
+   * mask off the bits that belong in the high half, and rotate into
+   * position. |mask| is 0 for t3, whose high half is discarded entirely. */
+#define PMULL64_FOLD(t, mask, rot)                                \
+  do {                                                            \
+    uint64x1_t lo_ = vget_low_u64(vreinterpretq_u64_u8(t));       \
+    uint64x1_t hi_ = vget_high_u64(vreinterpretq_u64_u8(t));      \
+    lo_ = veor_u64(lo_, hi_);                                     \
+    hi_ = vand_u64(hi_, vcreate_u64(mask));                       \
+    lo_ = veor_u64(lo_, hi_);                                     \
+    (t) = vreinterpretq_u8_u64(vcombine_u64(lo_, hi_));           \
+    (t) = vextq_u8((t), (t), (rot));                              \
+  } while (0)
+
+  PMULL64_FOLD(t0, UINT64_C(0x0000ffffffffffff), 15); /* (L) << 8 */
+  PMULL64_FOLD(t1, UINT64_C(0x00000000ffffffff), 14); /* (M) << 16 */
+  PMULL64_FOLD(t2, UINT64_C(0x000000000000ffff), 13); /* (N) << 24 */
+  PMULL64_FOLD(t3, UINT64_C(0), 12);                  /* (K) << 32 */
+
+#undef PMULL64_FOLD
+
+  r = vreinterpretq_u8_p16(vmull_p8(a, b)); /* D = A*B */
+  r = veorq_u8(r, veorq_u8(t0, t1));
+  r = veorq_u8(r, veorq_u8(t2, t3));
+  return vreinterpretq_u64_u8(r);
+}
+
+/* gcm_polymul_neon returns |X| * H in the reflected representation, where
+ * lane 0 of |X| holds the low 64 bits. |h_mid| is the Karatsuba
+ * pre-processed |h_lo ^ h_hi|. */
+static uint64x2_t gcm_polymul_neon(uint64x2_t X, poly8x8_t h_lo,
+                                   poly8x8_t h_hi, poly8x8_t h_mid) {
+  poly8x8_t in_lo = vreinterpret_p8_u64(vget_low_u64(X));
+  poly8x8_t in_hi = vreinterpret_p8_u64(vget_high_u64(X));
+
+  uint64x2_t Xl = pmull64(h_lo, in_lo); /* H.lo * Xi.lo */
+  uint64x2_t Xm =
+      pmull64(h_mid, vreinterpret_p8_u8(veor_u8(vreinterpret_u8_p8(in_lo),
+                                                vreinterpret_u8_p8(in_hi))));
+  uint64x2_t Xh = pmull64(h_hi, in_hi); /* H.hi * Xi.hi */
+
+  /* Karatsuba post-processing: Xh|Xl is the 256-bit product. */
+  Xm = veorq_u64(Xm, veorq_u64(Xl, Xh));
+  Xl = vcombine_u64(vget_low_u64(Xl),
+                    veor_u64(vget_high_u64(Xl), vget_low_u64(Xm)));
+  Xh = vcombine_u64(veor_u64(vget_low_u64(Xh), vget_high_u64(Xm)),
+                    vget_high_u64(Xh));
+
+  /* 1st reduction phase (equivalent of reduction_avx from ghash-x86_64.pl) */
+  uint64x2_t t = veorq_u64(veorq_u64(vshlq_n_u64(Xl, 57), vshlq_n_u64(Xl, 62)),
+                           vshlq_n_u64(Xl, 63));
+  Xl = vcombine_u64(vget_low_u64(Xl),
+                    veor_u64(vget_high_u64(Xl), vget_low_u64(t)));
+  Xh = vcombine_u64(veor_u64(vget_low_u64(Xh), vget_high_u64(t)),
+                    vget_high_u64(Xh));
+
+  /* 2nd reduction phase */
+  t = vshrq_n_u64(Xl, 1);
+  Xh = veorq_u64(Xh, Xl);
+  Xl = veorq_u64(Xl, t);
+  t = vshrq_n_u64(t, 6);
+  Xl = vshrq_n_u64(Xl, 1);
+  Xl = veorq_u64(Xl, Xh);
+  Xl = veorq_u64(Xl, t);
+
+  return Xl;
+}
+
+void GFp_gcm_init_neon(u128 Htable[16], const uint64_t Xi[2]) {
+  /* The layout of |Htable| is private between here and
+   * |GFp_gcm_gmult_neon| / |GFp_gcm_ghash_neon|; only Htable[0] is used,
+   * holding H <<< 1 with the 0xc2...01 twist conditionally folded in. */
+  uint64_t hi = Xi[0];
+  uint64_t lo = Xi[1];
+  uint64_t carry_mask = (uint64_t)((int64_t)hi >> 63);
+  uint64_t twisted_hi = (hi << 1) | (lo >> 63);
+  uint64_t twisted_lo = lo << 1;
+  twisted_hi ^= UINT64_C(0xc200000000000000) & carry_mask;
+  twisted_lo ^= UINT64_C(1) & carry_mask;
+  Htable[0].hi = twisted_hi;
+  Htable[0].lo = twisted_lo;
+}
+
+void GFp_gcm_gmult_neon(uint8_t Xi[16], const u128 Htable[16]) {
+  poly8x8_t h_lo = vreinterpret_p8_u64(vcreate_u64(Htable[0].lo));
+  poly8x8_t h_hi = vreinterpret_p8_u64(vcreate_u64(Htable[0].hi));
+  poly8x8_t h_mid = vreinterpret_p8_u8(
+      veor_u8(vreinterpret_u8_p8(h_lo), vreinterpret_u8_p8(h_hi)));
+
+  uint64x2_t X = vreinterpretq_u64_u8(bswap_128(vld1q_u8(Xi)));
+  X = gcm_polymul_neon(X, h_lo, h_hi, h_mid);
+  vst1q_u8(Xi, bswap_128(vreinterpretq_u8_u64(X)));
+}
+
+void GFp_gcm_ghash_neon(uint8_t Xi[16], const u128 Htable[16],
+                        const uint8_t *inp, size_t len) {
+  assert(len % 16 == 0);
+
+  poly8x8_t h_lo = vreinterpret_p8_u64(vcreate_u64(Htable[0].lo));
+  poly8x8_t h_hi = vreinterpret_p8_u64(vcreate_u64(Htable[0].hi));
+  poly8x8_t h_mid = vreinterpret_p8_u8(
+      veor_u8(vreinterpret_u8_p8(h_lo), vreinterpret_u8_p8(h_hi)));
+
+  uint64x2_t X = vreinterpretq_u64_u8(bswap_128(vld1q_u8(Xi)));
+  while (len >= 16) {
+    uint64x2_t in = vreinterpretq_u64_u8(bswap_128(vld1q_u8(inp)));
+    X = gcm_polymul_neon(veorq_u64(X, in), h_lo, h_hi, h_mid);
+    inp += 16;
+    len -= 16;
+  }
+  vst1q_u8(Xi, bswap_128(vreinterpretq_u8_u64(X)));
+}
+
+#endif /* !OPENSSL_NO_ASM && OPENSSL_AARCH64 */
@@ -72,8 +72,6 @@ typedef void (*gcm128_ghash_f)(uint8_t Xi[16], const u128 Htable[16],
 
 #define GCM128_HTABLE_LEN 16
 
-#define GCM128_SERIALIZED_LEN (GCM128_HTABLE_LEN * 16)
-
 /* This differs from OpenSSL's |gcm128_context| in that it does not have the
  * |key| pointer, in order to make it |memcpy|-friendly. See GFp/modes.h
  * for more info. */
@@ -122,29 +120,42 @@ typedef void (*aes_ctr_f)(const uint8_t *in, uint8_t *out, size_t blocks,
 
 typedef struct gcm128_context GCM128_CONTEXT;
 
-OPENSSL_EXPORT void GFp_gcm128_init_serialized(
-    uint8_t serialized_ctx[GCM128_SERIALIZED_LEN], const AES_KEY *key,
-    aes_block_f block);
-
-OPENSSL_EXPORT void GFp_gcm128_init(
-    GCM128_CONTEXT *ctx, const AES_KEY *key, aes_block_f block,
-    const uint8_t serialized_ctx[GCM128_SERIALIZED_LEN], const uint8_t *iv);
-
-/* GFp_gcm128_aad sets the authenticated data for an instance of GCM. This must
- * be called before and data is encrypted. It returns one on success and zero
+/* GFp_gcm128_init_template writes a fully-initialized |GCM128_CONTEXT| --
+ * Htable computed, |gmult|/|ghash|/|block| selected, per-nonce state zeroed
+ * -- into |template_out|. The template is an in-process serialization (it
+ * contains function pointers); it is stored once in the key object and reused
+ * by |GFp_gcm128_start| for every record sealed or opened under that key. */
+OPENSSL_EXPORT void GFp_gcm128_init_template(uint8_t *template_out,
+                                             size_t template_len,
+                                             const AES_KEY *key,
+                                             aes_block_f block);
+
+/* GFp_gcm128_start copies the template written by |GFp_gcm128_init_template|
+ * into |ctx| and computes only the nonce-dependent state (|Yi| and |EK0|). */
+OPENSSL_EXPORT void GFp_gcm128_start(GCM128_CONTEXT *ctx,
+                                     const uint8_t *serialized_template,
+                                     const AES_KEY *key, const uint8_t *iv);
+
+/* GFp_gcm128_aad processes authenticated data for an instance of GCM. All of
+ * the AAD must be processed before any data is encrypted or decrypted, but it
+ * may be split across multiple calls as long as every call but the last
+ * passes a multiple of 16 bytes. It returns one on success and zero
  * otherwise. */
 OPENSSL_EXPORT int GFp_gcm128_aad(GCM128_CONTEXT *ctx, const uint8_t *aad,
                                   size_t len);
 
 /* GFp_gcm128_encrypt encrypts |len| bytes from |in| to |out|. The |key| must
- * be the same key that was passed to |GFp_gcm128_init|. It returns one on
- * success and zero otherwise. */
+ * be the same key that was passed to |GFp_gcm128_start|. Like the other
+ * encrypt/decrypt functions, the payload may be processed incrementally
+ * across multiple calls as long as every call but the last passes a multiple
+ * of 16 bytes; otherwise the last (partial) block would be folded into the
+ * GHASH state prematurely. It returns one on success and zero otherwise. */
 OPENSSL_EXPORT int GFp_gcm128_encrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
                                       const uint8_t *in, uint8_t *out,
                                       size_t len);
 
 /* GFp_gcm128_decrypt decrypts |len| bytes from |in| to |out|. The |key| must
- * be the same key that was passed to |GFp_gcm128_init|. It returns one on
+ * be the same key that was passed to |GFp_gcm128_start|. It returns one on
  * success and zero otherwise. */
 OPENSSL_EXPORT int GFp_gcm128_decrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
                                       const uint8_t *in, uint8_t *out,
@@ -153,7 +164,7 @@ OPENSSL_EXPORT int GFp_gcm128_decrypt(GCM128_CONTEXT *ctx, const AES_KEY *key,
 /* GFp_gcm128_encrypt_ctr32 encrypts |len| bytes from |in| to |out| using a CTR
  * function that only handles the bottom 32 bits of the nonce, like
  * |GFp_ctr128_encrypt_ctr32|. The |key| must be the same key that was passed
- * to |GFp_gcm128_init|. It returns one on success and zero otherwise. */
+ * to |GFp_gcm128_start|. It returns one on success and zero otherwise. */
 OPENSSL_EXPORT int GFp_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx,
                                             const AES_KEY *key,
                                             const uint8_t *in, uint8_t *out,
@@ -162,12 +173,21 @@ OPENSSL_EXPORT int GFp_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx,
 /* GFp_gcm128_decrypt_ctr32 decrypts |len| bytes from |in| to |out| using a CTR
  * function that only handles the bottom 32 bits of the nonce, like
  * |GFp_ctr128_encrypt_ctr32|. The |key| must be the same key that was passed
- * to |GFp_gcm128_init|. It returns one on success and zero otherwise. */
+ * to |GFp_gcm128_start|. It returns one on success and zero otherwise. */
 OPENSSL_EXPORT int GFp_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx,
                                             const AES_KEY *key,
                                             const uint8_t *in, uint8_t *out,
                                             size_t len, aes_ctr_f stream);
 
+/* GFp_gcm128_ghash absorbs |len| bytes of ciphertext from |in| into the GHASH
+ * state and length bookkeeping without generating any keystream. This is for
+ * callers that produce the ciphertext themselves, e.g. by running the CTR
+ * mode counter ranges in parallel, and then authenticate it in one pass. The
+ * same incremental-call rules as for |GFp_gcm128_encrypt| apply. It returns
+ * one on success and zero otherwise. */
+OPENSSL_EXPORT int GFp_gcm128_ghash(GCM128_CONTEXT *ctx, const uint8_t *in,
+                                    size_t len);
+
 /* GFp_gcm128_tag calculates the authenticator and copies it into |tag|. */
 OPENSSL_EXPORT void GFp_gcm128_tag(GCM128_CONTEXT *ctx, uint8_t tag[16]);
 
@@ -179,6 +199,32 @@ void GFp_aesni_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
                                     const uint8_t *ivec);
 #endif
 
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_X86_64)
+/* The VAES/VPCLMULQDQ stitched encrypt+GHASH kernel in aesni-gcm-avx512.c.
+ * |GFp_aesni_gcm_avx512_capable| returns zero when the toolchain could not
+ * compile the kernel or the CPU/OS do not support AVX-512 with VAES. */
+int GFp_aesni_gcm_avx512_capable(void);
+size_t GFp_aesni_gcm_encrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]);
+size_t GFp_aesni_gcm_decrypt_avx512(const uint8_t *in, uint8_t *out,
+                                    size_t len, const AES_KEY *key,
+                                    uint8_t ivec[16], uint8_t Xi[16]);
+#endif
+
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_AARCH64)
+/* The stitched AES+PMULL encrypt+GHASH kernel in aesv8-gcm-armv8.c.
+ * |GFp_aesv8_gcm_capable| returns zero when the toolchain could not compile
+ * the kernel or the CPU lacks the Crypto Extensions. */
+int GFp_aesv8_gcm_capable(void);
+size_t GFp_aesv8_gcm_encrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]);
+size_t GFp_aesv8_gcm_decrypt(const uint8_t *in, uint8_t *out, size_t len,
+                             const AES_KEY *key, uint8_t ivec[16],
+                             uint8_t Xi[16]);
+#endif
+
 #if defined(__cplusplus)
 } /* extern C */
 #endif
@@ -442,6 +442,60 @@ __poly1305_init_avx:
 	ret
 .size	__poly1305_init_avx,.-__poly1305_init_avx
 
+########################################################################
+# void GFp_poly1305_init_table(void *ctx);
+#
+# Fills in the r^1..r^4 power table and sets is_base2_26 in a context
+# freshly initialized by GFp_poly1305_init_asm, so that the vectorized
+# code engages from the first poly1305_blocks_avx[2] call regardless of
+# the input length, instead of computing the table lazily on the first
+# >=128-byte call. Returns 1 if the table was filled in, 0 (leaving the
+# context unchanged) if this CPU doesn't use the vectorized code.
+
+.globl	GFp_poly1305_init_table
+.hidden	GFp_poly1305_init_table
+.type	GFp_poly1305_init_table,\@function,1
+.align	32
+GFp_poly1305_init_table:
+	xor	%eax,%eax
+	mov	GFp_ia32cap_P+4(%rip),%r9d
+	bt	\$`60-32`,%r9d		# AVX?
+	jnc	.Lno_table
+
+	push	%rbx
+	push	%rbp
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+.Linit_table_body:
+
+	mov	24($ctx),$r0		# load r
+	mov	32($ctx),$s1
+
+	mov	$s1,$r1
+	shr	\$2,$s1
+	add	$r1,$s1			# s1 = r1 + (r1 >> 2)
+
+	# The hash value was zeroed by GFp_poly1305_init_asm, and zero reads
+	# the same in base 2^26, so only the flag needs to be set.
+	movl	\$1,20($ctx)		# set is_base2_26
+
+	call	__poly1305_init_avx
+	mov	\$1,%eax
+
+	mov	0(%rsp),%r15
+	mov	8(%rsp),%r14
+	mov	16(%rsp),%r13
+	mov	24(%rsp),%r12
+	mov	32(%rsp),%rbp
+	mov	40(%rsp),%rbx
+	lea	48(%rsp),%rsp
+.Lno_table:
+.Linit_table_epilogue:
+	ret
+.size	GFp_poly1305_init_table,.-GFp_poly1305_init_table
+
 .type	poly1305_blocks_avx,\@function,4
 .align	32
 poly1305_blocks_avx:
@@ -2146,6 +2200,10 @@ avx_handler:
 	.rva	.LSEH_info_GFp_poly1305_emit
 ___
 $code.=<<___ if ($avx);
+	.rva	.LSEH_begin_GFp_poly1305_init_table
+	.rva	.LSEH_end_GFp_poly1305_init_table
+	.rva	.LSEH_info_GFp_poly1305_init_table
+
 	.rva	.LSEH_begin_poly1305_blocks_avx
 	.rva	.Lbase2_64_avx
 	.rva	.LSEH_info_poly1305_blocks_avx_1
@@ -2194,6 +2252,11 @@ $code.=<<___;
 	.rva	.LSEH_begin_GFp_poly1305_emit,.LSEH_begin_GFp_poly1305_emit
 ___
 $code.=<<___ if ($avx);
+.LSEH_info_GFp_poly1305_init_table:
+	.byte	9,0,0,0
+	.rva	se_handler
+	.rva	.Linit_table_body,.Linit_table_epilogue		# HandlerData[]
+
 .LSEH_info_poly1305_blocks_avx_1:
 	.byte	9,0,0,0
 	.rva	se_handler
@@ -0,0 +1,227 @@
+/* Copyright 2017 Brian Smith.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHORS DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. */
+
+/* Eight-buffer AVX2 SHA-256 kernel. Eight independent SHA-256 states advance
+ * in lockstep, with word |j| of all eight states (and of all eight message
+ * blocks) held in the eight 32-bit lanes of one YMM register, so every step
+ * of the compression function works on eight messages at once. Unlike the
+ * single-buffer SIMD paths in sha512-x86_64.pl, which can only vectorize the
+ * message schedule, this vectorizes the whole round function, which is where
+ * the aggregate-throughput win comes from.
+ *
+ * Like chacha-avx512.c this is written with compiler intrinsics; the
+ * Rust-level batching in src/digest/digest.rs only calls it (via
+ * |GFp_sha256_mb_avx2_capable|) and is responsible for padding and for
+ * keeping the eight lanes supplied with data. */
+
+#include <GFp/base.h>
+#include <GFp/cpu.h>
+
+#include "../internal.h"
+
+#define SHA256_MB_LANES 8
+
+/* Prototypes to satisfy -Wmissing-prototypes; the real declarations are the
+ * |extern| block in src/digest/digest.rs. */
+int GFp_sha256_mb_avx2_capable(void);
+void GFp_sha256_block_data_order_x8_avx2(
+    uint32_t *const states[SHA256_MB_LANES],
+    const uint8_t *const data[SHA256_MB_LANES], size_t num);
+
+#if !defined(OPENSSL_NO_ASM) && defined(OPENSSL_X86_64) &&  \
+    ((defined(__clang_major__) && __clang_major__ >= 4) ||  \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 5))
+#define SHA256_MB_AVX2_IMPLEMENTED
+#endif
+
+#if defined(SHA256_MB_AVX2_IMPLEMENTED)
+
+#include <immintrin.h>
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+int GFp_sha256_mb_avx2_capable(void) {
+  /* AVX2 (leaf 7 EBX bit 5). |GFp_cpuid_setup| clears the bit when the OS
+   * does not enable YMM state. */
+  return (GFp_ia32cap_P[2] & (1u << 5)) != 0;
+}
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static TARGET_AVX2 __m256i rotr32(__m256i x, int n) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n),
+                         _mm256_slli_epi32(x, 32 - n));
+}
+
+/* transpose_8x8 transposes the 8x8 matrix of 32-bit words held in |v|,
+ * turning eight per-lane rows into eight across-lane columns (and back, as
+ * it is its own inverse). */
+static TARGET_AVX2 void transpose_8x8(__m256i v[8]) {
+  __m256i t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+  __m256i t1 = _mm256_unpackhi_epi32(v[0], v[1]);
+  __m256i t2 = _mm256_unpacklo_epi32(v[2], v[3]);
+  __m256i t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+  __m256i t4 = _mm256_unpacklo_epi32(v[4], v[5]);
+  __m256i t5 = _mm256_unpackhi_epi32(v[4], v[5]);
+  __m256i t6 = _mm256_unpacklo_epi32(v[6], v[7]);
+  __m256i t7 = _mm256_unpackhi_epi32(v[6], v[7]);
+  __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+  __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+  __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+  __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+  __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+  __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+  __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+  __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+  v[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  v[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  v[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  v[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  v[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  v[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  v[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  v[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/* GFp_sha256_block_data_order_x8_avx2 processes, for each lane |i| in
+ * [0, 8), |num| consecutive 64-byte blocks from |data[i]| into the eight-word
+ * chaining value |states[i]|. Lanes are fully independent; several |states|
+ * entries may alias one another (the batching layer points idle lanes at a
+ * scratch state). */
+TARGET_AVX2 void GFp_sha256_block_data_order_x8_avx2(
+    uint32_t *const states[SHA256_MB_LANES],
+    const uint8_t *const data[SHA256_MB_LANES], size_t num) {
+  const __m256i bswap = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  const uint8_t *in[SHA256_MB_LANES];
+  __m256i s[8], w[16], blk[8];
+  size_t i;
+  int t;
+
+  for (i = 0; i < SHA256_MB_LANES; i++) {
+    in[i] = data[i];
+    s[i] = _mm256_loadu_si256((const __m256i *)states[i]);
+  }
+  transpose_8x8(s); /* s[j] = state word j across the eight lanes. */
+
+  while (num--) {
+    for (i = 0; i < 8; i++) {
+      blk[i] = _mm256_shuffle_epi8(
+          _mm256_loadu_si256((const __m256i *)in[i]), bswap);
+    }
+    transpose_8x8(blk);
+    for (t = 0; t < 8; t++) {
+      w[t] = blk[t];
+    }
+    for (i = 0; i < 8; i++) {
+      blk[i] = _mm256_shuffle_epi8(
+          _mm256_loadu_si256((const __m256i *)(in[i] + 32)), bswap);
+    }
+    transpose_8x8(blk);
+    for (t = 0; t < 8; t++) {
+      w[8 + t] = blk[t];
+    }
+
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+    for (t = 0; t < 64; t++) {
+      __m256i wt;
+      if (t < 16) {
+        wt = w[t];
+      } else {
+        __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+        __m256i s0 = _mm256_xor_si256(
+            _mm256_xor_si256(rotr32(w15, 7), rotr32(w15, 18)),
+            _mm256_srli_epi32(w15, 3));
+        __m256i s1 = _mm256_xor_si256(
+            _mm256_xor_si256(rotr32(w2, 17), rotr32(w2, 19)),
+            _mm256_srli_epi32(w2, 10));
+        wt = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+                              _mm256_add_epi32(w[(t - 7) & 15], s1));
+        w[t & 15] = wt;
+      }
+      __m256i S1 = _mm256_xor_si256(
+          _mm256_xor_si256(rotr32(e, 6), rotr32(e, 11)), rotr32(e, 25));
+      __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                    _mm256_andnot_si256(e, g));
+      __m256i t1 = _mm256_add_epi32(
+          _mm256_add_epi32(_mm256_add_epi32(h, S1), ch),
+          _mm256_add_epi32(_mm256_set1_epi32((int32_t)K256[t]), wt));
+      __m256i S0 = _mm256_xor_si256(
+          _mm256_xor_si256(rotr32(a, 2), rotr32(a, 13)), rotr32(a, 22));
+      __m256i maj = _mm256_xor_si256(
+          _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+          _mm256_and_si256(b, c));
+      __m256i t2 = _mm256_add_epi32(S0, maj);
+      h = g;
+      g = f;
+      f = e;
+      e = _mm256_add_epi32(d, t1);
+      d = c;
+      c = b;
+      b = a;
+      a = _mm256_add_epi32(t1, t2);
+    }
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+    s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g);
+    s[7] = _mm256_add_epi32(s[7], h);
+
+    for (i = 0; i < SHA256_MB_LANES; i++) {
+      in[i] += 64;
+    }
+  }
+
+  transpose_8x8(s);
+  for (i = 0; i < SHA256_MB_LANES; i++) {
+    _mm256_storeu_si256((__m256i *)states[i], s[i]);
+  }
+}
+
+#else /* !SHA256_MB_AVX2_IMPLEMENTED */
+
+/* Stubs so the symbols always exist. |GFp_sha256_mb_avx2_capable| returning
+ * zero keeps the kernel from ever being called; the forwarding body is for
+ * linkers that want a definition anyway. */
+
+void GFp_sha256_block_data_order(uint32_t *state, const uint8_t *data,
+                                 size_t num);
+
+int GFp_sha256_mb_avx2_capable(void) { return 0; }
+
+void GFp_sha256_block_data_order_x8_avx2(
+    uint32_t *const states[SHA256_MB_LANES],
+    const uint8_t *const data[SHA256_MB_LANES], size_t num) {
+  for (size_t i = 0; i < SHA256_MB_LANES; i++) {
+    GFp_sha256_block_data_order(states[i], data[i], num);
+  }
+}
+
+#endif /* SHA256_MB_AVX2_IMPLEMENTED */
@@ -233,6 +233,25 @@ OPENSSL_EXPORT int GFp_BN_mod_exp_mont_consttime(
     const BIGNUM *one_mont, const BIGNUM *n,
     const BN_ULONG n0[/*BN_MONT_CTX_N0_LIMBS*/]);
 
+/* GFp_BN_mod_exp_scratch_size returns the number of bytes of scratch space
+ * that |GFp_BN_mod_exp_mont_consttime_scratch| requires for a modulus of
+ * |top| words, or zero if |top| is too small. The result only grows with
+ * |top|, so scratch space sized for one modulus may be reused for any
+ * narrower modulus. */
+OPENSSL_EXPORT size_t GFp_BN_mod_exp_scratch_size(int top);
+
+/* GFp_BN_mod_exp_mont_consttime_scratch is like
+ * |GFp_BN_mod_exp_mont_consttime| except that the power table and the
+ * temporaries are placed in the caller-provided |scratch|, so it does no
+ * allocation. |scratch_len| must be at least
+ * |GFp_BN_mod_exp_scratch_size(n->top)| bytes. |scratch| does not need any
+ * particular alignment and is clobbered. */
+OPENSSL_EXPORT int GFp_BN_mod_exp_mont_consttime_scratch(
+    BIGNUM *rr, const BIGNUM *a_mont, const BIGNUM *p, size_t p_bits,
+    const BIGNUM *one_mont, const BIGNUM *n,
+    const BN_ULONG n0[/*BN_MONT_CTX_N0_LIMBS*/], uint8_t *scratch,
+    size_t scratch_len);
+
 
 /* Private functions */
 
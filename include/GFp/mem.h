@@ -85,6 +85,12 @@ extern "C" {
  * non-zero. */
 OPENSSL_EXPORT int GFp_memcmp(const void *a, const void *b, size_t len);
 
+/* GFp_memcmp_16 acts like |GFp_memcmp| with |len| == 16. Sixteen bytes is
+ * the tag length of every AEAD in the library, and on targets with SSE2 or
+ * NEON the comparison is a single vector load, compare, and branch-free mask
+ * reduction instead of a byte-at-a-time loop. */
+OPENSSL_EXPORT int GFp_memcmp_16(const void *a, const void *b);
+
 
 #if defined(__cplusplus)
 }  /* extern C */
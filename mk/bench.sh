@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+#
+# Copyright 2017 Brian Smith.
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND AND THE AUTHORS DISCLAIM ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+# SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+# OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+# Runs the in-tree benchmarks (benches/ and the internal_benches modules).
+# `#[bench]` requires Nightly Rust. Throughput benches report MB/s; divide
+# the CPU clock rate by that figure to get cycles/byte. Pass extra arguments
+# through to `cargo bench`, e.g. `mk/bench.sh aead::aes_128_gcm`.
+
+set -eux -o pipefail
+IFS=$'\n\t'
+
+cargo bench --features=internal_benches,rsa_signing "$@"
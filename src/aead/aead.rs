@@ -33,7 +33,7 @@ mod aes_gcm;
 use {constant_time, error, init, poly1305, polyfill};
 
 pub use self::chacha20_poly1305::CHACHA20_POLY1305;
-pub use self::aes_gcm::{AES_128_GCM, AES_256_GCM};
+pub use self::aes_gcm::{AES_128_GCM, AES_256_GCM, seal_in_place_parallel};
 
 /// A key for authenticating and decrypting (“opening”) AEAD-protected data.
 ///
@@ -152,10 +152,57 @@ pub fn open_in_place<'a>(key: &OpeningKey, nonce: &[u8], ad: &[u8],
         }
         return Err(error::Unspecified);
     }
+    record_open(key.key.algorithm, ciphertext_len);
     // `ciphertext_len` is also the plaintext length.
     Ok(&mut in_out[..ciphertext_len])
 }
 
+/// Authenticates and decrypts (“opens”) data in place, leaving the plaintext
+/// where the ciphertext was and with the tag in a detached buffer.
+///
+/// `in_out` is the ciphertext, *not* including the tag; `received_tag` is the
+/// tag, which must be exactly `key.algorithm().tag_len()` bytes long. On
+/// success the plaintext is returned, which is all of `in_out`, decrypted in
+/// place.
+///
+/// Unlike `open_in_place`, nothing is shifted: a caller whose records sit
+/// behind headers in a receive buffer can slice the buffer at the
+/// ciphertext's own offset and decrypt it there, instead of paying a move of
+/// every payload to the front. (`received_tag` may also point into the same
+/// receive buffer, e.g. via `split_at_mut`.)
+///
+/// When `open_in_place_detached()` returns `Err(..)`, the contents of
+/// `in_out` are zeroed, as with `open_in_place`.
+pub fn open_in_place_detached<'a>(key: &OpeningKey, nonce: &[u8], ad: &[u8],
+                                  in_out: &'a mut [u8], received_tag: &[u8])
+                                  -> Result<&'a mut [u8], error::Unspecified> {
+    let nonce = try!(slice_as_array_ref!(nonce, NONCE_LEN));
+    try!(check_per_nonce_max_bytes(in_out.len()));
+    let mut calculated_tag = [0u8; TAG_LEN];
+    try!((key.key.algorithm.open)(&key.key.ctx_buf, nonce, &ad, 0, in_out,
+                                  &mut calculated_tag));
+    if constant_time::verify_slices_are_equal(&calculated_tag, received_tag)
+            .is_err() {
+        // Zero out the plaintext so that it isn't accidentally leaked or used
+        // after verification fails; see `open_in_place`.
+        for b in in_out.iter_mut() {
+            *b = 0;
+        }
+        return Err(error::Unspecified);
+    }
+    record_open(key.key.algorithm, in_out.len());
+    Ok(in_out)
+}
+
+#[cfg(feature = "dispatch_instrumentation")]
+fn record_open(algorithm: &'static Algorithm, bytes: usize) {
+    ::dispatch::record_open(algorithm, bytes);
+}
+
+#[cfg(not(feature = "dispatch_instrumentation"))]
+#[inline(always)]
+fn record_open(_algorithm: &'static Algorithm, _bytes: usize) {}
+
 /// A key for encrypting and signing (“sealing”) data.
 ///
 /// C analog: `EVP_AEAD_CTX` with direction `evp_aead_seal`.
@@ -227,9 +274,412 @@ pub fn seal_in_place(key: &SealingKey, nonce: &[u8], ad: &[u8],
     let (in_out, tag_out) = in_out.split_at_mut(in_out_len);
     let tag_out = try!(slice_as_array_ref_mut!(tag_out, TAG_LEN));
     try!((key.key.algorithm.seal)(&key.key.ctx_buf, nonce, ad, in_out, tag_out));
+    record_seal(key.key.algorithm, in_out_len);
     Ok(in_out_len + TAG_LEN)
 }
 
+/// Encrypts and signs (“seals”) data in place, writing the tag to a detached
+/// buffer instead of appending it to the ciphertext.
+///
+/// All of `in_out` is the input and is encrypted in place, so no suffix
+/// capacity needs to be reserved; the tag is written to `tag_out`, which must
+/// be exactly `key.algorithm().tag_len()` bytes long. This is for callers
+/// that lay records out in transmit rings with the tags stored out of line.
+/// The ciphertext and tag are exactly what `seal_in_place` would have
+/// produced.
+///
+/// `nonce` must be unique for every use of the key, as for `seal_in_place`.
+pub fn seal_in_place_detached(key: &SealingKey, nonce: &[u8], ad: &[u8],
+                              in_out: &mut [u8], tag_out: &mut [u8])
+                              -> Result<(), error::Unspecified> {
+    let nonce = try!(slice_as_array_ref!(nonce, NONCE_LEN));
+    try!(check_per_nonce_max_bytes(in_out.len()));
+    let tag_out = try!(slice_as_array_ref_mut!(tag_out, TAG_LEN));
+    try!((key.key.algorithm.seal)(&key.key.ctx_buf, nonce, ad, in_out,
+                                  tag_out));
+    record_seal(key.key.algorithm, in_out.len());
+    Ok(())
+}
+
+#[cfg(feature = "dispatch_instrumentation")]
+fn record_seal(algorithm: &'static Algorithm, bytes: usize) {
+    ::dispatch::record_seal(algorithm, bytes);
+}
+
+#[cfg(not(feature = "dispatch_instrumentation"))]
+#[inline(always)]
+fn record_seal(_algorithm: &'static Algorithm, _bytes: usize) {}
+
+/// Seals a sequence of records with counter-based nonces, as in TLS 1.3
+/// ([RFC 8446 Section 5.3]): the nonce for each record is the record number
+/// XOR'd into the low 64 bits of a per-connection static IV.
+///
+/// The session owns the key and maintains the record counter itself, so the
+/// caller neither materializes per-record nonces nor can reuse one: every
+/// `seal_next` call consumes the next record number exactly once, and the
+/// session refuses to let the counter wrap. Owning the key also keeps it
+/// from being used with independently-chosen nonces on the side.
+///
+/// The per-call nonce-length validation of `seal_in_place` is done once, at
+/// construction.
+///
+/// [RFC 8446 Section 5.3]: https://tools.ietf.org/html/rfc8446#section-5.3
+pub struct SealingSession {
+    key: SealingKey,
+    static_iv: [u8; NONCE_LEN],
+    record_counter: u64,
+}
+
+impl SealingSession {
+    /// Constructs a session from `key` and the connection's `static_iv`,
+    /// which must be exactly `key.algorithm().nonce_len()` bytes long. The
+    /// record counter starts at zero.
+    pub fn new(key: SealingKey, static_iv: &[u8])
+               -> Result<SealingSession, error::Unspecified> {
+        let static_iv = try!(slice_as_array_ref!(static_iv, NONCE_LEN));
+        Ok(SealingSession {
+            key: key,
+            static_iv: *static_iv,
+            record_counter: 0,
+        })
+    }
+
+    /// The key's AEAD algorithm.
+    #[inline(always)]
+    pub fn algorithm(&self) -> &'static Algorithm { self.key.algorithm() }
+
+    /// Seals the next record, exactly as `seal_in_place` would with the
+    /// record's nonce. The record number the nonce was derived from is
+    /// consumed even if sealing fails, so a nonce is never used twice; once
+    /// the counter is exhausted every call fails.
+    pub fn seal_next(&mut self, ad: &[u8], in_out: &mut [u8],
+                     out_suffix_capacity: usize)
+                     -> Result<usize, error::Unspecified> {
+        if out_suffix_capacity < self.key.key.algorithm.tag_len() {
+            return Err(error::Unspecified);
+        }
+        let in_out_len =
+            try!(in_out.len().checked_sub(out_suffix_capacity)
+                             .ok_or(error::Unspecified));
+        try!(check_per_nonce_max_bytes(in_out_len));
+
+        let record_number = self.record_counter;
+        self.record_counter =
+            try!(self.record_counter.checked_add(1)
+                     .ok_or(error::Unspecified));
+
+        // XOR the big-endian record number into the low 8 bytes of the IV.
+        let mut nonce = self.static_iv;
+        for i in 0..8 {
+            nonce[NONCE_LEN - 1 - i] ^= (record_number >> (8 * i)) as u8;
+        }
+
+        let (in_out, tag_out) = in_out.split_at_mut(in_out_len);
+        let tag_out = try!(slice_as_array_ref_mut!(tag_out, TAG_LEN));
+        try!((self.key.key.algorithm.seal)(&self.key.key.ctx_buf, &nonce, ad,
+                                           in_out, tag_out));
+        record_seal(self.key.key.algorithm, in_out_len);
+        Ok(in_out_len + TAG_LEN)
+    }
+}
+
+/// Authenticates `ad` without encrypting any payload (for AES-GCM keys this
+/// is GMAC), writing the tag to `tag_out`, which must be exactly
+/// `key.algorithm().tag_len()` bytes long.
+///
+/// The tag is identical to the one `seal_in_place` produces for an empty
+/// input with the same `ad`, but the data makes only a single
+/// authentication pass -- the encryption machinery is never set up -- so
+/// pure authentication runs at the speed of the underlying MAC.
+///
+/// `nonce` must be unique for every use of the key, as for `seal_in_place`.
+pub fn sign(key: &SealingKey, nonce: &[u8], ad: &[u8], tag_out: &mut [u8])
+            -> Result<(), error::Unspecified> {
+    let nonce = try!(slice_as_array_ref!(nonce, NONCE_LEN));
+    let tag_out = try!(slice_as_array_ref_mut!(tag_out, TAG_LEN));
+    (key.key.algorithm.sign)(&key.key.ctx_buf, nonce, ad, tag_out)
+}
+
+/// Authenticates `ad` and checks, in constant time, that `received_tag` is
+/// the tag that `sign` would have produced for it.
+pub fn verify(key: &OpeningKey, nonce: &[u8], ad: &[u8], received_tag: &[u8])
+              -> Result<(), error::Unspecified> {
+    let nonce = try!(slice_as_array_ref!(nonce, NONCE_LEN));
+    let mut calculated_tag = [0u8; TAG_LEN];
+    try!((key.key.algorithm.sign)(&key.key.ctx_buf, nonce, ad,
+                                  &mut calculated_tag));
+    constant_time::verify_slices_are_equal(&calculated_tag, received_tag)
+}
+
+/// Encrypts and signs (“seals”) data gathered from a list of segments,
+/// writing the ciphertext and tag to `out`.
+///
+/// This is for callers that assemble a record from parts -- a header, a
+/// payload borrowed from a buffer pool, padding -- and would otherwise have
+/// to copy them into one contiguous buffer just to call `seal_in_place`.
+/// Each segment is copied to its final position in `out` and encrypted there
+/// while it is still in cache, so the input is read only once and the
+/// segments themselves are not modified.
+///
+/// `out` must be at least the total length of the segments plus
+/// `key.algorithm().tag_len()` bytes long. On success, returns the number of
+/// bytes of `out` written, i.e. that total. The result is exactly what
+/// `seal_in_place` would have produced for the concatenated segments.
+///
+/// `nonce` must be unique for every use of the key, as for `seal_in_place`.
+pub fn seal_gather(key: &SealingKey, nonce: &[u8], ad: &[u8],
+                   in_segments: &[&[u8]], out: &mut [u8])
+                   -> Result<usize, error::Unspecified> {
+    let mut ctx = try!(SealingContext::new(key, nonce, ad));
+    let block_len = ctx.update_block_len;
+
+    let mut in_len = 0usize; // Bytes copied into `out` so far.
+    let mut sealed = 0; // Prefix of `out` already encrypted.
+    for segment in in_segments {
+        let new_in_len = try!(in_len.checked_add(segment.len())
+                                  .ok_or(error::Unspecified));
+        if try!(new_in_len.checked_add(TAG_LEN).ok_or(error::Unspecified)) >
+                out.len() {
+            return Err(error::Unspecified);
+        }
+        out[in_len..new_in_len].copy_from_slice(segment);
+        in_len = new_in_len;
+
+        let aligned = in_len - (in_len % block_len);
+        if aligned > sealed {
+            try!(ctx.update(&mut out[sealed..aligned]));
+            sealed = aligned;
+        }
+    }
+
+    let (in_out, tag_out) = out[..(in_len + TAG_LEN)].split_at_mut(in_len);
+    try!(ctx.finish(&mut in_out[sealed..], tag_out));
+    Ok(in_len + TAG_LEN)
+}
+
+/// Authenticates and decrypts (“opens”) ciphertext gathered from a list of
+/// segments, writing the plaintext to `out`.
+///
+/// This is the inverse of `seal_gather`, for records that arrive scattered
+/// across pooled buffers. `in_segments` together hold the ciphertext, *not*
+/// including the tag, which is passed separately as `received_tag`. Each
+/// segment is copied to its position in `out` and decrypted there, so the
+/// segments themselves are not modified.
+///
+/// `out` must be at least the total length of the segments. On success,
+/// returns the plaintext, which is the prefix of `out` that was written. If
+/// verification fails, the part of `out` that was written is zeroed, as with
+/// `open_in_place`.
+pub fn open_gather<'a>(key: &OpeningKey, nonce: &[u8], ad: &[u8],
+                       in_segments: &[&[u8]], received_tag: &[u8],
+                       out: &'a mut [u8])
+                       -> Result<&'a mut [u8], error::Unspecified> {
+    let mut ctx = try!(OpeningContext::new(key, nonce, ad));
+    let block_len = ctx.update_block_len;
+
+    let mut in_len = 0usize; // Bytes copied into `out` so far.
+    let mut opened = 0; // Prefix of `out` already decrypted.
+    let mut result = Ok(());
+    for segment in in_segments {
+        let new_in_len = match in_len.checked_add(segment.len()) {
+            Some(new_in_len) if new_in_len <= out.len() => new_in_len,
+            _ => {
+                result = Err(error::Unspecified);
+                break;
+            },
+        };
+        out[in_len..new_in_len].copy_from_slice(segment);
+        in_len = new_in_len;
+
+        let aligned = in_len - (in_len % block_len);
+        if aligned > opened {
+            if ctx.update(&mut out[opened..aligned]).is_err() {
+                result = Err(error::Unspecified);
+                break;
+            }
+            opened = aligned;
+        }
+    }
+
+    if result.is_ok() {
+        result = ctx.finish(&mut out[opened..in_len], received_tag);
+    }
+    if result.is_err() {
+        // `OpeningContext::finish` only zeros its own chunk; zero the rest of
+        // the plaintext written by the earlier updates too.
+        for b in &mut out[..in_len] {
+            *b = 0;
+        }
+        return Err(error::Unspecified);
+    }
+    Ok(&mut out[..in_len])
+}
+
+/// A multi-part (streaming) sealing operation.
+///
+/// Where `seal_in_place` requires the whole input to be in memory at once, a
+/// `SealingContext` lets the input be piped through in chunks, so that
+/// encryption can overlap with I/O and memory use stays flat. The output of
+/// `new` + zero or more `update`s + `finish` is exactly the ciphertext and
+/// tag that `seal_in_place` would have produced for the concatenated input.
+///
+/// Every chunk passed to `update` must be a multiple of
+/// `key.algorithm().stream_update_block_len()` bytes long; the chunk passed
+/// to `finish` may be any length. The per-nonce rules for `seal_in_place`
+/// apply to the whole stream: the nonce must be unique for every stream
+/// sealed with the key.
+pub struct SealingContext {
+    stream: Stream,
+    update_block_len: usize,
+    in_len: usize,
+}
+
+impl SealingContext {
+    /// Begins sealing a stream, processing all the additional authenticated
+    /// data `ad` up front.
+    pub fn new(key: &SealingKey, nonce: &[u8], ad: &[u8])
+               -> Result<SealingContext, error::Unspecified> {
+        let nonce = try!(slice_as_array_ref!(nonce, NONCE_LEN));
+        Ok(SealingContext {
+            stream: try!((key.key.algorithm.stream_init)(&key.key.ctx_buf,
+                                                         nonce, ad)),
+            update_block_len: key.key.algorithm.stream_update_block_len,
+            in_len: 0,
+        })
+    }
+
+    /// Encrypts `in_out` in place. `in_out.len()` must be a multiple of the
+    /// algorithm's `stream_update_block_len()`.
+    pub fn update(&mut self, in_out: &mut [u8])
+                  -> Result<(), error::Unspecified> {
+        if in_out.len() % self.update_block_len != 0 {
+            return Err(error::Unspecified);
+        }
+        self.in_len = try!(self.in_len.checked_add(in_out.len())
+                               .ok_or(error::Unspecified));
+        try!(check_per_nonce_max_bytes(self.in_len));
+        self.stream.seal_update(in_out)
+    }
+
+    /// Encrypts the final chunk `in_out` (which may be empty and may be any
+    /// length) in place and writes the tag to `tag_out`, which must be
+    /// exactly `MAX_TAG_LEN` bytes long.
+    pub fn finish(mut self, in_out: &mut [u8], tag_out: &mut [u8])
+                  -> Result<(), error::Unspecified> {
+        let tag_out = try!(slice_as_array_ref_mut!(tag_out, TAG_LEN));
+        self.in_len = try!(self.in_len.checked_add(in_out.len())
+                               .ok_or(error::Unspecified));
+        try!(check_per_nonce_max_bytes(self.in_len));
+        try!(self.stream.seal_update(in_out));
+        self.stream.tag(tag_out);
+        Ok(())
+    }
+}
+
+/// A multi-part (streaming) opening operation.
+///
+/// This is the inverse of `SealingContext`: the ciphertext (not including the
+/// tag) is piped through `update` in chunks and decrypted in place, and
+/// `finish` checks the tag.
+///
+/// The plaintext written by `update` has **not yet been authenticated**; the
+/// caller must buffer it, or otherwise avoid acting on it, until `finish`
+/// succeeds. (`open_in_place` does not have this hazard because it checks the
+/// tag before returning any plaintext.) On failure, `finish` zeros only its
+/// own chunk; plaintext already written by `update` is the caller's
+/// responsibility to discard.
+///
+/// Every chunk passed to `update` must be a multiple of
+/// `key.algorithm().stream_update_block_len()` bytes long; the chunk passed
+/// to `finish` may be any length.
+pub struct OpeningContext {
+    stream: Stream,
+    update_block_len: usize,
+    in_len: usize,
+}
+
+impl OpeningContext {
+    /// Begins opening a stream, processing all the additional authenticated
+    /// data `ad` up front.
+    pub fn new(key: &OpeningKey, nonce: &[u8], ad: &[u8])
+               -> Result<OpeningContext, error::Unspecified> {
+        let nonce = try!(slice_as_array_ref!(nonce, NONCE_LEN));
+        Ok(OpeningContext {
+            stream: try!((key.key.algorithm.stream_init)(&key.key.ctx_buf,
+                                                         nonce, ad)),
+            update_block_len: key.key.algorithm.stream_update_block_len,
+            in_len: 0,
+        })
+    }
+
+    /// Decrypts `in_out` in place. `in_out.len()` must be a multiple of the
+    /// algorithm's `stream_update_block_len()`. The result is unauthenticated
+    /// until `finish` succeeds; see the struct-level documentation.
+    pub fn update(&mut self, in_out: &mut [u8])
+                  -> Result<(), error::Unspecified> {
+        if in_out.len() % self.update_block_len != 0 {
+            return Err(error::Unspecified);
+        }
+        self.in_len = try!(self.in_len.checked_add(in_out.len())
+                               .ok_or(error::Unspecified));
+        try!(check_per_nonce_max_bytes(self.in_len));
+        self.stream.open_update(in_out)
+    }
+
+    /// Decrypts the final chunk `in_out` (which may be empty and may be any
+    /// length) in place and checks that the calculated tag matches
+    /// `received_tag`.
+    pub fn finish(mut self, in_out: &mut [u8], received_tag: &[u8])
+                  -> Result<(), error::Unspecified> {
+        self.in_len = try!(self.in_len.checked_add(in_out.len())
+                               .ok_or(error::Unspecified));
+        try!(check_per_nonce_max_bytes(self.in_len));
+        try!(self.stream.open_update(in_out));
+        let mut calculated_tag = [0u8; TAG_LEN];
+        self.stream.tag(&mut calculated_tag);
+        if constant_time::verify_slices_are_equal(&calculated_tag,
+                                                  received_tag).is_err() {
+            for b in in_out.iter_mut() {
+                *b = 0;
+            }
+            return Err(error::Unspecified);
+        }
+        Ok(())
+    }
+}
+
+/// The per-stream state of a multi-part operation, and the dispatching
+/// between the algorithms' implementations of it.
+enum Stream {
+    AesGcm(aes_gcm::Stream),
+    ChaCha20Poly1305(chacha20_poly1305::Stream),
+}
+
+impl Stream {
+    fn seal_update(&mut self, in_out: &mut [u8])
+                   -> Result<(), error::Unspecified> {
+        match *self {
+            Stream::AesGcm(ref mut s) => s.seal_update(in_out),
+            Stream::ChaCha20Poly1305(ref mut s) => s.seal_update(in_out),
+        }
+    }
+
+    fn open_update(&mut self, in_out: &mut [u8])
+                   -> Result<(), error::Unspecified> {
+        match *self {
+            Stream::AesGcm(ref mut s) => s.open_update(in_out),
+            Stream::ChaCha20Poly1305(ref mut s) => s.open_update(in_out),
+        }
+    }
+
+    fn tag(self, tag_out: &mut [u8; TAG_LEN]) {
+        match self {
+            Stream::AesGcm(mut s) => s.tag(tag_out),
+            Stream::ChaCha20Poly1305(s) => s.tag(tag_out),
+        }
+    }
+}
+
 /// `OpeningKey` and `SealingKey` are type-safety wrappers around `Key`, which
 /// does all the actual work via the C AEAD interface.
 ///
@@ -280,6 +730,14 @@ pub struct Algorithm {
              ad: &[u8], in_prefix_len: usize, in_out: &mut [u8],
              tag_out: &mut [u8; TAG_LEN]) -> Result<(), error::Unspecified>,
 
+    sign: fn(ctx: &[u64; KEY_CTX_BUF_ELEMS], nonce: &[u8; NONCE_LEN],
+             ad: &[u8], tag_out: &mut [u8; TAG_LEN])
+             -> Result<(), error::Unspecified>,
+
+    stream_init: fn(ctx: &[u64; KEY_CTX_BUF_ELEMS], nonce: &[u8; NONCE_LEN],
+                    ad: &[u8]) -> Result<Stream, error::Unspecified>,
+    stream_update_block_len: usize,
+
     key_len: usize,
 }
 
@@ -309,6 +767,16 @@ impl Algorithm {
     ///   [`crypto.cipher.AEAD.NonceSize`](https://golang.org/pkg/crypto/cipher/#AEAD)
     #[inline(always)]
     pub fn nonce_len(&self) -> usize { NONCE_LEN }
+
+    /// The granularity of `SealingContext::update` and
+    /// `OpeningContext::update`: every chunk except the one passed to
+    /// `finish` must be a multiple of this many bytes long. It is at most 64,
+    /// so any power-of-two buffer size of at least 64 bytes works for every
+    /// algorithm.
+    #[inline(always)]
+    pub fn stream_update_block_len(&self) -> usize {
+        self.stream_update_block_len
+    }
 }
 
 
@@ -362,6 +830,203 @@ mod tests {
                                                &mut s_in_out[..], tag_len);
             let o_key = try!(aead::OpeningKey::new(aead_alg, &key_bytes[..]));
 
+            // Multi-part sealing and opening must produce exactly the same
+            // results as the one-shot functions.
+            match aead::SealingContext::new(&s_key, &nonce[..], &ad) {
+                Ok(mut s_ctx) => {
+                    let block_len = aead_alg.stream_update_block_len();
+                    let mut tag_out = [0u8; aead::MAX_TAG_LEN];
+
+                    let mut st_in_out = plaintext.clone();
+                    let mut offset = 0;
+                    while st_in_out.len() - offset > block_len {
+                        s_ctx.update(
+                            &mut st_in_out[offset..(offset + block_len)])
+                            .unwrap();
+                        offset += block_len;
+                    }
+                    s_ctx.finish(&mut st_in_out[offset..], &mut tag_out)
+                        .unwrap();
+                    assert_eq!(&ct[..], &st_in_out[..]);
+                    assert_eq!(&tag[..], &tag_out[..]);
+
+                    let mut o_ctx =
+                        aead::OpeningContext::new(&o_key, &nonce[..], &ad)
+                            .unwrap();
+                    let mut st_in_out = ct.clone();
+                    let mut offset = 0;
+                    while st_in_out.len() - offset > block_len {
+                        o_ctx.update(
+                            &mut st_in_out[offset..(offset + block_len)])
+                            .unwrap();
+                        offset += block_len;
+                    }
+                    o_ctx.finish(&mut st_in_out[offset..], &tag[..]).unwrap();
+                    assert_eq!(&plaintext[..], &st_in_out[..]);
+                },
+                Err(_) => {
+                    match error {
+                        Some(ref error) if error == "WRONG_NONCE_LENGTH" => {},
+                        _ => unreachable!(
+                            "SealingContext::new failed unexpectedly"),
+                    };
+                },
+            };
+
+            // Gather-sealing and gather-opening of segmented input must also
+            // produce the same results as the one-shot functions.
+            {
+                let a = std::cmp::min(1, plaintext.len());
+                let b = std::cmp::min(9, plaintext.len());
+                let segments = [&plaintext[..a], &plaintext[a..b],
+                                &plaintext[b..]];
+                let mut g_out =
+                    vec![0u8; plaintext.len() + aead_alg.tag_len()];
+                let g_result = aead::seal_gather(&s_key, &nonce[..], &ad,
+                                                 &segments[..],
+                                                 &mut g_out[..]);
+                match error {
+                    None => {
+                        assert_eq!(Ok(g_out.len()), g_result);
+                        assert_eq!(&ct[..], &g_out[..ct.len()]);
+                        assert_eq!(&tag[..], &g_out[ct.len()..]);
+
+                        let c = std::cmp::min(13, ct.len());
+                        let ct_segments = [&ct[..c], &ct[c..]];
+                        let mut p_out = vec![0u8; ct.len()];
+                        let o_result =
+                            aead::open_gather(&o_key, &nonce[..], &ad,
+                                              &ct_segments[..], &tag[..],
+                                              &mut p_out[..]);
+                        assert_eq!(&plaintext[..], o_result.unwrap());
+                    },
+                    Some(ref error) if error == "WRONG_NONCE_LENGTH" => {
+                        assert_eq!(Err(error::Unspecified), g_result);
+                    },
+                    Some(ref error) => {
+                        unreachable!("Unexpected error test case: {}", error);
+                    },
+                };
+            }
+
+            // The authentication-only API must produce exactly the tag that
+            // sealing an empty payload with the same AD produces, and
+            // `verify` must accept that tag and nothing else.
+            {
+                let mut empty_in_out = vec![0u8; tag_len];
+                let empty_result = aead::seal_in_place(&s_key, &nonce[..],
+                                                       &ad, &mut empty_in_out,
+                                                       tag_len);
+                let mut mac_tag = [0u8; aead::MAX_TAG_LEN];
+                let sign_result = aead::sign(&s_key, &nonce[..], &ad,
+                                             &mut mac_tag);
+                match error {
+                    None => {
+                        assert_eq!(Ok(tag_len), empty_result);
+                        assert_eq!(Ok(()), sign_result);
+                        assert_eq!(&empty_in_out[..], &mac_tag[..]);
+                        assert_eq!(Ok(()), aead::verify(&o_key, &nonce[..],
+                                                        &ad, &mac_tag));
+                        mac_tag[0] ^= 1;
+                        assert_eq!(Err(error::Unspecified),
+                                   aead::verify(&o_key, &nonce[..], &ad,
+                                                &mac_tag));
+                    },
+                    Some(ref error) if error == "WRONG_NONCE_LENGTH" => {
+                        assert_eq!(Err(error::Unspecified), sign_result);
+                        assert_eq!(Err(error::Unspecified),
+                                   aead::verify(&o_key, &nonce[..], &ad,
+                                                &mac_tag));
+                    },
+                    Some(ref error) => {
+                        unreachable!("Unexpected error test case: {}", error);
+                    },
+                };
+            }
+
+            // A counter-based sealing session whose static IV is the test
+            // nonce must produce record 0 exactly as the one-shot seal does
+            // (record number 0 XORs to the IV itself), and record 1 must
+            // match a one-shot seal with the record number XOR'd in.
+            {
+                let session = aead::SealingKey::new(aead_alg, &key_bytes[..])
+                    .and_then(|key| aead::SealingSession::new(key,
+                                                              &nonce[..]));
+                match (session, &error) {
+                    (Ok(mut session), &None) => {
+                        let mut in_out = plaintext.clone();
+                        for _ in 0..tag_len {
+                            in_out.push(0);
+                        }
+                        let out_len = session.seal_next(&ad, &mut in_out[..],
+                                                        tag_len).unwrap();
+                        assert_eq!(plaintext.len() + tag_len, out_len);
+                        assert_eq!(&ct[..], &in_out[..ct.len()]);
+                        assert_eq!(&tag[..], &in_out[ct.len()..]);
+
+                        let mut record_1_nonce = nonce.clone();
+                        let nonce_len = record_1_nonce.len();
+                        record_1_nonce[nonce_len - 1] ^= 1;
+                        let mut expected = plaintext.clone();
+                        for _ in 0..tag_len {
+                            expected.push(0);
+                        }
+                        let expected_len =
+                            aead::seal_in_place(&s_key, &record_1_nonce[..],
+                                                &ad, &mut expected[..],
+                                                tag_len).unwrap();
+                        let mut actual = plaintext.clone();
+                        for _ in 0..tag_len {
+                            actual.push(0);
+                        }
+                        let actual_len = session.seal_next(&ad,
+                                                           &mut actual[..],
+                                                           tag_len).unwrap();
+                        assert_eq!(expected_len, actual_len);
+                        assert_eq!(&expected[..], &actual[..]);
+                    },
+                    (Err(_), &Some(ref error))
+                            if error == "WRONG_NONCE_LENGTH" => {},
+                    (Ok(_), _) => {
+                        unreachable!(
+                            "SealingSession::new succeeded unexpectedly");
+                    },
+                    (Err(_), _) => {
+                        unreachable!("SealingSession::new failed unexpectedly");
+                    },
+                };
+            }
+
+            // Detached-tag sealing and opening must produce exactly the same
+            // results as the one-shot functions, without moving the data.
+            {
+                let mut d_in_out = plaintext.clone();
+                let mut d_tag = [0u8; aead::MAX_TAG_LEN];
+                let d_result = aead::seal_in_place_detached(&s_key, &nonce[..],
+                                                            &ad,
+                                                            &mut d_in_out[..],
+                                                            &mut d_tag[..]);
+                match error {
+                    None => {
+                        assert_eq!(Ok(()), d_result);
+                        assert_eq!(&ct[..], &d_in_out[..]);
+                        assert_eq!(&tag[..], &d_tag[..]);
+
+                        let mut d_in_out = ct.clone();
+                        let o_result = aead::open_in_place_detached(
+                            &o_key, &nonce[..], &ad, &mut d_in_out[..],
+                            &tag[..]);
+                        assert_eq!(&plaintext[..], o_result.unwrap());
+                    },
+                    Some(ref error) if error == "WRONG_NONCE_LENGTH" => {
+                        assert_eq!(Err(error::Unspecified), d_result);
+                    },
+                    Some(ref error) => {
+                        unreachable!("Unexpected error test case: {}", error);
+                    },
+                };
+            }
+
             ct.extend(tag);
 
             // In release builds, test all prefix lengths from 0 to 4096 bytes.
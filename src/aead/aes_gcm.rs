@@ -12,7 +12,7 @@
 // OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
 // CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
-use {aead, bssl, c, error, polyfill};
+use {aead, bssl, c, core, error, polyfill};
 
 /// AES-128 in GCM mode with 128-bit tags and 96 bit nonces.
 ///
@@ -24,6 +24,9 @@ pub static AES_128_GCM: aead::Algorithm = aead::Algorithm {
     init: aes_gcm_init,
     seal: aes_gcm_seal,
     open: aes_gcm_open,
+    sign: aes_gcm_sign,
+    stream_init: aes_gcm_stream_init,
+    stream_update_block_len: AES_BLOCK_LEN,
 };
 
 /// AES-256 in GCM mode with 128-bit tags and 96 bit nonces.
@@ -36,6 +39,9 @@ pub static AES_256_GCM: aead::Algorithm = aead::Algorithm {
     init: aes_gcm_init,
     seal: aes_gcm_seal,
     open: aes_gcm_open,
+    sign: aes_gcm_sign,
+    stream_init: aes_gcm_stream_init,
+    stream_update_block_len: AES_BLOCK_LEN,
 };
 
 fn aes_gcm_init(ctx_buf: &mut [u8], key: &[u8])
@@ -57,6 +63,16 @@ fn aes_gcm_seal(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
     })
 }
 
+fn aes_gcm_sign(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
+                nonce: &[u8; aead::NONCE_LEN], ad: &[u8],
+                tag_out: &mut [u8; aead::TAG_LEN])
+                -> Result<(), error::Unspecified> {
+    let ctx = polyfill::slice::u64_as_u8(ctx);
+    bssl::map_result(unsafe {
+        GFp_aes_gcm_sign(ctx.as_ptr(), tag_out, nonce, ad.as_ptr(), ad.len())
+    })
+}
+
 fn aes_gcm_open(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
                 nonce: &[u8; aead::NONCE_LEN], ad: &[u8], in_prefix_len: usize,
                 in_out: &mut [u8], tag_out: &mut [u8; aead::TAG_LEN])
@@ -71,10 +87,199 @@ fn aes_gcm_open(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
 }
 
 
+/// Encrypts and signs (“seals”) a large payload in place, like
+/// `aead::seal_in_place`, splitting the CTR keystream generation across
+/// `num_threads` threads.
+///
+/// The payload is partitioned by counter range; each partition's keystream is
+/// computed and applied on its own thread (the calling thread takes the first
+/// partition), and the ciphertext is then authenticated in a single GHASH
+/// pass. The output is bit-identical to `aead::seal_in_place`.
+///
+/// `key` must be an AES-128-GCM or AES-256-GCM key; other algorithms are
+/// rejected. Spawning a thread only pays for itself on payloads of hundreds
+/// of kilobytes and up, so smaller inputs (and `num_threads <= 1`) simply
+/// fall through to the one-shot path.
+pub fn seal_in_place_parallel(key: &aead::SealingKey, nonce: &[u8], ad: &[u8],
+                              in_out: &mut [u8], out_suffix_capacity: usize,
+                              num_threads: usize)
+                              -> Result<usize, error::Unspecified> {
+    use std;
+
+    let alg = key.algorithm() as *const aead::Algorithm;
+    if alg != &AES_128_GCM as *const aead::Algorithm &&
+       alg != &AES_256_GCM as *const aead::Algorithm {
+        return Err(error::Unspecified);
+    }
+    if out_suffix_capacity < aead::TAG_LEN {
+        return Err(error::Unspecified);
+    }
+    let in_out_len =
+        try!(in_out.len().checked_sub(out_suffix_capacity)
+                         .ok_or(error::Unspecified));
+
+    let num_threads = core::cmp::min(
+        core::cmp::max(num_threads, 1),
+        core::cmp::max(in_out_len / MIN_LEN_PER_THREAD, 1));
+    if num_threads == 1 {
+        return aead::seal_in_place(key, nonce, ad, in_out,
+                                   out_suffix_capacity);
+    }
+
+    let nonce = try!(slice_as_array_ref!(nonce, aead::NONCE_LEN));
+    try!(aead::check_per_nonce_max_bytes(in_out_len));
+
+    let mut state = [0u64; STREAM_STATE_BUF_ELEMS];
+    {
+        let ctx = polyfill::slice::u64_as_u8(&key.key.ctx_buf);
+        let state = polyfill::slice::u64_as_u8_mut(&mut state);
+        try!(bssl::map_result(unsafe {
+            GFp_aes_gcm_stream_init(state.as_mut_ptr(), state.len(),
+                                    ctx.as_ptr(), nonce, ad.as_ptr(),
+                                    ad.len())
+        }));
+    }
+
+    let (in_out, tag_out) = in_out.split_at_mut(in_out_len);
+    let tag_out = try!(slice_as_array_ref_mut!(&mut tag_out[..aead::TAG_LEN],
+                                               aead::TAG_LEN));
+
+    // Partition the payload on block boundaries so that only the final
+    // partition may end mid-block, as `GFp_aes_gcm_ctr32_encrypt` requires.
+    let total_blocks = (in_out_len + AES_BLOCK_LEN - 1) / AES_BLOCK_LEN;
+    let blocks_per_thread = (total_blocks + num_threads - 1) / num_threads;
+    let partition_len = blocks_per_thread * AES_BLOCK_LEN;
+
+    {
+        // The keystream threads only read `state` and write disjoint ranges
+        // of `in_out`, and they are all joined below before either is used
+        // again, so it is safe to hand them raw pointers. Nothing between
+        // `spawn` and `join` panics, so the threads can't outlive the
+        // borrows.
+        struct Partition {
+            in_out: *mut u8,
+            len: usize,
+            state: *const u8,
+            block_offset: u32,
+        }
+        unsafe impl Send for Partition {}
+
+        let state = polyfill::slice::u64_as_u8(&state);
+        let mut threads = std::vec::Vec::with_capacity(num_threads - 1);
+        for i in 1..num_threads {
+            let offset = i * partition_len;
+            if offset >= in_out_len {
+                break;
+            }
+            let partition = Partition {
+                in_out: in_out[offset..].as_mut_ptr(),
+                len: core::cmp::min(partition_len, in_out_len - offset),
+                state: state.as_ptr(),
+                block_offset: (offset / AES_BLOCK_LEN) as u32,
+            };
+            threads.push(std::thread::spawn(move || unsafe {
+                GFp_aes_gcm_ctr32_encrypt(partition.state, partition.in_out,
+                                          partition.len,
+                                          partition.block_offset)
+            }));
+        }
+
+        let mut ok = 1 == unsafe {
+            GFp_aes_gcm_ctr32_encrypt(
+                state.as_ptr(), in_out.as_mut_ptr(),
+                core::cmp::min(partition_len, in_out_len), 0)
+        };
+        for thread in threads {
+            ok = match thread.join() {
+                Ok(result) => ok && result == 1,
+                Err(_) => false,
+            };
+        }
+        if !ok {
+            return Err(error::Unspecified);
+        }
+    }
+
+    // Authenticate the whole ciphertext in one pass and emit the tag.
+    {
+        let state = polyfill::slice::u64_as_u8_mut(&mut state);
+        try!(bssl::map_result(unsafe {
+            GFp_aes_gcm_stream_ghash(state.as_mut_ptr(), in_out.as_ptr(),
+                                     in_out.len())
+        }));
+        unsafe {
+            GFp_aes_gcm_stream_tag(state.as_mut_ptr(), tag_out);
+        }
+    }
+    Ok(in_out_len + aead::TAG_LEN)
+}
+
+// Spawning a thread costs tens of microseconds, which single-threaded
+// AES-GCM spends encrypting roughly a hundred kilobytes.
+const MIN_LEN_PER_THREAD: usize = 1 << 18;
+
+fn aes_gcm_stream_init(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
+                       nonce: &[u8; aead::NONCE_LEN], ad: &[u8])
+                       -> Result<aead::Stream, error::Unspecified> {
+    let ctx = polyfill::slice::u64_as_u8(ctx);
+    let mut stream = Stream {
+        state: [0; STREAM_STATE_BUF_ELEMS],
+    };
+    {
+        let state = polyfill::slice::u64_as_u8_mut(&mut stream.state);
+        try!(bssl::map_result(unsafe {
+            GFp_aes_gcm_stream_init(state.as_mut_ptr(), state.len(),
+                                    ctx.as_ptr(), nonce, ad.as_ptr(),
+                                    ad.len())
+        }));
+    }
+    Ok(aead::Stream::AesGcm(stream))
+}
+
+/// The state of a multi-part AES-GCM operation: the `AES_KEY` followed by a
+/// live `GCM128_CONTEXT`, the same layout as the key's `ctx_buf`. It is only
+/// read and written by the `GFp_aes_gcm_stream_*` functions.
+pub struct Stream {
+    state: [u64; STREAM_STATE_BUF_ELEMS],
+}
+
+impl Stream {
+    pub fn seal_update(&mut self, in_out: &mut [u8])
+                       -> Result<(), error::Unspecified> {
+        let state = polyfill::slice::u64_as_u8_mut(&mut self.state);
+        bssl::map_result(unsafe {
+            GFp_aes_gcm_stream_seal_update(state.as_mut_ptr(),
+                                           in_out.as_mut_ptr(), in_out.len())
+        })
+    }
+
+    pub fn open_update(&mut self, in_out: &mut [u8])
+                       -> Result<(), error::Unspecified> {
+        let state = polyfill::slice::u64_as_u8_mut(&mut self.state);
+        bssl::map_result(unsafe {
+            GFp_aes_gcm_stream_open_update(state.as_mut_ptr(),
+                                           in_out.as_ptr(),
+                                           in_out.as_mut_ptr(), in_out.len())
+        })
+    }
+
+    pub fn tag(&mut self, tag_out: &mut [u8; aead::TAG_LEN]) {
+        let state = polyfill::slice::u64_as_u8_mut(&mut self.state);
+        unsafe {
+            GFp_aes_gcm_stream_tag(state.as_mut_ptr(), tag_out);
+        }
+    }
+}
+
+
 const AES_128_KEY_LEN: usize = 128 / 8;
 const AES_256_KEY_LEN: usize = 32; // 256 / 8
 
-pub const AES_KEY_CTX_BUF_LEN: usize = AES_KEY_BUF_LEN + GCM128_SERIALIZED_LEN;
+const AES_BLOCK_LEN: usize = 16;
+
+const STREAM_STATE_BUF_ELEMS: usize = (AES_KEY_CTX_BUF_LEN + 7) / 8;
+
+pub const AES_KEY_CTX_BUF_LEN: usize = AES_KEY_BUF_LEN + GCM128_CONTEXT_LEN;
 
 // Keep this in sync with `AES_KEY` in aes.h.
 const AES_KEY_BUF_LEN: usize = (4 * 4 * (AES_MAX_ROUNDS + 1)) + 8;
@@ -82,11 +287,11 @@ const AES_KEY_BUF_LEN: usize = (4 * 4 * (AES_MAX_ROUNDS + 1)) + 8;
 // Keep this in sync with `AES_MAXNR` in aes.h.
 const AES_MAX_ROUNDS: usize = 14;
 
-// Keep this in sync with `GCM128_SERIALIZED_LEN` in gcm.h.
-// TODO: test.
-// TODO: some implementations of GCM don't require the buffer to be this big.
-// We should shrink it down on those platforms since this is still huge.
-const GCM128_SERIALIZED_LEN: usize = 16 * 16;
+// An upper bound on `sizeof(GCM128_CONTEXT)` in modes/internal.h: six
+// 16-byte state fields, the 256-byte Htable, and three function pointers,
+// rounded up generously to cover alignment padding. `GFp_aes_gcm_init`
+// verifies at runtime that the buffer is big enough.
+const GCM128_CONTEXT_LEN: usize = (6 * 16) + (16 * 16) + (3 * 8) + 24;
 
 
 extern {
@@ -99,11 +304,36 @@ extern {
                         nonce: &[u8; aead::NONCE_LEN], ad: *const u8,
                         ad_len: c::size_t) -> c::int;
 
+    fn GFp_aes_gcm_sign(ctx_buf: *const u8,
+                        tag_out: &mut [u8; aead::TAG_LEN],
+                        nonce: &[u8; aead::NONCE_LEN], ad: *const u8,
+                        ad_len: c::size_t) -> c::int;
+
     fn GFp_aes_gcm_open(ctx_buf: *const u8, out: *mut u8,
                         in_out_len: c::size_t,
                         tag_out: &mut [u8; aead::TAG_LEN],
                         nonce: &[u8; aead::NONCE_LEN], in_: *const u8,
                         ad: *const u8, ad_len: c::size_t) -> c::int;
+
+    fn GFp_aes_gcm_stream_init(state_buf: *mut u8, state_buf_len: c::size_t,
+                               ctx_buf: *const u8,
+                               nonce: &[u8; aead::NONCE_LEN], ad: *const u8,
+                               ad_len: c::size_t) -> c::int;
+
+    fn GFp_aes_gcm_stream_seal_update(state_buf: *mut u8, in_out: *mut u8,
+                                      len: c::size_t) -> c::int;
+
+    fn GFp_aes_gcm_stream_open_update(state_buf: *mut u8, in_: *const u8,
+                                      out: *mut u8, len: c::size_t) -> c::int;
+
+    fn GFp_aes_gcm_stream_tag(state_buf: *mut u8,
+                              tag_out: &mut [u8; aead::TAG_LEN]);
+
+    fn GFp_aes_gcm_ctr32_encrypt(state_buf: *const u8, in_out: *mut u8,
+                                 len: c::size_t, block_offset: u32) -> c::int;
+
+    fn GFp_aes_gcm_stream_ghash(state_buf: *mut u8, in_: *const u8,
+                                len: c::size_t) -> c::int;
 }
 
 
@@ -124,6 +354,53 @@ mod tests {
         test_aead(&aead::AES_256_GCM, "src/aead/aes_256_gcm_tests.txt");
     }
 
+    #[test]
+    pub fn test_seal_in_place_parallel() {
+        use std::vec::Vec;
+
+        let key_bytes = [42u8; 16];
+        let s_key =
+            aead::SealingKey::new(&aead::AES_128_GCM, &key_bytes).unwrap();
+        let nonce = [7u8; 12];
+        let ad = [1u8; 11];
+        let tag_len = aead::AES_128_GCM.tag_len();
+
+        // Sizes either side of block and partition boundaries; the largest
+        // ones actually exercise the multi-threaded path.
+        static LENS: [usize; 9] =
+            [0, 1, 15, 16, 17, 256, (1 << 19) + 3, 1 << 20, (1 << 20) + 17];
+        for len in LENS.iter() {
+            let mut expected: Vec<u8> =
+                (0..*len).map(|i| (i % 251) as u8).collect();
+            for _ in 0..tag_len {
+                expected.push(0);
+            }
+            let template = expected.clone();
+            let expected_len = aead::seal_in_place(&s_key, &nonce, &ad,
+                                                   &mut expected, tag_len)
+                .unwrap();
+
+            for num_threads in 0..5 {
+                let mut actual = template.clone();
+                let actual_len =
+                    aead::seal_in_place_parallel(&s_key, &nonce, &ad,
+                                                 &mut actual, tag_len,
+                                                 num_threads).unwrap();
+                assert_eq!(expected_len, actual_len);
+                assert_eq!(&expected[..], &actual[..]);
+            }
+        }
+
+        // Non-AES-GCM keys are rejected.
+        let chacha_key =
+            aead::SealingKey::new(&aead::CHACHA20_POLY1305, &[0u8; 32])
+                .unwrap();
+        let mut in_out = [0u8; 32];
+        assert!(aead::seal_in_place_parallel(&chacha_key, &nonce, &ad,
+                                             &mut in_out, tag_len, 2)
+                    .is_err());
+    }
+
     #[test]
     pub fn test_aes() {
         test::from_file("src/aead/aes_tests.txt", |section, test_case| {
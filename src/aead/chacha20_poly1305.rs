@@ -12,7 +12,7 @@
 // OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
 // CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
-use {aead, chacha, error, poly1305, polyfill};
+use {aead, chacha, core, error, poly1305, polyfill};
 
 /// ChaCha20-Poly1305 as described in [RFC 7539].
 ///
@@ -24,8 +24,13 @@ pub static CHACHA20_POLY1305: aead::Algorithm = aead::Algorithm {
     init: chacha20_poly1305_init,
     seal: chacha20_poly1305_seal,
     open: chacha20_poly1305_open,
+    sign: chacha20_poly1305_sign,
+    stream_init: chacha20_poly1305_stream_init,
+    stream_update_block_len: CHACHA20_BLOCK_LEN,
 };
 
+const CHACHA20_BLOCK_LEN: usize = 64;
+
 /// Copies |key| into |ctx_buf|.
 pub fn chacha20_poly1305_init(ctx_buf: &mut [u8], key: &[u8])
                               -> Result<(), error::Unspecified> {
@@ -38,10 +43,36 @@ fn chacha20_poly1305_seal(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
                           in_out: &mut [u8], tag_out: &mut [u8; aead::TAG_LEN])
                           -> Result<(), error::Unspecified> {
     let chacha20_key = try!(ctx_as_key(ctx));
-    let mut counter = chacha::make_counter(nonce, 1);
-    chacha::chacha20_xor_in_place(&chacha20_key, &counter, in_out);
-    counter[0] = 0;
-    aead_poly1305(tag_out, chacha20_key, &counter, ad, in_out);
+    let counter = chacha::make_counter(nonce, 0);
+    let mut poly = poly1305_begin(chacha20_key, &counter, ad);
+
+    // Interleave the two passes in cache-sized chunks so each chunk of
+    // ciphertext is fed to Poly1305 while it is still in cache, rather than
+    // encrypting the whole payload and then making a second full trip
+    // through memory to authenticate it.
+    let mut chunk_counter = 1u32;
+    for chunk in in_out.chunks_mut(FUSED_CHUNK_LEN) {
+        let counter = chacha::make_counter(nonce, chunk_counter);
+        chacha::chacha20_xor_in_place(chacha20_key, &counter, chunk);
+        poly.update(chunk);
+        chunk_counter = chunk_counter
+            .wrapping_add((FUSED_CHUNK_LEN / CHACHA20_BLOCK_LEN) as u32);
+    }
+    poly1305_finish(poly, ad.len(), in_out.len(), tag_out);
+    Ok(())
+}
+
+/// Authentication only: derives the Poly1305 key, absorbs `ad`, and emits
+/// the tag, which is the same as sealing an empty payload. The ChaCha20 key
+/// is used only for the one block that derives the Poly1305 key.
+fn chacha20_poly1305_sign(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
+                          nonce: &[u8; aead::NONCE_LEN], ad: &[u8],
+                          tag_out: &mut [u8; aead::TAG_LEN])
+                          -> Result<(), error::Unspecified> {
+    let chacha20_key = try!(ctx_as_key(ctx));
+    let counter = chacha::make_counter(nonce, 0);
+    let poly = poly1305_begin(chacha20_key, &counter, ad);
+    poly1305_finish(poly, ad.len(), 0, tag_out);
     Ok(())
 }
 
@@ -51,17 +82,122 @@ fn chacha20_poly1305_open(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
                           tag_out: &mut [u8; aead::TAG_LEN])
                           -> Result<(), error::Unspecified> {
     let chacha20_key = try!(ctx_as_key(ctx));
-    let mut counter = chacha::make_counter(nonce, 0);
-    {
-        let ciphertext = &in_out[in_prefix_len..];
-        aead_poly1305(tag_out, chacha20_key, &counter, ad, ciphertext);
+    let counter = chacha::make_counter(nonce, 0);
+    let mut poly = poly1305_begin(chacha20_key, &counter, ad);
+
+    // As in `seal`, interleave the passes in cache-sized chunks. Each chunk
+    // is authenticated, shifted forward over the prefix so that its input
+    // and output exactly overlap, and then decrypted in place. The shift is
+    // necessary anyway on 32-bit x86 and some ARM branches, whose assembly
+    // only supports overlapping input/output when they overlap exactly
+    // (https://rt.openssl.org/Ticket/Display.html?id=4362), and since the
+    // chunk was just read by Poly1305 it is a cheap cache-hot copy.
+    let ciphertext_len = in_out.len() - in_prefix_len;
+    let mut chunk_counter = 1u32;
+    let mut offset = 0;
+    while offset < ciphertext_len {
+        let chunk_len =
+            core::cmp::min(FUSED_CHUNK_LEN, ciphertext_len - offset);
+        poly.update(&in_out[(in_prefix_len + offset)..
+                            (in_prefix_len + offset + chunk_len)]);
+        if in_prefix_len != 0 {
+            unsafe {
+                core::ptr::copy(in_out[(in_prefix_len + offset)..].as_ptr(),
+                                in_out[offset..].as_mut_ptr(), chunk_len);
+            }
+        }
+        let counter = chacha::make_counter(nonce, chunk_counter);
+        chacha::chacha20_xor_in_place(chacha20_key, &counter,
+                                      &mut in_out[offset..
+                                                  (offset + chunk_len)]);
+        chunk_counter = chunk_counter
+            .wrapping_add((FUSED_CHUNK_LEN / CHACHA20_BLOCK_LEN) as u32);
+        offset += chunk_len;
     }
-    counter[0] = 1;
-    chacha::chacha20_xor_overlapping(&chacha20_key, &counter, in_out,
-                                     in_prefix_len);
+    poly1305_finish(poly, ad.len(), ciphertext_len, tag_out);
     Ok(())
 }
 
+// A multiple of both the ChaCha20 block length and the Poly1305 block length
+// that fits comfortably in L1D alongside the working state, so a chunk is
+// still cached when the second primitive reads it.
+const FUSED_CHUNK_LEN: usize = 1 << 14;
+
+fn chacha20_poly1305_stream_init(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS],
+                                 nonce: &[u8; aead::NONCE_LEN], ad: &[u8])
+                                 -> Result<aead::Stream, error::Unspecified> {
+    let chacha20_key = try!(ctx_as_key(ctx));
+    let counter = chacha::make_counter(nonce, 0);
+    let poly = poly1305_begin(chacha20_key, &counter, ad);
+    Ok(aead::Stream::ChaCha20Poly1305(Stream {
+        chacha20_key: *chacha20_key,
+        nonce: *nonce,
+        next_counter: 1,
+        poly: poly,
+        ad_len: ad.len(),
+        ciphertext_len: 0,
+    }))
+}
+
+/// The state of a multi-part ChaCha20-Poly1305 operation. The Poly1305 key
+/// was derived and the AD absorbed at initialization; each update encrypts or
+/// decrypts with the keystream starting at `next_counter` and feeds the
+/// ciphertext to `poly`.
+pub struct Stream {
+    chacha20_key: chacha::Key,
+    nonce: [u8; aead::NONCE_LEN],
+    next_counter: u32,
+    poly: poly1305::SigningContext,
+    ad_len: usize,
+    ciphertext_len: usize,
+}
+
+impl Stream {
+    pub fn seal_update(&mut self, in_out: &mut [u8])
+                       -> Result<(), error::Unspecified> {
+        let counter = try!(self.advance(in_out.len()));
+        chacha::chacha20_xor_in_place(&self.chacha20_key, &counter, in_out);
+        self.poly.update(in_out);
+        self.ciphertext_len += in_out.len();
+        Ok(())
+    }
+
+    pub fn open_update(&mut self, in_out: &mut [u8])
+                       -> Result<(), error::Unspecified> {
+        let counter = try!(self.advance(in_out.len()));
+        self.poly.update(in_out);
+        self.ciphertext_len += in_out.len();
+        chacha::chacha20_xor_in_place(&self.chacha20_key, &counter, in_out);
+        Ok(())
+    }
+
+    pub fn tag(self, tag_out: &mut [u8; aead::TAG_LEN]) {
+        poly1305_finish(self.poly, self.ad_len, self.ciphertext_len, tag_out);
+    }
+
+    /// Returns the counter for the next update and advances it past the
+    /// blocks that an update of `len` bytes will consume. The caller
+    /// (`aead::SealingContext` / `aead::OpeningContext`) only passes a
+    /// non-multiple of the 64-byte block length for the final update, so the
+    /// rounding up here never skips keystream that a later update would need.
+    fn advance(&mut self, len: usize)
+               -> Result<chacha::Counter, error::Unspecified> {
+        let counter = chacha::make_counter(&self.nonce, self.next_counter);
+        let blocks = (polyfill::u64_from_usize(len) +
+                      (CHACHA20_BLOCK_LEN as u64 - 1)) /
+                     (CHACHA20_BLOCK_LEN as u64);
+        let next = (self.next_counter as u64) + blocks;
+        // `aead::check_per_nonce_max_bytes` limits the stream to fewer bytes
+        // than the 32-bit block counter can count, so this is unreachable,
+        // but re-check here rather than let the counter wrap.
+        if next > (1u64 << 32) {
+            return Err(error::Unspecified);
+        }
+        self.next_counter = next as u32;
+        Ok(counter)
+    }
+}
+
 fn ctx_as_key(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS])
               -> Result<&chacha::Key, error::Unspecified> {
     slice_as_array_ref!(
@@ -69,16 +205,28 @@ fn ctx_as_key(ctx: &[u64; aead::KEY_CTX_BUF_ELEMS])
         chacha::KEY_LEN_IN_BYTES / 4)
 }
 
-fn aead_poly1305(tag_out: &mut [u8; aead::TAG_LEN], chacha20_key: &chacha::Key,
-                 counter: &chacha::Counter, ad: &[u8], ciphertext: &[u8]) {
+/// Derives the per-nonce Poly1305 key and absorbs the (padded) authenticated
+/// data, returning the context ready for the ciphertext.
+fn poly1305_begin(chacha20_key: &chacha::Key, counter: &chacha::Counter,
+                  ad: &[u8]) -> poly1305::SigningContext {
     debug_assert_eq!(counter[0], 0);
     let key = poly1305::Key::derive_using_chacha(chacha20_key, counter);
     let mut ctx = poly1305::SigningContext::from_key(key);
     poly1305_update_padded_16(&mut ctx, ad);
-    poly1305_update_padded_16(&mut ctx, ciphertext);
+    ctx
+}
+
+/// Pads the absorbed ciphertext to a Poly1305 block, absorbs the lengths, and
+/// emits the tag.
+fn poly1305_finish(mut ctx: poly1305::SigningContext, ad_len: usize,
+                   ciphertext_len: usize, tag_out: &mut [u8; aead::TAG_LEN]) {
+    if ciphertext_len % 16 != 0 {
+        static PADDING: [u8; 16] = [0u8; 16];
+        ctx.update(&PADDING[..16 - (ciphertext_len % 16)]);
+    }
     let lengths =
-        [polyfill::u64_from_usize(ad.len()).to_le(),
-         polyfill::u64_from_usize(ciphertext.len()).to_le()];
+        [polyfill::u64_from_usize(ad_len).to_le(),
+         polyfill::u64_from_usize(ciphertext_len).to_le()];
     ctx.update(polyfill::slice::u64_as_u8(&lengths));
     ctx.sign(tag_out);
 }
@@ -96,10 +244,59 @@ fn poly1305_update_padded_16(ctx: &mut poly1305::SigningContext, data: &[u8]) {
 #[cfg(test)]
 mod tests {
     use aead;
+    use super::FUSED_CHUNK_LEN;
 
     #[test]
     pub fn test_chacha20_poly1305() {
         aead::tests::test_aead(&aead::CHACHA20_POLY1305,
             "src/aead/chacha20_poly1305_tests.txt");
     }
+
+    // The test vectors are all much smaller than `FUSED_CHUNK_LEN`, so
+    // exercise the chunked interleaving across chunk boundaries: sealing
+    // must agree with the (differently-chunked) multi-part path, and
+    // opening must round-trip.
+    #[test]
+    pub fn test_fused_chunking() {
+        use std::vec::Vec;
+
+        let key_bytes = [31u8; 32];
+        let s_key = aead::SealingKey::new(&aead::CHACHA20_POLY1305,
+                                          &key_bytes).unwrap();
+        let o_key = aead::OpeningKey::new(&aead::CHACHA20_POLY1305,
+                                          &key_bytes).unwrap();
+        let nonce = [9u8; 12];
+        let ad = [3u8; 7];
+        let tag_len = aead::CHACHA20_POLY1305.tag_len();
+
+        static LENS: [usize; 4] = [FUSED_CHUNK_LEN - 1, FUSED_CHUNK_LEN,
+                                   FUSED_CHUNK_LEN + 1,
+                                   (3 * FUSED_CHUNK_LEN) + 33];
+        for len in LENS.iter() {
+            let plaintext: Vec<u8> =
+                (0..*len).map(|i| (i % 239) as u8).collect();
+
+            let mut sealed = plaintext.clone();
+            for _ in 0..tag_len {
+                sealed.push(0);
+            }
+            let sealed_len = aead::seal_in_place(&s_key, &nonce, &ad,
+                                                 &mut sealed, tag_len)
+                .unwrap();
+            assert_eq!(len + tag_len, sealed_len);
+
+            let mut streamed = plaintext.clone();
+            let mut tag = [0u8; aead::MAX_TAG_LEN];
+            let mut ctx =
+                aead::SealingContext::new(&s_key, &nonce, &ad).unwrap();
+            ctx.update(&mut streamed[..(3 * 64)]).unwrap();
+            ctx.finish(&mut streamed[(3 * 64)..], &mut tag).unwrap();
+            assert_eq!(&sealed[..*len], &streamed[..]);
+            assert_eq!(&sealed[*len..], &tag[..]);
+
+            let opened = aead::open_in_place(&o_key, &nonce, &ad, 0,
+                                             &mut sealed).unwrap();
+            assert_eq!(&plaintext[..], &opened[..]);
+        }
+    }
 }
@@ -29,7 +29,8 @@
 //!    http://cvsweb.openbsd.org/cgi-bin/cvsweb/src/usr.bin/ssh/PROTOCOL.chacha20poly1305?annotate=HEAD
 //! [RFC 4253]: https://tools.ietf.org/html/rfc4253
 
-use {chacha, error, poly1305};
+use {chacha, constant_time, error, poly1305};
+use core;
 
 /// A key for sealing packets.
 pub struct SealingKey {
@@ -105,31 +106,94 @@ impl OpeningKey {
     /// encrypted `plaintext`. When the function succeeds the ciphertext is
     /// replaced by the plaintext and the result is `Ok(plaintext)`, where
     /// `plaintext` is `&ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..]`;
-    /// otherwise the contents of `ciphertext_in_plaintext_out` are unspecified
-    /// and must not be used.
+    /// otherwise `&ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..]` is
+    /// zeroed.
     pub fn open_in_place<'a>(&self, sequence_number: u32,
                              ciphertext_in_plaintext_out: &'a mut [u8],
                              tag: &[u8; TAG_LEN])
                              -> Result<&'a [u8], error::Unspecified> {
+        if ciphertext_in_plaintext_out.len() < PACKET_LENGTH_LEN {
+            return Err(error::Unspecified);
+        }
+
         let mut counter = make_counter(sequence_number);
 
-        // We must verify the tag before decrypting so that
-        // `ciphertext_in_plaintext_out` is unmodified if verification fails.
-        // This is beyond what we guarantee.
-        let poly_key = poly1305::Key::derive_using_chacha(&self.key.k_2,
-                                                          &counter);
-        try!(poly1305::verify(poly_key, ciphertext_in_plaintext_out, tag));
+        // Block 0 of the `K_2` key stream is the Poly1305 key and blocks
+        // 1... are the payload key stream, so a single ChaCha20 session
+        // serves both: the first invocation below produces the key block
+        // together with the head of the payload key stream, and the chunk
+        // loop continues the same counter sequence. The MAC over each chunk
+        // of ciphertext is computed just before the chunk is decrypted,
+        // while the data is still in cache.
+        //
+        // Decrypting before the tag check lands is safe only because the
+        // plaintext isn't released to the caller until the check succeeds;
+        // on failure, the decrypted payload is zeroed before returning so
+        // that no unauthenticated plaintext is left in the caller's buffer.
+        let payload_len = ciphertext_in_plaintext_out.len() -
+                          PACKET_LENGTH_LEN;
+        let head_len = core::cmp::min(payload_len, OPEN_CHUNK_LEN);
 
-        let plaintext_in_ciphertext_out =
-            &mut ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..];
-        counter[0] = 1;
+        let mut head = [0u8; chacha::BLOCK_LEN + OPEN_CHUNK_LEN];
+        head[chacha::BLOCK_LEN..(chacha::BLOCK_LEN + head_len)]
+            .copy_from_slice(
+                &ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..
+                                             (PACKET_LENGTH_LEN + head_len)]);
         chacha::chacha20_xor_in_place(&self.key.k_2, &counter,
-                                      plaintext_in_ciphertext_out);
+                                      &mut head[..(chacha::BLOCK_LEN +
+                                                   head_len)]);
+
+        let poly_key = poly1305::Key::from_bytes(
+            slice_as_array_ref!(&head[..poly1305::KEY_LEN],
+                                poly1305::KEY_LEN).unwrap());
+        let mut poly_ctx = poly1305::SigningContext::from_key(poly_key);
+
+        // The ciphertext of the head, and the encrypted packet length in
+        // front of it, are still intact in the caller's buffer.
+        poly_ctx.update(
+            &ciphertext_in_plaintext_out[..(PACKET_LENGTH_LEN + head_len)]);
+        ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..
+                                    (PACKET_LENGTH_LEN + head_len)]
+            .copy_from_slice(&head[chacha::BLOCK_LEN..
+                                   (chacha::BLOCK_LEN + head_len)]);
 
-        Ok(plaintext_in_ciphertext_out)
+        let mut offset = head_len;
+        while offset < payload_len {
+            let todo = core::cmp::min(payload_len - offset, OPEN_CHUNK_LEN);
+            poly_ctx.update(
+                &ciphertext_in_plaintext_out[(PACKET_LENGTH_LEN + offset)..
+                                             (PACKET_LENGTH_LEN + offset +
+                                              todo)]);
+            counter[0] = 1 + (offset / chacha::BLOCK_LEN) as u32;
+            chacha::chacha20_xor_in_place(
+                &self.key.k_2, &counter,
+                &mut ciphertext_in_plaintext_out[(PACKET_LENGTH_LEN +
+                                                  offset)..
+                                                 (PACKET_LENGTH_LEN + offset +
+                                                  todo)]);
+            offset += todo;
+        }
+
+        let mut calculated_tag = [0u8; TAG_LEN];
+        poly_ctx.sign(&mut calculated_tag);
+        if constant_time::verify_slices_are_equal(&calculated_tag[..],
+                                                  &tag[..]).is_err() {
+            for b in &mut ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..] {
+                *b = 0;
+            }
+            return Err(error::Unspecified);
+        }
+
+        Ok(&ciphertext_in_plaintext_out[PACKET_LENGTH_LEN..])
     }
 }
 
+// `open_in_place` decrypts and MACs in chunks of this many bytes. It must be
+// a multiple of `chacha::BLOCK_LEN` so that every chunk starts on a ChaCha20
+// block boundary, and it bounds the stack buffer through which the first
+// chunk is decrypted. Most SSH packets fit in a single chunk.
+const OPEN_CHUNK_LEN: usize = 1024;
+
 struct Key {
     k_1: chacha::Key,
     k_2: chacha::Key,
@@ -169,3 +233,78 @@ pub const TAG_LEN: usize = poly1305::TAG_LEN;
 
 /// The length in bytes of the `packet_length` field in a SSH packet.
 pub const PACKET_LENGTH_LEN: usize = 4; // 32 bits
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // Round-trip coverage for the chunked, single-ChaCha20-session open
+    // path, with payloads shorter than, equal to, and spanning multiples of
+    // `OPEN_CHUNK_LEN`.
+    #[test]
+    fn test_seal_open_roundtrip() {
+        let mut key_material = [0u8; KEY_LEN];
+        for (i, b) in key_material.iter_mut().enumerate() {
+            *b = i as u8;
+        }
+        let sealing_key = SealingKey::new(&key_material);
+        let opening_key = OpeningKey::new(&key_material);
+
+        // Inputs too short to contain even the packet length must be
+        // rejected, not panic.
+        for len in 0..PACKET_LENGTH_LEN {
+            let mut in_out = vec![0u8; len];
+            let tag = [0u8; TAG_LEN];
+            assert!(opening_key.open_in_place(0, &mut in_out, &tag).is_err());
+        }
+
+        static PAYLOAD_LENS: &'static [usize] =
+            &[0, 1, 63, 64, 65, OPEN_CHUNK_LEN - 1, OPEN_CHUNK_LEN,
+              OPEN_CHUNK_LEN + 1, (2 * OPEN_CHUNK_LEN) + 37];
+        for &payload_len in PAYLOAD_LENS {
+            for &sequence_number in &[0u32, 1, 0xffff_ffff] {
+                let mut plaintext = vec![0u8; PACKET_LENGTH_LEN + payload_len];
+                for (i, b) in plaintext.iter_mut().enumerate() {
+                    *b = (i % 251) as u8;
+                }
+
+                let mut in_out = plaintext.clone();
+                let mut tag = [0u8; TAG_LEN];
+                sealing_key.seal_in_place(sequence_number, &mut in_out,
+                                          &mut tag);
+
+                {
+                    let packet_length = opening_key.decrypt_packet_length(
+                        sequence_number,
+                        *slice_as_array_ref!(&in_out[..PACKET_LENGTH_LEN],
+                                             PACKET_LENGTH_LEN).unwrap());
+                    assert_eq!(&packet_length[..],
+                               &plaintext[..PACKET_LENGTH_LEN]);
+                }
+
+                {
+                    let mut in_out = in_out.clone();
+                    let plaintext_out = opening_key
+                        .open_in_place(sequence_number, &mut in_out, &tag)
+                        .unwrap();
+                    assert_eq!(plaintext_out,
+                               &plaintext[PACKET_LENGTH_LEN..]);
+                }
+
+                // A corrupted tag must be rejected, and no unauthenticated
+                // plaintext may be left behind in the buffer.
+                {
+                    let mut in_out = in_out.clone();
+                    let mut bad_tag = tag;
+                    bad_tag[0] ^= 1;
+                    assert!(opening_key
+                                .open_in_place(sequence_number, &mut in_out,
+                                               &bad_tag)
+                                .is_err());
+                    assert!(in_out[PACKET_LENGTH_LEN..].iter()
+                                .all(|&b| b == 0));
+                }
+            }
+        }
+    }
+}
@@ -77,7 +77,7 @@
 
 
 
-use {ec, error, rand};
+use {ec, error, rand, std};
 use untrusted;
 
 
@@ -85,7 +85,7 @@ pub use ec::PUBLIC_KEY_MAX_LEN;
 
 pub use ec::suite_b::ecdh::{ECDH_P256, ECDH_P384};
 
-pub use ec::curve25519::x25519::X25519;
+pub use ec::curve25519::x25519::{X25519, x25519_agree_batch};
 
 
 /// A key agreement algorithm.
@@ -228,9 +228,103 @@ pub fn agree_ephemeral<F, R, E>(my_private_key: EphemeralPrivateKey,
 }
 
 
+/// An ephemeral private key together with its already-computed public key, as
+/// held by an `EphemeralKeyPairPool`.
+pub struct EphemeralKeyPair {
+    private_key: EphemeralPrivateKey,
+    public_key: [u8; PUBLIC_KEY_MAX_LEN],
+}
+
+impl<'a> EphemeralKeyPair {
+    /// Generates a new ephemeral key pair, computing the public key eagerly.
+    pub fn generate(alg: &'static Algorithm, rng: &rand::SecureRandom)
+                    -> Result<EphemeralKeyPair, error::Unspecified> {
+        let private_key = try!(EphemeralPrivateKey::generate(alg, rng));
+        let mut public_key = [0u8; PUBLIC_KEY_MAX_LEN];
+        try!(private_key.compute_public_key(
+                &mut public_key[..private_key.public_key_len()]));
+        Ok(EphemeralKeyPair {
+            private_key: private_key,
+            public_key: public_key,
+        })
+    }
+
+    /// The encoded public key, ready to be sent to the peer.
+    #[inline]
+    pub fn public_key(&'a self) -> &'a [u8] {
+        &self.public_key[..self.private_key.public_key_len()]
+    }
+
+    /// Extracts the private key, to be passed to `agree_ephemeral`.
+    #[inline]
+    pub fn into_private_key(self) -> EphemeralPrivateKey { self.private_key }
+}
+
+
+/// A pool of pre-generated ephemeral key pairs.
+///
+/// Ephemeral key generation is a fixed-base scalar multiplication plus a call
+/// into the secure random number generator, which is a significant fraction
+/// of the public-key cost of a handshake. A pool moves that work off the
+/// handshake critical path: a background thread keeps the pool topped up with
+/// `refill` while handshakes call `take`.
+///
+/// `take` never fails just because the pool is empty; it falls back to
+/// generating a fresh key pair on the calling thread.
+pub struct EphemeralKeyPairPool {
+    alg: &'static Algorithm,
+    key_pairs: std::sync::Mutex<std::vec::Vec<EphemeralKeyPair>>,
+    capacity: usize,
+}
+
+impl EphemeralKeyPairPool {
+    /// Creates an empty pool that holds up to `capacity` key pairs for `alg`.
+    pub fn new(alg: &'static Algorithm, capacity: usize)
+               -> EphemeralKeyPairPool {
+        EphemeralKeyPairPool {
+            alg: alg,
+            key_pairs: std::sync::Mutex::new(std::vec::Vec::new()),
+            capacity: capacity,
+        }
+    }
+
+    /// Tops the pool up to its capacity. Each key pair is generated outside
+    /// the pool's lock, so concurrent calls to `take` are never blocked
+    /// behind key generation.
+    pub fn refill(&self, rng: &rand::SecureRandom)
+                  -> Result<(), error::Unspecified> {
+        while self.len() < self.capacity {
+            let key_pair = try!(EphemeralKeyPair::generate(self.alg, rng));
+            let mut key_pairs = self.key_pairs.lock().unwrap();
+            if key_pairs.len() >= self.capacity {
+                break;
+            }
+            key_pairs.push(key_pair);
+        }
+        Ok(())
+    }
+
+    /// Takes a key pair from the pool, generating a fresh one on the calling
+    /// thread if the pool is empty.
+    pub fn take(&self, rng: &rand::SecureRandom)
+                -> Result<EphemeralKeyPair, error::Unspecified> {
+        {
+            let mut key_pairs = self.key_pairs.lock().unwrap();
+            if let Some(key_pair) = key_pairs.pop() {
+                return Ok(key_pair);
+            }
+        }
+        EphemeralKeyPair::generate(self.alg, rng)
+    }
+
+    /// The number of key pairs currently in the pool.
+    pub fn len(&self) -> usize { self.key_pairs.lock().unwrap().len() }
+}
+
+
 #[cfg(test)]
 mod tests {
-    use {test, rand};
+    use {error, test, rand, std};
     use untrusted;
     use super::*;
 
@@ -288,6 +382,42 @@ mod tests {
         });
     }
 
+    #[test]
+    fn test_agreement_ephemeral_key_pair_pool() {
+        let rng = rand::SystemRandom::new();
+
+        let pool = EphemeralKeyPairPool::new(&X25519, 4);
+        assert_eq!(pool.len(), 0);
+        pool.refill(&rng).unwrap();
+        assert_eq!(pool.len(), 4);
+
+        // A key pair from the pool agrees with a freshly-generated peer.
+        let my_key_pair = pool.take(&rng).unwrap();
+        assert_eq!(pool.len(), 3);
+        let peer_key_pair = EphemeralKeyPair::generate(&X25519, &rng).unwrap();
+
+        let my_public = std::vec::Vec::from(my_key_pair.public_key());
+        let peer_public = std::vec::Vec::from(peer_key_pair.public_key());
+
+        let my_secret = agree_ephemeral(
+            my_key_pair.into_private_key(), &X25519,
+            untrusted::Input::from(&peer_public), error::Unspecified,
+            |key_material| Ok(std::vec::Vec::from(key_material))).unwrap();
+        let peer_secret = agree_ephemeral(
+            peer_key_pair.into_private_key(), &X25519,
+            untrusted::Input::from(&my_public), error::Unspecified,
+            |key_material| Ok(std::vec::Vec::from(key_material))).unwrap();
+        assert_eq!(my_secret, peer_secret);
+
+        // Draining the pool falls back to on-demand generation.
+        for _ in 0..3 {
+            let _ = pool.take(&rng).unwrap();
+        }
+        assert_eq!(pool.len(), 0);
+        assert!(pool.take(&rng).is_ok());
+        assert_eq!(pool.len(), 0);
+    }
+
     fn alg_from_curve_name(curve_name: &str) -> &'static Algorithm {
         if curve_name == "P-256" {
             &ECDH_P256
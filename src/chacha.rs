@@ -33,38 +33,43 @@ pub fn chacha20_xor_in_place(key: &Key, counter: &Counter, in_out: &mut [u8]) {
                        in_out.as_mut_ptr());
 }
 
-pub fn chacha20_xor_overlapping(key: &Key, counter: &Counter,
-                                in_out: &mut [u8], in_prefix_len: usize) {
-    // XXX: The x86 and at least one branch of the ARM assembly language
-    // code doesn't allow overlapping input and output unless they are
-    // exactly overlapping. TODO: Figure out which branch of the ARM code
-    // has this limitation and come up with a better solution.
-    //
-    // https://rt.openssl.org/Ticket/Display.html?id=4362
-    let len = in_out.len() - in_prefix_len;
-    if cfg!(any(target_arch = "arm", target_arch = "x86")) &&
-            in_prefix_len != 0 {
-        unsafe {
-            core::ptr::copy(in_out[in_prefix_len..].as_ptr(),
-                            in_out.as_mut_ptr(), len);
-        }
-        chacha20_xor_in_place(key, &counter, &mut in_out[..len]);
-    } else {
-        chacha20_xor_inner(key, counter, in_out[in_prefix_len..].as_ptr(),
-                           len, in_out.as_mut_ptr());
-    }
-}
-
 #[inline]
 pub fn chacha20_xor_inner(key: &Key, counter: &Counter, input: *const u8,
                           in_out_len: usize, output: *mut u8) {
     debug_assert!(core::mem::align_of_val(key) >= 4);
     debug_assert!(core::mem::align_of_val(counter) >= 4);
     unsafe {
-        GFp_ChaCha20_ctr32(output, input, in_out_len, key, counter);
+        if !chacha20_ctr32_fast_path(output, input, in_out_len, key, counter) {
+            GFp_ChaCha20_ctr32(output, input, in_out_len, key, counter);
+        }
     }
 }
 
+// The AVX-512 kernel processes four blocks per iteration, so only inputs of
+// at least four blocks are routed to it. Like the callers of this module, it
+// requires the input and output buffers to overlap exactly or not at all;
+// exact overlap is safe because each 64-byte group is fully read before it
+// is written.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+unsafe fn chacha20_ctr32_fast_path(output: *mut u8, input: *const u8,
+                                   in_out_len: usize, key: &Key,
+                                   counter: &Counter) -> bool {
+    if in_out_len < 256 || GFp_chacha20_avx512_capable() != 1 {
+        return false;
+    }
+    GFp_ChaCha20_ctr32_avx512(output, input, in_out_len, key, counter);
+    true
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+#[inline]
+unsafe fn chacha20_ctr32_fast_path(_output: *mut u8, _input: *const u8,
+                                   _in_out_len: usize, _key: &Key,
+                                   _counter: &Counter) -> bool {
+    false
+}
+
 pub type Counter = [u32; 4];
 
 #[inline]
@@ -80,8 +85,18 @@ extern {
                           key: &Key, counter: &Counter);
 }
 
+#[cfg(target_arch = "x86_64")]
+extern {
+    fn GFp_chacha20_avx512_capable() -> c::int;
+    fn GFp_ChaCha20_ctr32_avx512(out: *mut u8, in_: *const u8,
+                                 in_len: c::size_t, key: &Key,
+                                 counter: &Counter);
+}
+
 pub const KEY_LEN_IN_BYTES: usize = 256 / 8;
 
+pub const BLOCK_LEN: usize = 64;
+
 pub const NONCE_LEN: usize = 12; /* 96 bits */
 
 #[cfg(test)]
@@ -25,7 +25,16 @@ pub fn verify_slices_are_equal(a: &[u8], b: &[u8])
     if a.len() != b.len() {
         return Err(error::Unspecified);
     }
-    let result = unsafe { GFp_memcmp(a.as_ptr(), b.as_ptr(), a.len()) };
+    // 16 bytes is the tag length of every AEAD in the library, so tag
+    // verification on the open paths takes the vectorized single-block
+    // comparison.
+    let result = unsafe {
+        if a.len() == 16 {
+            GFp_memcmp_16(a.as_ptr(), b.as_ptr())
+        } else {
+            GFp_memcmp(a.as_ptr(), b.as_ptr(), a.len())
+        }
+    };
     match result {
         0 => Ok(()),
         _ => Err(error::Unspecified),
@@ -34,4 +43,5 @@ pub fn verify_slices_are_equal(a: &[u8], b: &[u8])
 
 extern {
     fn GFp_memcmp(a: *const u8, b: *const u8, len: c::size_t) -> c::int;
+    fn GFp_memcmp_16(a: *const u8, b: *const u8) -> c::int;
 }
@@ -24,8 +24,9 @@
 // The goal for this implementation is to drive the overhead as close to zero
 // as possible.
 
-use {c, init, polyfill};
+use {c, error, init, polyfill};
 use core;
+use std;
 
 // XXX: Replace with `const fn` when `const fn` is stable:
 // https://github.com/rust-lang/rust/issues/24111
@@ -193,6 +194,198 @@ impl Context {
     /// The algorithm that this context is using.
     #[inline(always)]
     pub fn algorithm(&self) -> &'static Algorithm { self.algorithm }
+
+    /// Serializes the context's intermediate state as a checkpoint from
+    /// which `deserialize` can resume the calculation, potentially in
+    /// another process, without re-hashing the data already processed.
+    ///
+    /// The encoding is fixed-length and stable: a one-byte algorithm tag,
+    /// the completed block count (big-endian), the number of buffered bytes,
+    /// the chaining state words (big-endian), and the buffered partial
+    /// block. The serialized state is an intermediate hash value, not a
+    /// secret, but it is also not a commitment to the data hashed so far;
+    /// checkpoints must be stored and transported with the same integrity
+    /// protection as the data itself.
+    pub fn serialize(&self) -> [u8; CONTEXT_SERIALIZED_LEN] {
+        let mut serialized = [0u8; CONTEXT_SERIALIZED_LEN];
+        serialized[0] = algorithm_id(self.algorithm);
+        let mut blocks = self.completed_data_blocks;
+        for b in serialized[1..9].iter_mut().rev() {
+            *b = blocks as u8;
+            blocks /= 0x100;
+        }
+        serialized[9] = self.num_pending as u8;
+        for (bytes, word) in serialized[10..(10 + 8 * 8)].chunks_mut(8)
+                                .zip(self.state.iter()) {
+            let mut word = *word;
+            for b in bytes.iter_mut().rev() {
+                *b = word as u8;
+                word /= 0x100;
+            }
+        }
+        // Only the buffered prefix of `pending` is meaningful; don't copy
+        // stale bytes from beyond it into the serialized form.
+        serialized[(10 + 8 * 8)..(10 + 8 * 8 + self.num_pending)]
+            .copy_from_slice(&self.pending[..self.num_pending]);
+        serialized
+    }
+
+    /// Recreates a context from a value previously returned by `serialize`,
+    /// including which algorithm it is using.
+    ///
+    /// Returns an error if `serialized` is the wrong length, names an
+    /// unknown algorithm, or contains an out-of-range buffered-byte or
+    /// block count.
+    pub fn deserialize(serialized: &[u8])
+                       -> Result<Context, error::Unspecified> {
+        init::init_once();
+
+        if serialized.len() != CONTEXT_SERIALIZED_LEN {
+            return Err(error::Unspecified);
+        }
+        let algorithm = try!(algorithm_from_id(serialized[0]));
+        let mut completed_data_blocks = 0u64;
+        for b in &serialized[1..9] {
+            completed_data_blocks = (completed_data_blocks << 8) |
+                                    (*b as u64);
+        }
+        let num_pending = serialized[9] as usize;
+        if num_pending >= algorithm.block_len {
+            return Err(error::Unspecified);
+        }
+        // Reject counts that would overflow the bit counter in `finish()`.
+        if completed_data_blocks
+            .checked_mul(polyfill::u64_from_usize(algorithm.block_len))
+            .and_then(|bytes| {
+                bytes.checked_add(polyfill::u64_from_usize(num_pending))
+            })
+            .and_then(|bytes| bytes.checked_mul(8))
+            .is_none() {
+            return Err(error::Unspecified);
+        }
+        let mut state: State = [0; MAX_CHAINING_LEN / 8];
+        for (word, bytes) in state.iter_mut()
+                                .zip(serialized[10..(10 + 8 * 8)].chunks(8)) {
+            let mut value = 0u64;
+            for b in bytes {
+                value = (value << 8) | (*b as u64);
+            }
+            *word = value;
+        }
+        let mut pending = [0u8; MAX_BLOCK_LEN];
+        pending[..num_pending].copy_from_slice(
+            &serialized[(10 + 8 * 8)..(10 + 8 * 8 + num_pending)]);
+        Ok(Context {
+            state: state,
+            completed_data_blocks: completed_data_blocks,
+            pending: pending,
+            num_pending: num_pending,
+            algorithm: algorithm,
+        })
+    }
+}
+
+/// The length, in bytes, of the value returned by `Context::serialize`.
+pub const CONTEXT_SERIALIZED_LEN: usize = 10 + 8 * 8 + MAX_BLOCK_LEN;
+
+// Stable one-byte identifiers for the serialized form of `Context`. These
+// values must never be reassigned to other algorithms.
+fn algorithm_id(algorithm: &'static Algorithm) -> u8 {
+    if algorithm as *const Algorithm == &SHA1 as *const Algorithm {
+        1
+    } else if algorithm as *const Algorithm == &SHA256 as *const Algorithm {
+        2
+    } else if algorithm as *const Algorithm == &SHA384 as *const Algorithm {
+        3
+    } else if algorithm as *const Algorithm == &SHA512 as *const Algorithm {
+        4
+    } else {
+        unreachable!();
+    }
+}
+
+fn algorithm_from_id(id: u8)
+                     -> Result<&'static Algorithm, error::Unspecified> {
+    match id {
+        1 => Ok(&SHA1),
+        2 => Ok(&SHA256),
+        3 => Ok(&SHA384),
+        4 => Ok(&SHA512),
+        _ => Err(error::Unspecified),
+    }
+}
+
+/// Precomputed state for repeatedly digesting messages that consist of the
+/// block-aligned data already absorbed by a `Context` followed by exactly
+/// `tail_len` more bytes, where the tail plus the padding fits in a single
+/// block. Each message then costs one compression function call; the padding
+/// and length suffix are filled in once, up front. This is the hot loop of
+/// PBKDF2, where every message is an HMAC pad block followed by one
+/// digest-length value.
+///
+/// This is an implementation detail of `pbkdf2` and not part of the public
+/// API.
+#[doc(hidden)]
+pub struct OneBlockContext {
+    algorithm: &'static Algorithm,
+    state: State,
+    block: [u8; MAX_BLOCK_LEN],
+    tail_len: usize,
+}
+
+impl OneBlockContext {
+    /// Captures the state of `ctx`, which must have absorbed a whole number
+    /// of blocks. Returns `None` if it hasn't, or if a `tail_len`-byte tail
+    /// can't be padded within a single block.
+    #[doc(hidden)]
+    pub fn from_context(ctx: &Context, tail_len: usize)
+                        -> Option<OneBlockContext> {
+        let block_len = ctx.algorithm.block_len;
+        if ctx.num_pending != 0 ||
+           tail_len + 1 + ctx.algorithm.len_len > block_len {
+            return None;
+        }
+
+        // Fill in the padding and the length suffix, mirroring `finish()`.
+        let mut block = [0u8; MAX_BLOCK_LEN];
+        block[tail_len] = 0x80;
+        let mut completed_data_bits = ctx.completed_data_blocks
+            .checked_mul(polyfill::u64_from_usize(block_len))
+            .unwrap()
+            .checked_add(polyfill::u64_from_usize(tail_len))
+            .unwrap()
+            .checked_mul(8)
+            .unwrap();
+        for b in block[(block_len - 8)..block_len].iter_mut().rev() {
+            *b = completed_data_bits as u8;
+            completed_data_bits /= 0x100;
+        }
+
+        Some(OneBlockContext {
+            algorithm: ctx.algorithm,
+            state: ctx.state,
+            block: block,
+            tail_len: tail_len,
+        })
+    }
+
+    /// Returns the digest of the absorbed prefix followed by `tail`, which
+    /// must be `tail_len` bytes long.
+    #[doc(hidden)]
+    #[inline]
+    pub fn digest(&mut self, tail: &[u8]) -> Digest {
+        assert_eq!(tail.len(), self.tail_len);
+        self.block[..self.tail_len].copy_from_slice(tail);
+        let mut state = self.state;
+        unsafe {
+            (self.algorithm.block_data_order)(&mut state,
+                                              self.block.as_ptr(), 1);
+        }
+        Digest {
+            algorithm: self.algorithm,
+            value: (self.algorithm.format_output)(&state),
+        }
+    }
 }
 
 // XXX: This should just be `#[derive(Clone)]` but that doesn't work because
@@ -232,11 +425,188 @@ impl Clone for Context {
 /// # fn main() { }
 /// ```
 pub fn digest(algorithm: &'static Algorithm, data: &[u8]) -> Digest {
+    record_digest(algorithm, data.len());
     let mut ctx = Context::new(algorithm);
     ctx.update(data);
     ctx.finish()
 }
 
+#[cfg(feature = "dispatch_instrumentation")]
+fn record_digest(algorithm: &'static Algorithm, bytes: usize) {
+    ::dispatch::record_digest(algorithm, bytes);
+}
+
+#[cfg(not(feature = "dispatch_instrumentation"))]
+#[inline(always)]
+fn record_digest(_algorithm: &'static Algorithm, _bytes: usize) {}
+
+/// Returns the digests of the elements of `data`, as if by calling `digest`
+/// with the given digest algorithm on each one.
+///
+/// When there are enough inputs, SHA-256 digests are computed several at a
+/// time on x86-64, with one input in each 32-bit lane of the vector
+/// registers, which gives much better aggregate throughput than hashing the
+/// inputs one at a time; inputs that don't fill a full set of lanes are
+/// hashed one at a time. The result is the same either way, so callers that
+/// have many independent inputs can use this unconditionally.
+pub fn digest_many(algorithm: &'static Algorithm, data: &[&[u8]])
+                   -> std::vec::Vec<Digest> {
+    init::init_once();
+    let mut results = vec![Digest {
+        value: [0; MAX_OUTPUT_LEN / 8],
+        algorithm: algorithm,
+    }; data.len()];
+    if !digest_many_multi_buffer(algorithm, data, &mut results) {
+        for (result, d) in results.iter_mut().zip(data.iter()) {
+            *result = digest(algorithm, d);
+        }
+    }
+    results
+}
+
+#[cfg(target_arch = "x86_64")]
+const SHA256_MB_LANES: usize = 8;
+
+// Fills in `results` for every element of `data`, using the multi-buffer
+// SHA-256 kernel for groups of `SHA256_MB_LANES` inputs and scalar hashing
+// for the leftovers, or returns false to have the caller hash everything one
+// at a time.
+#[cfg(target_arch = "x86_64")]
+fn digest_many_multi_buffer(algorithm: &'static Algorithm, data: &[&[u8]],
+                            results: &mut [Digest]) -> bool {
+    if algorithm as *const Algorithm != &SHA256 as *const Algorithm ||
+       data.len() < SHA256_MB_LANES ||
+       unsafe { GFp_sha256_mb_avx2_capable() } != 1 {
+        return false;
+    }
+
+    // Group inputs of similar length together so that the lanes of each
+    // group run out of blocks at about the same time.
+    let mut order: std::vec::Vec<usize> = (0..data.len()).collect();
+    order.sort_by(|&i, &j| data[j].len().cmp(&data[i].len()));
+
+    for group in order.chunks(SHA256_MB_LANES) {
+        if group.len() < SHA256_MB_LANES {
+            for &i in group {
+                results[i] = digest(algorithm, data[i]);
+            }
+            continue;
+        }
+        sha256_digest_group_x8(data, group, results);
+    }
+    true
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+fn digest_many_multi_buffer(_algorithm: &'static Algorithm, _data: &[&[u8]],
+                            _results: &mut [Digest]) -> bool {
+    false
+}
+
+// Hashes the `SHA256_MB_LANES` elements of `data` selected by `group` with
+// the eight-buffer SHA-256 kernel, writing the digests into the
+// corresponding elements of `results`.
+#[cfg(target_arch = "x86_64")]
+fn sha256_digest_group_x8(data: &[&[u8]], group: &[usize],
+                          results: &mut [Digest]) {
+    const BLOCK_LEN: usize = 512 / 8;
+
+    struct Lane<'a> {
+        msg: &'a [u8],
+        state: State,
+        // The final one or two blocks: the remaining partial message block,
+        // the 0x80 delimiter, and the big-endian bit length, padded per
+        // FIPS 180-4. The single-buffer equivalent is `Context::finish()`.
+        tail: [u8; 2 * BLOCK_LEN],
+        full_blocks: usize,
+        tail_blocks: usize,
+        done_blocks: usize,
+    }
+
+    let mut lanes: std::vec::Vec<Lane> = group.iter().map(|&i| {
+        let msg = data[i];
+        let mut tail = [0u8; 2 * BLOCK_LEN];
+        let pos = msg.len() % BLOCK_LEN;
+        tail[..pos].copy_from_slice(&msg[(msg.len() - pos)..]);
+        tail[pos] = 0x80;
+        let tail_blocks = if pos + 1 + 8 <= BLOCK_LEN { 1 } else { 2 };
+        let mut bits = polyfill::u64_from_usize(msg.len())
+            .checked_mul(8).unwrap();
+        for b in (&mut tail[(tail_blocks * BLOCK_LEN - 8)..
+                            (tail_blocks * BLOCK_LEN)]).into_iter().rev() {
+            *b = bits as u8;
+            bits /= 0x100;
+        }
+        Lane {
+            msg: msg,
+            state: SHA256.initial_state,
+            tail: tail,
+            full_blocks: msg.len() / BLOCK_LEN,
+            tail_blocks: tail_blocks,
+            done_blocks: 0,
+        }
+    }).collect();
+
+    // Advance all the lanes in lockstep, `num` blocks at a time, where `num`
+    // is the largest count for which every unfinished lane has `num`
+    // contiguous blocks left in its current region (message or tail).
+    // Finished lanes are pointed at a scratch state and at one of the active
+    // lanes' data until the whole group is done.
+    let mut scratch: State = SHA256.initial_state;
+    loop {
+        let mut states = [0 as *mut u32; SHA256_MB_LANES];
+        let mut ptrs = [0 as *const u8; SHA256_MB_LANES];
+        let mut num = core::usize::MAX;
+        let mut active_ptr = 0 as *const u8;
+        let mut any_active = false;
+        for (k, lane) in lanes.iter_mut().enumerate() {
+            if lane.done_blocks == lane.full_blocks + lane.tail_blocks {
+                continue;
+            }
+            let (ptr, region_left) = if lane.done_blocks < lane.full_blocks {
+                (lane.msg[(lane.done_blocks * BLOCK_LEN)..].as_ptr(),
+                 lane.full_blocks - lane.done_blocks)
+            } else {
+                let done_tail = lane.done_blocks - lane.full_blocks;
+                (lane.tail[(done_tail * BLOCK_LEN)..].as_ptr(),
+                 lane.tail_blocks - done_tail)
+            };
+            states[k] = lane.state.as_mut_ptr() as *mut u32;
+            ptrs[k] = ptr;
+            if region_left < num {
+                num = region_left;
+            }
+            active_ptr = ptr;
+            any_active = true;
+        }
+        if !any_active {
+            break;
+        }
+        for k in 0..SHA256_MB_LANES {
+            if states[k].is_null() {
+                states[k] = scratch.as_mut_ptr() as *mut u32;
+                ptrs[k] = active_ptr;
+            }
+        }
+        unsafe {
+            GFp_sha256_block_data_order_x8_avx2(states.as_ptr(),
+                                                ptrs.as_ptr(), num);
+        }
+        for lane in lanes.iter_mut() {
+            if lane.done_blocks < lane.full_blocks + lane.tail_blocks {
+                lane.done_blocks += num;
+            }
+        }
+    }
+
+    for (lane, &i) in lanes.iter().zip(group.iter()) {
+        results[i] = Digest {
+            value: (SHA256.format_output)(&lane.state),
+            algorithm: &SHA256,
+        };
+    }
+}
+
 /// A calculated digest value.
 ///
 /// Use `as_ref` to get the value as a `&[u8]`.
@@ -451,6 +821,14 @@ extern {
                                    num: c::size_t);
 }
 
+#[cfg(target_arch = "x86_64")]
+extern {
+    fn GFp_sha256_mb_avx2_capable() -> c::int;
+    fn GFp_sha256_block_data_order_x8_avx2(states: *const *mut u32,
+                                           data: *const *const u8,
+                                           num: c::size_t);
+}
+
 #[cfg(test)]
 pub mod test_util {
     use super::super::digest;
@@ -494,6 +872,90 @@ mod tests {
         });
     }
 
+    // A context serialized at any point, including mid-way through a
+    // buffered partial block, must resume to the same digest as an
+    // uninterrupted calculation, for every algorithm.
+    #[test]
+    fn test_context_serialization() {
+        let mut data = vec![0u8; 1024 + 7];
+        for (i, b) in data.iter_mut().enumerate() {
+            *b = (i * 59) as u8;
+        }
+        for alg in digest::test_util::ALL_ALGORITHMS.iter() {
+            let expected = digest::digest(*alg, &data);
+            for &split in &[0usize, 1, 63, 64, 65, 100, 127, 128, 129,
+                            1024 + 7] {
+                let mut ctx = digest::Context::new(*alg);
+                ctx.update(&data[..split]);
+                let serialized = ctx.serialize();
+                let mut restored =
+                    digest::Context::deserialize(&serialized).unwrap();
+                assert_eq!(restored.algorithm() as *const _,
+                           *alg as *const _);
+                restored.update(&data[split..]);
+                assert_eq!(restored.finish().as_ref(), expected.as_ref());
+            }
+        }
+    }
+
+    #[test]
+    fn test_context_deserialization_rejects_invalid() {
+        let serialized = digest::Context::new(&digest::SHA256).serialize();
+        assert!(digest::Context::deserialize(&serialized).is_ok());
+
+        // Truncated.
+        assert!(digest::Context::deserialize(
+            &serialized[..(serialized.len() - 1)]).is_err());
+
+        // Unknown algorithm tags.
+        for &bad_id in &[0u8, 5, 255] {
+            let mut bad = serialized;
+            bad[0] = bad_id;
+            assert!(digest::Context::deserialize(&bad).is_err());
+        }
+
+        // Buffered-byte count not less than the block length.
+        let mut bad = serialized;
+        bad[9] = 64;
+        assert!(digest::Context::deserialize(&bad).is_err());
+
+        // A block count whose bit count would overflow `u64`.
+        let mut bad = serialized;
+        for b in bad[1..9].iter_mut() {
+            *b = 0xff;
+        }
+        assert!(digest::Context::deserialize(&bad).is_err());
+    }
+
+    // `digest_many` must agree with `digest` for every algorithm, for
+    // enough inputs to fill several multi-buffer groups plus a scalar tail,
+    // and for lengths that hit every padding case (empty, one tail block,
+    // two tail blocks, and multi-block messages of unequal sizes).
+    #[test]
+    fn test_digest_many() {
+        let lens = [0usize, 1, 55, 56, 63, 64, 65, 127, 128, 129, 1000,
+                    4096, 8192 + 13];
+        let mut inputs = Vec::new();
+        for rep in 0..3u8 {
+            for (i, &len) in lens.iter().enumerate() {
+                let mut msg = vec![0u8; len];
+                for (j, b) in msg.iter_mut().enumerate() {
+                    *b = (i * 31 + j) as u8 ^ rep;
+                }
+                inputs.push(msg);
+            }
+        }
+        let input_refs: Vec<&[u8]> = inputs.iter().map(|m| &m[..]).collect();
+        for alg in digest::test_util::ALL_ALGORITHMS.iter() {
+            let results = digest::digest_many(*alg, &input_refs);
+            assert_eq!(results.len(), input_refs.len());
+            for (result, input) in results.iter().zip(input_refs.iter()) {
+                assert_eq!(result.as_ref(),
+                           digest::digest(*alg, input).as_ref());
+            }
+        }
+    }
+
     mod shavs {
         use std::vec::Vec;
         use super::super::super::{digest, test};
@@ -14,7 +14,7 @@
 
 //! X25519 Key agreement.
 
-use {agreement, bssl, c, ec, error, rand};
+use {agreement, bssl, c, core, ec, error, init, rand, std};
 use untrusted;
 
 
@@ -86,6 +86,111 @@ fn x25519_ecdh(out: &mut [u8], my_private_key: &ec::PrivateKey,
 }
 
 
+/// Computes the X25519 shared secret for each `(private_key,
+/// peer_public_value)` pair in `pairs`, writing the i-th shared secret to
+/// `out[i]`, using up to `num_threads` threads.
+///
+/// This is a lower-level interface than `agreement::agree_ephemeral`, for
+/// callers like mixnet relays that perform many independent X25519
+/// operations: each private key is a raw 32-byte scalar (it will be masked
+/// as described in RFC 7748 Section 5) and each shared secret is returned
+/// raw, without any KDF applied.
+///
+/// `Err(error::Unspecified)` is returned when `pairs` and `out` have
+/// different lengths or when any of the agreements results in the all-zero
+/// value; see the notes on the "all-zero value" in [RFC 7748 section 6.1].
+/// Every entry of `out` is still overwritten in that case.
+///
+/// [RFC 7748 section 6.1]: https://tools.ietf.org/html/rfc7748#section-6.1
+pub fn x25519_agree_batch(
+        pairs: &[([u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN],
+                  [u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN])],
+        out: &mut [[u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN]],
+        num_threads: usize) -> Result<(), error::Unspecified> {
+    init::init_once();
+
+    if pairs.len() != out.len() {
+        return Err(error::Unspecified);
+    }
+
+    fn agree_slice(pairs: &[([u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN],
+                             [u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN])],
+                   out: &mut [[u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN]])
+                   -> Result<(), error::Unspecified> {
+        let mut result = Ok(());
+        for (&(ref private_key, ref peer_public_value), out) in
+                pairs.iter().zip(out.iter_mut()) {
+            // Keep going after a failure so that every entry of `out` is
+            // overwritten, never left holding its previous contents.
+            if bssl::map_result(unsafe {
+                GFp_x25519_ecdh(out, private_key, peer_public_value)
+            }).is_err() {
+                result = Err(error::Unspecified);
+            }
+        }
+        result
+    }
+
+    let num_threads = core::cmp::min(core::cmp::max(num_threads, 1),
+                                     core::cmp::max(pairs.len(), 1));
+    if num_threads == 1 {
+        return agree_slice(pairs, out);
+    }
+
+    struct Partition {
+        pairs: *const ([u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN],
+                       [u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN]),
+        out: *mut [u8; X25519_ELEM_SCALAR_PUBLIC_KEY_LEN],
+        num_entries: usize,
+    }
+
+    unsafe impl Send for Partition {}
+
+    fn agree_partition(partition: Partition)
+                       -> Result<(), error::Unspecified> {
+        let pairs = unsafe {
+            core::slice::from_raw_parts(partition.pairs,
+                                        partition.num_entries)
+        };
+        let out = unsafe {
+            core::slice::from_raw_parts_mut(partition.out,
+                                            partition.num_entries)
+        };
+        agree_slice(pairs, out)
+    }
+
+    let entries_per_thread = (pairs.len() + num_threads - 1) / num_threads;
+
+    let mut threads = std::vec::Vec::with_capacity(num_threads - 1);
+    for i in 1..num_threads {
+        let start = core::cmp::min(i * entries_per_thread, pairs.len());
+        let end = core::cmp::min(start + entries_per_thread, pairs.len());
+        let partition = Partition {
+            pairs: pairs[start..].as_ptr(),
+            out: out[start..].as_mut_ptr(),
+            num_entries: end - start,
+        };
+        // Safety: the partitions don't overlap, every thread is joined below
+        // before `pairs` and `out` go out of scope, and nothing between the
+        // spawns and the joins panics.
+        threads.push(std::thread::spawn(move || agree_partition(partition)));
+    }
+
+    // The calling thread takes the first partition.
+    let first = core::cmp::min(entries_per_thread, pairs.len());
+    let mut result = agree_slice(&pairs[..first], &mut out[..first]);
+
+    for thread in threads {
+        let thread_result = thread.join().unwrap();
+        if thread_result.is_err() {
+            result = thread_result;
+        }
+    }
+
+    result
+}
+
+
 const X25519_ELEM_SCALAR_PUBLIC_KEY_LEN: usize = 32;
 
 extern {
@@ -100,7 +205,7 @@ extern {
 
 #[cfg(test)]
 mod tests {
-    use {agreement, error, test};
+    use {agreement, error, rand, test};
     use std;
     use untrusted;
 
@@ -143,6 +248,51 @@ mod tests {
         }
     }
 
+    #[test]
+    fn test_x25519_agree_batch() {
+        let rng = rand::SystemRandom::new();
+
+        let mut pairs = std::vec::Vec::new();
+        let mut expected = std::vec::Vec::new();
+        for _ in 0..7 {
+            let mut private_key = [0u8; 32];
+            rng.fill(&mut private_key).unwrap();
+            let mut peer_private_key = [0u8; 32];
+            rng.fill(&mut peer_private_key).unwrap();
+            let mut peer_public_value = [0u8; 32];
+            unsafe {
+                super::GFp_x25519_public_from_private(&mut peer_public_value,
+                                                      &peer_private_key);
+            }
+            expected.push(x25519(&private_key, &peer_public_value));
+            pairs.push((private_key, peer_public_value));
+        }
+
+        for num_threads in 0..5 {
+            let mut out = vec![[0u8; 32]; pairs.len()];
+            assert!(super::x25519_agree_batch(&pairs, &mut out,
+                                              num_threads).is_ok());
+            for i in 0..pairs.len() {
+                assert_eq!(&expected[i][..], &out[i][..]);
+            }
+        }
+
+        // Mismatched lengths are rejected.
+        let mut short_out = vec![[0u8; 32]; pairs.len() - 1];
+        assert!(super::x25519_agree_batch(&pairs, &mut short_out, 1).is_err());
+
+        // An all-zero peer public value makes the whole batch fail, but the
+        // other entries are still computed.
+        pairs[2].1 = [0u8; 32];
+        for num_threads in 1..3 {
+            let mut out = vec![[0xffu8; 32]; pairs.len()];
+            assert!(super::x25519_agree_batch(&pairs, &mut out,
+                                              num_threads).is_err());
+            assert_eq!(out[2], [0u8; 32]);
+            assert_eq!(&expected[3][..], &out[3][..]);
+        }
+    }
+
     fn x25519(private_key: &[u8], public_key: &[u8]) -> std::vec::Vec<u8> {
         x25519_(private_key, public_key).unwrap()
     }
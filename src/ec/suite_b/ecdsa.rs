@@ -15,7 +15,7 @@
 //! ECDSA Signatures using the P-256 and P-384 curves.
 
 use arithmetic::montgomery::*;
-use {der, digest, error, private, signature};
+use {der, digest, error, init, private, signature};
 use super::verify_jacobian_point_is_on_the_curve;
 use super::ops::*;
 use super::public_key::*;
@@ -59,6 +59,23 @@ impl signature::VerificationAlgorithm for ECDSAParameters {
         let peer_pub_key =
             try!(parse_uncompressed_point(public_key_ops, public_key));
 
+        self.verify_parsed(msg, signature, |u2| {
+            self.ops.private_key_ops.point_mul(u2, &peer_pub_key)
+        })
+    }
+}
+
+impl ECDSAParameters {
+    // NSA Guide Steps 1-8, common to `verify` and
+    // `ECDSAVerificationKey::verify`. `point_mul_p` computes u2*Q, where Q is
+    // the signer's (already parsed and validated) public point.
+    fn verify_parsed<F>(&self, msg: untrusted::Input,
+                        signature: untrusted::Input, point_mul_p: F)
+                        -> Result<(), error::Unspecified>
+                        where F: FnOnce(&Scalar) -> Point {
+        let public_key_ops = self.ops.public_key_ops;
+        let scalar_ops = self.ops.scalar_ops;
+
         let (r, s) = try!(signature.read_all(
             error::Unspecified, |input| (self.split_rs)(scalar_ops, input)));
 
@@ -87,8 +104,11 @@ impl signature::VerificationAlgorithm for ECDSAParameters {
         // NSA Guide Step 6: "Compute the elliptic curve point
         // R = (xR, yR) = u1*G + u2*Q, using EC scalar multiplication and EC
         // addition. If R is equal to the point at infinity, output INVALID."
-        let product =
-            twin_mul(self.ops.private_key_ops, &u1, &u2, &peer_pub_key);
+        //
+        // XXX: Inefficient. TODO: implement interleaved wNAF multiplication.
+        let scaled_g = self.ops.private_key_ops.point_mul_base(&u1);
+        let scaled_p = point_mul_p(&u2);
+        let product = public_key_ops.common.point_sum(&scaled_g, &scaled_p);
 
         // Verify that the point we computed is on the curve; see
         // `verify_affine_point_is_on_the_curve_scaled` for details on why. It
@@ -132,6 +152,46 @@ impl signature::VerificationAlgorithm for ECDSAParameters {
 
 impl private::Private for ECDSAParameters {}
 
+/// An ECDSA public key that has been parsed and validated for use with
+/// `params`, with a window table of multiples of the public point
+/// precomputed.
+///
+/// `signature::verify()` re-parses the public key and rebuilds that window
+/// table on every call. When many signatures from the same signer need to be
+/// checked, construct an `ECDSAVerificationKey` once and call its `verify()`
+/// method repeatedly to amortize those fixed per-key costs, analogous to what
+/// `RSAVerificationKey` does for RSA.
+pub struct ECDSAVerificationKey {
+    params: &'static ECDSAParameters,
+    table: PointMulTable,
+}
+
+impl ECDSAVerificationKey {
+    /// Parses the public key (in uncompressed form; see `ring::signature`'s
+    /// module-level documentation for the encoding), validates it for use
+    /// with `params`, and precomputes the window table of the public point.
+    pub fn from_uncompressed_point(params: &'static ECDSAParameters,
+                                   public_key: untrusted::Input)
+                                   -> Result<ECDSAVerificationKey,
+                                             error::Unspecified> {
+        init::init_once();
+        let peer_pub_key = try!(parse_uncompressed_point(
+            params.ops.public_key_ops, public_key));
+        let table =
+            params.ops.private_key_ops.point_mul_table_init(&peer_pub_key);
+        Ok(ECDSAVerificationKey { params: params, table: table })
+    }
+
+    /// Verifies the signature `signature` of message `msg`.
+    pub fn verify(&self, msg: untrusted::Input, signature: untrusted::Input)
+                  -> Result<(), error::Unspecified> {
+        self.params.verify_parsed(msg, signature, |u2| {
+            self.params.ops.private_key_ops.point_mul_precomputed(u2,
+                                                                  &self.table)
+        })
+    }
+}
+
 fn split_rs_fixed<'a>(
         ops: &'static ScalarOps, input: &mut untrusted::Reader<'a>)
         -> Result<(untrusted::Input<'a>, untrusted::Input<'a>),
@@ -200,15 +260,6 @@ fn digest_scalar_(ops: &ScalarOps, digest: &[u8]) -> Scalar {
         cops, AllowZero::Yes, untrusted::Input::from(digest)).unwrap()
 }
 
-fn twin_mul(ops: &PrivateKeyOps, g_scalar: &Scalar, p_scalar: &Scalar,
-            p_xy: &(Elem<R>, Elem<R>)) -> Point {
-    // XXX: Inefficient. TODO: implement interleaved wNAF multiplication.
-    let scaled_g = ops.point_mul_base(g_scalar);
-    let scaled_p = ops.point_mul(p_scalar, p_xy);
-    ops.common.point_sum(&scaled_g, &scaled_p)
-}
-
-
 /// Verification of fixed-length (PKCS#11 style) ECDSA signatures using the
 /// P-256 curve and SHA-256.
 ///
@@ -323,6 +374,39 @@ mod tests {
         });
     }
 
+    #[test]
+    fn signature_ecdsa_verification_key_test() {
+        test::from_file("src/ec/suite_b/ecdsa_verify_asn1_tests.txt",
+                        |section, test_case| {
+            assert_eq!(section, "");
+
+            let curve_name = test_case.consume_string("Curve");
+            let digest_name = test_case.consume_string("Digest");
+
+            let msg = test_case.consume_bytes("Msg");
+            let msg = untrusted::Input::from(&msg);
+
+            let public_key = test_case.consume_bytes("Q");
+            let public_key = untrusted::Input::from(&public_key);
+
+            let sig = test_case.consume_bytes("Sig");
+            let sig = untrusted::Input::from(&sig);
+
+            let expected_result = test_case.consume_string("Result");
+
+            let params = params_from_curve_and_digest_asn1(&curve_name,
+                                                           &digest_name);
+
+            let actual_result =
+                signature::ECDSAVerificationKey::from_uncompressed_point(
+                    params, public_key)
+                .and_then(|key| key.verify(msg, sig));
+            assert_eq!(actual_result.is_ok(), expected_result == "P (0 )");
+
+            Ok(())
+        });
+    }
+
     #[test]
     fn signature_ecdsa_verify_fixed_test() {
         test::from_file("src/ec/suite_b/ecdsa_verify_fixed_tests.txt",
@@ -409,6 +493,20 @@ mod tests {
         }
     }
 
+    fn params_from_curve_and_digest_asn1(curve_name: &str, digest_name: &str)
+            -> &'static signature::ECDSAParameters {
+        match (curve_name, digest_name) {
+            ("P-256", "SHA256") => &signature::ECDSA_P256_SHA256_ASN1,
+            ("P-256", "SHA384") => &signature::ECDSA_P256_SHA384_ASN1,
+            ("P-384", "SHA256") => &signature::ECDSA_P384_SHA256_ASN1,
+            ("P-384", "SHA384") => &signature::ECDSA_P384_SHA384_ASN1,
+            _ => {
+                panic!("Unsupported curve+digest: {}+{}", curve_name,
+                       digest_name);
+            }
+        }
+    }
+
     fn alg_from_curve_and_digest_fixed(curve_name: &str, digest_name: &str)
             -> (&'static signature::VerificationAlgorithm,
                 &'static PublicScalarOps, &'static digest::Algorithm) {
@@ -57,6 +57,19 @@ impl Clone for Point {
 
 impl Copy for Point {}
 
+/// A precomputed window table of the multiples 1*p through 16*p of a point
+/// *p*, as used by the scalar multiplication's inner loop. Constructing the
+/// table with `PrivateKeyOps::point_mul_table_init` once and reusing it with
+/// `point_mul_precomputed` amortizes the table construction across many
+/// multiplications by the same point.
+pub struct PointMulTable {
+    // 16 points packed contiguously, each `3 * ops.num_limbs` limbs in the
+    // same X||Y||Z layout as `Point::xyz`; only the first
+    // `3 * ops.num_limbs * 16` limbs are used. This layout is dictated by
+    // the GFp_nistz256/GFp_nistz384 code.
+    limbs: [Limb; 3 * MAX_LIMBS * 16],
+}
+
 #[cfg(all(target_pointer_width = "32", target_endian = "little"))]
 macro_rules! limbs {
     ( $limb_b:expr, $limb_a:expr, $limb_9:expr, $limb_8:expr,
@@ -214,6 +227,14 @@ pub struct PrivateKeyOps {
                                      p_scalar: *const Limb/*[num_limbs]*/,
                                      p_x: *const Limb/*[num_limbs]*/,
                                      p_y: *const Limb/*[num_limbs]*/),
+    point_mul_table_init_impl:
+        unsafe extern fn(table: *mut Limb/*[16][3][num_limbs]*/,
+                         p_x: *const Limb/*[num_limbs]*/,
+                         p_y: *const Limb/*[num_limbs]*/),
+    point_mul_precomputed_impl:
+        unsafe extern fn(r: *mut Limb/*[3][num_limbs]*/,
+                         p_scalar: *const Limb/*[num_limbs]*/,
+                         table: *const Limb/*[16][3][num_limbs]*/),
 }
 
 impl PrivateKeyOps {
@@ -233,6 +254,30 @@ impl PrivateKeyOps {
         r
     }
 
+    pub fn point_mul_table_init(&self,
+                                &(ref p_x, ref p_y): &(Elem<R>, Elem<R>))
+                                -> PointMulTable {
+        let mut table = PointMulTable { limbs: [0; 3 * MAX_LIMBS * 16] };
+        unsafe {
+            (self.point_mul_table_init_impl)(table.limbs.as_mut_ptr(),
+                                             p_x.limbs.as_ptr(),
+                                             p_y.limbs.as_ptr());
+        }
+        table
+    }
+
+    #[inline(always)]
+    pub fn point_mul_precomputed(&self, p_scalar: &Scalar,
+                                 table: &PointMulTable) -> Point {
+        let mut r = Point::new_at_infinity();
+        unsafe {
+            (self.point_mul_precomputed_impl)(r.xyz.as_mut_ptr(),
+                                              p_scalar.limbs.as_ptr(),
+                                              table.limbs.as_ptr());
+        }
+        r
+    }
+
     #[inline]
     pub fn elem_inverse(&self, a: &Elem<R>) -> Elem<R> {
         (self.elem_inv)(a)
@@ -656,8 +701,15 @@ mod tests {
                            "src/ec/suite_b/ops/p256_scalar_square_tests.txt");
     }
 
-    // XXX: There's no `p384_scalar_square_test()` because there's no dedicated
-    // `GFp_p384_scalar_sqr_rep_mont()`.
+    #[test]
+    fn p384_scalar_square_test() {
+        extern {
+            fn GFp_p384_scalar_sqr_rep_mont(r: *mut Limb, a: *const Limb,
+                                            rep: c::int);
+        }
+        scalar_square_test(&p384::COMMON_OPS, GFp_p384_scalar_sqr_rep_mont,
+                           "src/ec/suite_b/ops/p384_scalar_square_tests.txt");
+    }
 
     fn scalar_square_test(ops: &CommonOps,
                           sqr_rep: unsafe extern fn(r: *mut Limb, a: *const Limb,
@@ -71,6 +71,8 @@ pub static PRIVATE_KEY_OPS: PrivateKeyOps = PrivateKeyOps {
     elem_inv: p256_elem_inv,
     point_mul_base_impl: p256_point_mul_base_impl,
     point_mul_impl: GFp_nistz256_point_mul,
+    point_mul_table_init_impl: GFp_nistz256_point_mul_table_init,
+    point_mul_precomputed_impl: GFp_nistz256_point_mul_precomputed,
 };
 
 fn p256_elem_inv(a: &Elem<R>) -> Elem<R> {
@@ -302,6 +304,14 @@ extern {
                               p_y: *const Limb/*[COMMON_OPS.num_limbs]*/);
     fn GFp_nistz256_point_mul_base(r: *mut Limb/*[3][COMMON_OPS.num_limbs]*/,
                                    g_scalar: *const Limb/*[COMMON_OPS.num_limbs]*/);
+    fn GFp_nistz256_point_mul_table_init(
+            table: *mut Limb/*[16][3][COMMON_OPS.num_limbs]*/,
+            p_x: *const Limb/*[COMMON_OPS.num_limbs]*/,
+            p_y: *const Limb/*[COMMON_OPS.num_limbs]*/);
+    fn GFp_nistz256_point_mul_precomputed(
+            r: *mut Limb/*[3][COMMON_OPS.num_limbs]*/,
+            p_scalar: *const Limb/*[COMMON_OPS.num_limbs]*/,
+            table: *const Limb/*[16][3][COMMON_OPS.num_limbs]*/);
 
     fn GFp_p256_scalar_mul_mont(r: *mut Limb/*[COMMON_OPS.num_limbs]*/,
                                 a: *const Limb/*[COMMON_OPS.num_limbs]*/,
@@ -12,6 +12,7 @@
 // OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
 // CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
+use c;
 use core::marker::PhantomData;
 use super::*;
 use super::{elem_sqr_mul, elem_sqr_mul_acc, Mont};
@@ -75,6 +76,8 @@ pub static PRIVATE_KEY_OPS: PrivateKeyOps = PrivateKeyOps {
     elem_inv: p384_elem_inv,
     point_mul_base_impl: p384_point_mul_base_impl,
     point_mul_impl: GFp_nistz384_point_mul,
+    point_mul_table_init_impl: GFp_nistz384_point_mul_table_init,
+    point_mul_precomputed_impl: GFp_nistz384_point_mul_precomputed,
 };
 
 fn p384_elem_inv(a: &Elem<R>) -> Elem<R> {
@@ -143,26 +146,13 @@ fn p384_elem_inv(a: &Elem<R>) -> Elem<R> {
 }
 
 
-fn p384_point_mul_base_impl(a: &Scalar) -> Point {
-    // XXX: Not efficient. TODO: Precompute multiples of the generator.
-    static P384_GENERATOR: (Elem<R>, Elem<R>) = (
-        Elem {
-            limbs: p384_limbs![0x4d3aadc2, 0x299e1513, 0x812ff723, 0x614ede2b,
-                               0x64548684, 0x59a30eff, 0x879c3afc, 0x541b4d6e,
-                               0x20e378e2, 0xa0d6ce38, 0x3dd07566, 0x49c0b528],
-            m: PhantomData,
-            encoding: PhantomData,
-        },
-        Elem {
-            limbs: p384_limbs![0x2b78abc2, 0x5a15c5e9, 0xdd800226, 0x3969a840,
-                               0xc6c35219, 0x68f4ffd9, 0x8bade756, 0x2e83b050,
-                               0xa1bfa8bf, 0x7bb4a9ac, 0x23043dad, 0x4b03a4fe],
-            m: PhantomData,
-            encoding: PhantomData,
-        }
-    );
-
-    PRIVATE_KEY_OPS.point_mul(a, &P384_GENERATOR)
+fn p384_point_mul_base_impl(g_scalar: &Scalar) -> Point {
+    let mut r = Point::new_at_infinity();
+    unsafe {
+        GFp_nistz384_point_mul_base(r.xyz.as_mut_ptr(),
+                                    g_scalar.limbs.as_ptr());
+    }
+    r
 }
 
 
@@ -198,35 +188,33 @@ fn p384_scalar_inv_to_mont(a: &Scalar<Unencoded>) -> Scalar<R> {
     //     0xffffffffffffffffffffffffffffffffffffffffffffffffc7634d81f4372ddf\
     //       581a0db248b0a77aecec196accc52971.
 
-    // XXX(perf): This hasn't been optimized at all. TODO: optimize.
-
+    #[inline]
     fn mul(a: &Scalar<R>, b: &Scalar<R>) -> Scalar<R> {
         binary_op(GFp_p384_scalar_mul_mont, a, b)
     }
 
+    #[inline]
     fn sqr(a: &Scalar<R>) -> Scalar<R> {
-        binary_op(GFp_p384_scalar_mul_mont, a, a)
-    }
-
-    fn sqr_mut(a: &mut Scalar<R>) {
-        unary_op_from_binary_op_assign(GFp_p384_scalar_mul_mont, a);
+        unary_op(GFp_p384_scalar_sqr_mont, a)
     }
 
     // Returns (`a` squared `squarings` times) * `b`.
-    fn sqr_mul(a: &Scalar<R>, squarings: usize, b: &Scalar<R>) -> Scalar<R> {
+    fn sqr_mul(a: &Scalar<R>, squarings: c::int, b: &Scalar<R>) -> Scalar<R> {
         debug_assert!(squarings >= 1);
-        let mut tmp = sqr(a);
-        for _ in 1..squarings {
-            sqr_mut(&mut tmp);
+        let mut tmp = Scalar::zero();
+        unsafe {
+            GFp_p384_scalar_sqr_rep_mont(tmp.limbs.as_mut_ptr(),
+                                         a.limbs.as_ptr(), squarings)
         }
         mul(&tmp, b)
     }
 
     // Sets `acc` = (`acc` squared `squarings` times) * `b`.
-    fn sqr_mul_acc(acc: &mut Scalar<R>, squarings: usize, b: &Scalar<R>) {
+    fn sqr_mul_acc(acc: &mut Scalar<R>, squarings: c::int, b: &Scalar<R>) {
         debug_assert!(squarings >= 1);
-        for _ in 0..squarings {
-            sqr_mut(acc);
+        unsafe {
+            GFp_p384_scalar_sqr_rep_mont(acc.limbs.as_mut_ptr(),
+                                         acc.limbs.as_ptr(), squarings)
         }
         binary_op_assign(GFp_p384_scalar_mul_mont, acc, b)
     }
@@ -331,7 +319,7 @@ fn p384_scalar_inv_to_mont(a: &Scalar<Unencoded>) -> Scalar<R> {
     ];
 
     for &(squarings, digit) in &REMAINING_WINDOWS[..] {
-        sqr_mul_acc(&mut acc, squarings as usize, &d[digit as usize]);
+        sqr_mul_acc(&mut acc, squarings as c::int, &d[digit as usize]);
     }
 
     acc
@@ -362,10 +350,26 @@ extern {
                               p_scalar: *const Limb/*[COMMON_OPS.num_limbs]*/,
                               p_x: *const Limb/*[COMMON_OPS.num_limbs]*/,
                               p_y: *const Limb/*[COMMON_OPS.num_limbs]*/);
+    fn GFp_nistz384_point_mul_base(r: *mut Limb/*[3][COMMON_OPS.num_limbs]*/,
+                                   g_scalar: *const Limb
+                                                 /*[COMMON_OPS.num_limbs]*/);
+    fn GFp_nistz384_point_mul_table_init(
+            table: *mut Limb/*[16][3][COMMON_OPS.num_limbs]*/,
+            p_x: *const Limb/*[COMMON_OPS.num_limbs]*/,
+            p_y: *const Limb/*[COMMON_OPS.num_limbs]*/);
+    fn GFp_nistz384_point_mul_precomputed(
+            r: *mut Limb/*[3][COMMON_OPS.num_limbs]*/,
+            p_scalar: *const Limb/*[COMMON_OPS.num_limbs]*/,
+            table: *const Limb/*[16][3][COMMON_OPS.num_limbs]*/);
 
     fn GFp_p384_scalar_mul_mont(r: *mut Limb/*[COMMON_OPS.num_limbs]*/,
                                 a: *const Limb/*[COMMON_OPS.num_limbs]*/,
                                 b: *const Limb/*[COMMON_OPS.num_limbs]*/);
+    fn GFp_p384_scalar_sqr_mont(r: *mut Limb/*[COMMON_OPS.num_limbs]*/,
+                                a: *const Limb/*[COMMON_OPS.num_limbs]*/);
+    fn GFp_p384_scalar_sqr_rep_mont(r: *mut Limb/*[COMMON_OPS.num_limbs]*/,
+                                    a: *const Limb/*[COMMON_OPS.num_limbs]*/,
+                                    rep: c::int);
 }
 
 
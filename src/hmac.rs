@@ -307,6 +307,52 @@ impl SigningContext {
     }
 }
 
+/// Signs messages that are exactly one digest output long, keeping the key's
+/// two pad-block states resident so that each message costs two compression
+/// function calls instead of a fresh pair of digest contexts. This is
+/// PBKDF2's inner loop, where every message is the previous iteration's
+/// output.
+///
+/// This is an implementation detail of `pbkdf2` and not part of the public
+/// API.
+#[doc(hidden)]
+pub struct OneBlockSigner {
+    inner: digest::OneBlockContext,
+    outer: digest::OneBlockContext,
+}
+
+impl OneBlockSigner {
+    /// Returns a signer for `key`, or `None` if a digest-length message plus
+    /// padding doesn't fit in a single block of the key's digest algorithm.
+    #[doc(hidden)]
+    pub fn new(key: &SigningKey) -> Option<OneBlockSigner> {
+        let output_len = key.digest_algorithm().output_len;
+        let inner = match digest::OneBlockContext::from_context(
+            &key.ctx_prototype.inner, output_len) {
+            Some(ctx) => ctx,
+            None => { return None; },
+        };
+        let outer = match digest::OneBlockContext::from_context(
+            &key.ctx_prototype.outer, output_len) {
+            Some(ctx) => ctx,
+            None => { return None; },
+        };
+        Some(OneBlockSigner {
+            inner: inner,
+            outer: outer,
+        })
+    }
+
+    /// Computes the HMAC of `msg`, which must be exactly one digest output
+    /// long.
+    #[doc(hidden)]
+    #[inline]
+    pub fn sign(&mut self, msg: &[u8]) -> digest::Digest {
+        let inner_digest = self.inner.digest(msg);
+        self.outer.digest(inner_digest.as_ref())
+    }
+}
+
 /// Calculates the HMAC of `data` using the key `key` in one step.
 ///
 /// Use `SigningContext` to calculate HMACs where the input is in multiple
@@ -318,11 +364,34 @@ impl SigningContext {
 ///
 /// C analog: `HMAC_CTX_init` + `HMAC_Update` + `HMAC_Final`.
 pub fn sign(key: &SigningKey, data: &[u8]) -> Signature {
+    // Fast path: when `data` plus the padding fits in the block that follows
+    // the key's pad block, the HMAC is two direct compression function calls
+    // from the saved pad states, skipping the context setup, buffering, and
+    // finalization that the streaming API pays for.
+    if let Some(signature) = sign_one_block(key, data) {
+        return signature;
+    }
+
     let mut ctx = SigningContext::with_key(key);
     ctx.update(data);
     ctx.sign()
 }
 
+fn sign_one_block(key: &SigningKey, data: &[u8]) -> Option<Signature> {
+    let mut inner = match digest::OneBlockContext::from_context(
+        &key.ctx_prototype.inner, data.len()) {
+        Some(ctx) => ctx,
+        None => { return None; },
+    };
+    let mut outer = match digest::OneBlockContext::from_context(
+        &key.ctx_prototype.outer, key.digest_algorithm().output_len) {
+        Some(ctx) => ctx,
+        None => { return None; },
+    };
+    let inner_digest = inner.digest(data);
+    Some(Signature(outer.digest(inner_digest.as_ref())))
+}
+
 /// A key to use for HMAC authentication.
 pub struct VerificationKey {
     wrapped: SigningKey,
@@ -477,6 +546,23 @@ mod tests {
         })
     }
 
+    // `sign` takes a direct two-compression path for messages that fit in
+    // the block after the key's pad block; it must agree with the streaming
+    // API on both sides of that boundary.
+    #[test]
+    pub fn hmac_sign_agrees_with_streaming() {
+        let data = [0x5au8; 2 * digest::MAX_BLOCK_LEN];
+        for algorithm in digest::test_util::ALL_ALGORITHMS.iter() {
+            let s_key = hmac::SigningKey::new(algorithm, b"key value");
+            for len in 0..(2 * algorithm.block_len) {
+                let signature = hmac::sign(&s_key, &data[..len]);
+                let mut ctx = hmac::SigningContext::with_key(&s_key);
+                ctx.update(&data[..len]);
+                assert_eq!(signature.as_ref(), ctx.sign().as_ref());
+            }
+        }
+    }
+
     #[test]
     pub fn hmac_tests() {
         test::from_file("src/hmac_tests.txt", |section, test_case| {
@@ -30,6 +30,12 @@
 //!         <code>dev_urandom_fallback</code> feature is disabled, such
 //!         fallbacks will not occur. See the documentation for
 //!         <code>rand::SystemRandom</code> for more details.
+//! <tr><td><code>dispatch_instrumentation</code>
+//!     <td>Enable the <code>dispatch</code> module and
+//!         <code>report_dispatch()</code>, which report which assembly
+//!         implementation each primitive resolved to at runtime and count
+//!         invocations/bytes processed on the hot paths. Off by default; it
+//!         adds two relaxed atomic increments per AEAD/digest call.
 //! <tr><td><code>rsa_signing</code>
 //!     <td>Enable RSA signing (<code>RSAKeyPair</code> and related things).
 //! </table>
@@ -143,6 +149,12 @@ pub mod der;
 #[path = "digest/digest.rs"]
 pub mod digest;
 
+#[cfg(feature = "dispatch_instrumentation")]
+pub mod dispatch;
+
+#[cfg(feature = "dispatch_instrumentation")]
+pub use dispatch::report_dispatch;
+
 #[path = "ec/ec.rs"]
 mod ec;
 
@@ -88,6 +88,9 @@ impl SigningContext {
         ctx
     }
 
+    #[inline]
+    pub fn from_precomputed(key: PrecomputedKey) -> SigningContext { key.ctx }
+
     pub fn update(&mut self, mut input: &[u8]) {
         let &mut SigningContext {
             opaque: ref mut opaque,
@@ -193,10 +196,44 @@ impl Key {
         Key { bytes }
     }
 
+    /// Constructs a key directly from `bytes`, e.g. from the first `KEY_LEN`
+    /// bytes of a ChaCha20 key stream block the caller derived itself.
+    /// Poly1305 keys are one-time keys: the caller must not authenticate more
+    /// than one message with the same key.
+    pub fn from_bytes(bytes: &[u8; KEY_LEN]) -> Key {
+        Key { bytes: *bytes }
+    }
+
     #[cfg(test)]
     pub fn from_test_vector(bytes: &[u8; KEY_LEN]) -> Key {
-        Key { bytes: *bytes }
+        Key::from_bytes(bytes)
     }
+
+    /// Consumes the key, precomputing the multiplier power table the
+    /// vectorized implementations use for multi-block processing.
+    ///
+    /// On x86-64 CPUs with AVX, the power table (r^2..r^4 in base 2^26) is
+    /// otherwise computed lazily, during the first `update()` of at least
+    /// 128 bytes; shorter one-shot MACs never engage the vectorized code at
+    /// all. Precomputing moves that work to key derivation time and lets
+    /// the vectorized code engage regardless of the input length, which
+    /// helps callers that derive their one-time keys in a batch ahead of
+    /// MACing many small records. On other CPUs this is free and changes
+    /// nothing.
+    pub fn precompute(self) -> PrecomputedKey {
+        let mut ctx = SigningContext::from_key(self);
+        with_aligned(&mut ctx.opaque, |opaque| {
+            let _ = init_table(opaque);
+        });
+        PrecomputedKey { ctx }
+    }
+}
+
+/// A one-time Poly1305 key with the multiplier power table already computed;
+/// see `Key::precompute()`. Like `Key`, it must be used to authenticate only
+/// one message.
+pub struct PrecomputedKey {
+    ctx: SigningContext,
 }
 
 type KeyAndNonceBytes = [u8; 2 * BLOCK_LEN];
@@ -235,6 +272,21 @@ fn init(state: &mut Opaque, key: &KeyBytes, func: &mut Funcs) -> i32 {
     }
 }
 
+// Fills in the power table and enables the vectorized code when this CPU
+// uses it; a no-op (returning 0) otherwise.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+fn init_table(state: &mut Opaque) -> i32 {
+    debug_assert_eq!(state.as_ptr() as usize % 8, 0);
+    unsafe {
+        GFp_poly1305_init_table(state)
+    }
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+#[inline]
+fn init_table(_state: &mut Opaque) -> i32 { 0 }
+
 #[repr(u32)]
 enum Pad {
     AlreadyPadded = 0,
@@ -275,6 +327,11 @@ extern {
     fn GFp_poly1305_emit(state: &mut Opaque, mac: &mut Tag, nonce: &Nonce);
 }
 
+#[cfg(target_arch = "x86_64")]
+extern {
+    fn GFp_poly1305_init_table(state: &mut Opaque) -> c::int;
+}
+
 #[cfg(test)]
 mod tests {
     use {error, test};
@@ -330,6 +387,31 @@ mod tests {
                 assert_eq!(&expected_mac[..], &actual_mac[..]);
             }
 
+            // Test the precomputed power table path, one-shot and
+            // byte-by-byte. The byte-by-byte case stresses the vectorized
+            // implementations' short-input handling, which the lazy path
+            // only reaches after a long input.
+            {
+                let key = Key::from_test_vector(&key);
+                let mut ctx =
+                    SigningContext::from_precomputed(key.precompute());
+                ctx.update(&input);
+                let mut actual_mac = [0; TAG_LEN];
+                ctx.sign(&mut actual_mac);
+                assert_eq!(&expected_mac[..], &actual_mac[..]);
+            }
+            {
+                let key = Key::from_test_vector(&key);
+                let mut ctx =
+                    SigningContext::from_precomputed(key.precompute());
+                for chunk in input.chunks(1) {
+                    ctx.update(chunk);
+                }
+                let mut actual_mac = [0u8; TAG_LEN];
+                ctx.sign(&mut actual_mac);
+                assert_eq!(&expected_mac[..], &actual_mac[..]);
+            }
+
             try!(test_poly1305_simd(0, key, &input, expected_mac));
             try!(test_poly1305_simd(16, key, &input, expected_mac));
             try!(test_poly1305_simd(32, key, &input, expected_mac));
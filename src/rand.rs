@@ -25,7 +25,7 @@
 //! (seccomp filters on Linux in particular). See `SystemRandom`'s
 //! documentation for more details.
 
-use error;
+use {chacha, error, init, std};
 
 
 /// A secure random number generator.
@@ -104,6 +104,105 @@ impl SecureRandom for SystemRandom {
     }
 }
 
+/// A secure random number generator that amortizes the cost of going to the
+/// operating system over many requests.
+///
+/// `FastRandom` layers a per-thread ChaCha20-based deterministic random bit
+/// generator over `SystemRandom`: the operating system is asked for a 256-bit
+/// seed, up to a megabyte of output is generated from it, and then the seed
+/// is replaced. Each request is generated under a fresh key and the key that
+/// generated it is immediately destroyed ("fast key erasure"), so
+/// compromising the state never exposes previously-returned values.
+///
+/// On Unix, the state is also thrown away whenever the process ID is observed
+/// to have changed, so a `fork`ed child never repeats output that the parent
+/// already returned. Note that this check cannot help a child that `fork`s
+/// *again* before its first `fill`, nor processes cloned by other means
+/// (e.g. VM snapshots); such callers should keep using `SystemRandom`.
+///
+/// `SystemRandom` remains the default and is what everything in this crate
+/// uses unless handed something else; reach for `FastRandom` only when the
+/// per-call system call overhead has actually been measured to matter.
+pub struct FastRandom;
+
+impl FastRandom {
+    /// Constructs a new `FastRandom`.
+    #[inline(always)]
+    pub fn new() -> FastRandom { FastRandom }
+}
+
+impl SecureRandom for FastRandom {
+    fn fill(&self, dest: &mut [u8]) -> Result<(), error::Unspecified> {
+        init::init_once();
+        FAST_RANDOM_STATE.with(|state| state.borrow_mut().fill(dest))
+    }
+}
+
+// Generate this much output before asking the operating system for a new
+// seed.
+const FAST_RANDOM_RESEED_INTERVAL: usize = 1024 * 1024;
+
+struct FastRandomState {
+    key: chacha::Key,
+    bytes_until_reseed: usize,
+    pid: u32,
+    seeded: bool,
+}
+
+thread_local! {
+    static FAST_RANDOM_STATE: std::cell::RefCell<FastRandomState> =
+        std::cell::RefCell::new(FastRandomState {
+            key: [0; chacha::KEY_LEN_IN_BYTES / 4],
+            bytes_until_reseed: 0,
+            pid: 0,
+            seeded: false,
+        });
+}
+
+impl FastRandomState {
+    fn fill(&mut self, dest: &mut [u8]) -> Result<(), error::Unspecified> {
+        let pid = current_pid();
+        if !self.seeded || pid != self.pid ||
+           self.bytes_until_reseed < dest.len() {
+            let mut seed = [0u8; chacha::KEY_LEN_IN_BYTES];
+            try!(fill_impl(&mut seed));
+            self.key = chacha::key_from_bytes(&seed);
+            self.bytes_until_reseed = FAST_RANDOM_RESEED_INTERVAL;
+            self.pid = pid;
+            self.seeded = true;
+        }
+
+        // Fast key erasure: keystream block 0 becomes the next key and the
+        // output is taken from block 1 onwards, so the key that generated
+        // `dest` no longer exists once this returns.
+        static NONCE: [u8; chacha::NONCE_LEN] = [0; chacha::NONCE_LEN];
+        let mut next_key = [0u8; chacha::KEY_LEN_IN_BYTES];
+        chacha::chacha20_xor_in_place(&self.key,
+                                      &chacha::make_counter(&NONCE, 0),
+                                      &mut next_key);
+
+        for b in dest.iter_mut() {
+            *b = 0;
+        }
+        chacha::chacha20_xor_in_place(&self.key,
+                                      &chacha::make_counter(&NONCE, 1), dest);
+
+        self.key = chacha::key_from_bytes(&next_key);
+        self.bytes_until_reseed =
+            self.bytes_until_reseed.saturating_sub(dest.len());
+        Ok(())
+    }
+}
+
+#[cfg(all(unix, any(feature = "use_heap", target_os = "linux")))]
+fn current_pid() -> u32 { unsafe { ::libc::getpid() as u32 } }
+
+// `libc` isn't linked in this configuration and/or the platform has no
+// `fork`, so there's nothing to detect.
+#[cfg(not(all(unix, any(feature = "use_heap", target_os = "linux"))))]
+fn current_pid() -> u32 { 0 }
+
+
 #[cfg(not(any(target_os = "linux",
               target_os = "macos",
               target_os = "ios",
@@ -311,4 +410,29 @@ mod tests {
             }
         }
     }
+
+    #[test]
+    fn test_fast_random_lengths() {
+        use rand::SecureRandom;
+
+        let lengths = [0, 1, 2, 3, 63, 64, 65, 96, 255, 256, 257, 511, 512,
+                       513, 4096];
+
+        let rng = rand::FastRandom::new();
+        for len in lengths.iter() {
+            let mut buf = vec![0; *len];
+            assert!(rng.fill(&mut buf).is_ok());
+            if *len >= 96 {
+                assert!(buf.iter().any(|x| *x != 0));
+            }
+        }
+
+        // Consecutive fills never repeat (the generating key is destroyed
+        // after each request).
+        let mut a = [0u8; 32];
+        let mut b = [0u8; 32];
+        assert!(rng.fill(&mut a).is_ok());
+        assert!(rng.fill(&mut b).is_ok());
+        assert_ne!(&a[..], &b[..]);
+    }
 }
@@ -48,7 +48,7 @@ use core::marker::PhantomData;
 use constant_time;
 
 #[cfg(feature = "rsa_signing")]
-use {der, rand};
+use {der, rand, std};
 
 impl AsRef<BIGNUM> for Positive {
     fn as_ref<'a>(&'a self) -> &'a BIGNUM { self.0.as_ref() }
@@ -605,8 +605,6 @@ pub struct PublicExponent(u64);
 pub const PUBLIC_EXPONENT_MAX_BITS: bits::BitLength = bits::BitLength(33);
 
 /// Calculates base**exponent (mod m).
-// TODO: The test coverage needs to be expanded, e.g. test with the largest
-// accepted exponent and with the most common values of 65537 and 3.
 pub fn elem_exp_vartime<M>(
         base: Elem<M, R>, PublicExponent(exponent): PublicExponent,
         m: &Modulus<M>) -> Result<Elem<M, R>, error::Unspecified> {
@@ -619,10 +617,14 @@ pub fn elem_exp_vartime<M>(
     // The vast majority of the time the exponent is either 65537
     // (0b10000000000000001) or 3 (0b11), both of which have a Hamming weight
     // of 2. As explained in [Knuth], exponentiation by squaring is the most
-    // efficient algorithm the hamming weight is 2 or less. It isn't the most
-    // efficient for all other, uncommon, RSA public exponent values weight,
-    // but any suboptimality is tightly bounded by the
-    // `PUBLIC_EXPONENT_MAX_BITS` cap.
+    // efficient algorithm the hamming weight is 2 or less.
+    //
+    // For denser exponents a 4-bit sliding-window form does fewer
+    // multiplications, once the cost of building the table of odd powers has
+    // been paid off. Since the exponent is public, we can decompose it into
+    // windows up front and then pick whichever strategy performs fewer
+    // multiplications for that exact exponent; the common sparse exponents
+    // always take the S-and-X path below.
     //
     // This implementation is slightly simplified by taking advantage of the
     // fact that we require the exponent to be an (odd) positive integer.
@@ -631,6 +633,65 @@ pub fn elem_exp_vartime<M>(
     //          Algorithms (3rd Edition), Section 4.6.3.
     debug_assert_eq!(exponent & 1, 1);
     assert!(exponent < (1 << PUBLIC_EXPONENT_MAX_BITS.as_usize_bits()));
+
+    // Decompose the exponent into sliding windows of up to `WINDOW_BITS`
+    // bits, each with an odd least significant bit. Each window except the
+    // last is followed by at least enough zero bits to pad it out to
+    // `WINDOW_BITS` bit positions, so a `PUBLIC_EXPONENT_MAX_BITS`-bit
+    // exponent decomposes into at most `MAX_WINDOWS` windows.
+    const WINDOW_BITS: i32 = 4;
+    const MAX_WINDOWS: usize = 9;
+    debug_assert!(MAX_WINDOWS * (WINDOW_BITS as usize) >=
+                  PUBLIC_EXPONENT_MAX_BITS.as_usize_bits());
+    let mut window_values = [0u64; MAX_WINDOWS];
+    let mut window_shifts = [0i32; MAX_WINDOWS];
+    let mut num_windows = 0;
+    let mut i = 63 - (exponent.leading_zeros() as i32);
+    while i >= 0 {
+        if (exponent >> i) & 1 == 0 {
+            i -= 1;
+            continue;
+        }
+        let mut j = if i >= WINDOW_BITS - 1 { i - (WINDOW_BITS - 1) } else { 0 };
+        while (exponent >> j) & 1 == 0 {
+            j += 1;
+        }
+        window_values[num_windows] = (exponent >> j) & ((1u64 << (i - j + 1)) - 1);
+        window_shifts[num_windows] = j;
+        num_windows += 1;
+        i = j - 1;
+    }
+    debug_assert_eq!(window_shifts[num_windows - 1], 0);
+
+    // S-and-X performs `popcount - 1` multiplications; the windowed form
+    // performs 7 to build the table of odd powers (plus one squaring for
+    // base**2) and one per window after the first.
+    if (exponent.count_ones() as usize) > num_windows + 8 {
+        // The table of odd powers base**1, base**3, ..., base**15, held on
+        // the stack. `base` itself serves as the first entry.
+        let base2 = try!(elem_squared(try!(base.try_clone()), m));
+        let base3 = try!(elem_mul(&base2, try!(base.try_clone()), m));
+        let base5 = try!(elem_mul(&base2, try!(base3.try_clone()), m));
+        let base7 = try!(elem_mul(&base2, try!(base5.try_clone()), m));
+        let base9 = try!(elem_mul(&base2, try!(base7.try_clone()), m));
+        let base11 = try!(elem_mul(&base2, try!(base9.try_clone()), m));
+        let base13 = try!(elem_mul(&base2, try!(base11.try_clone()), m));
+        let base15 = try!(elem_mul(&base2, try!(base13.try_clone()), m));
+        let odd_powers =
+            [base, base3, base5, base7, base9, base11, base13, base15];
+
+        let mut acc =
+            try!(odd_powers[(window_values[0] >> 1) as usize].try_clone());
+        for k in 1..num_windows {
+            for _ in 0..(window_shifts[k - 1] - window_shifts[k]) {
+                acc = try!(elem_squared(acc, m));
+            }
+            acc = try!(elem_mul(&odd_powers[(window_values[k] >> 1) as usize],
+                                acc, m));
+        }
+        return Ok(acc);
+    }
+
     let mut acc = try!(base.try_clone());
     let mut bit = 1 << (64 - 1 - exponent.leading_zeros());
     debug_assert!((exponent & bit) != 0);
@@ -644,16 +705,43 @@ pub fn elem_exp_vartime<M>(
     Ok(acc)
 }
 
+/// Scratch space for `elem_exp_consttime`.
+///
+/// The window table used by the exponentiation is too large to put on the
+/// stack, so it has to be heap-allocated. Allocating it inside
+/// `elem_exp_consttime` would mean multiple allocations per RSA signature,
+/// which measurably contends the allocator lock in multi-threaded signers.
+/// Instead the caller allocates an `ExpScratch` once and reuses it for every
+/// exponentiation. Scratch space constructed for a modulus may be reused for
+/// any modulus that is no wider.
+#[cfg(feature = "rsa_signing")]
+pub struct ExpScratch {
+    buf: std::vec::Vec<u8>,
+}
+
+#[cfg(feature = "rsa_signing")]
+impl ExpScratch {
+    pub fn new<M>(m: &Modulus<M>) -> ExpScratch {
+        let len = unsafe {
+            GFp_BN_mod_exp_scratch_size(
+                m.value.as_ref().limbs().len() as c::int)
+        };
+        ExpScratch { buf: vec![0u8; len] }
+    }
+}
+
 #[cfg(feature = "rsa_signing")]
 pub fn elem_exp_consttime<M>(
         base: Elem<M, R>, exponent: &OddPositive, oneR: &One<M, R>,
-        m: &Modulus<M>) -> Result<Elem<M, Unencoded>, error::Unspecified> {
+        m: &Modulus<M>, scratch: &mut ExpScratch)
+        -> Result<Elem<M, Unencoded>, error::Unspecified> {
     let mut r = base.value;
     try!(bssl::map_result(unsafe {
-        GFp_BN_mod_exp_mont_consttime(&mut r.0, &r.0, exponent.as_ref(),
-                                      exponent.0.bit_length().as_usize_bits(),
-                                      oneR.0.value.as_ref(), &m.value.as_ref(),
-                                      &m.n0)
+        GFp_BN_mod_exp_mont_consttime_scratch(
+            &mut r.0, &r.0, exponent.as_ref(),
+            exponent.0.bit_length().as_usize_bits(), oneR.0.value.as_ref(),
+            &m.value.as_ref(), &m.n0, scratch.buf.as_mut_ptr(),
+            scratch.buf.len())
     }));
     let r = Elem {
         value: r,
@@ -1084,6 +1172,11 @@ mod repr_c {
 
         #[inline]
         pub fn limbs(&self) -> &[limb::Limb] {
+            // `self.d` is null when the value is zero; don't pass a null
+            // pointer to `from_raw_parts`.
+            if self.top == 0 {
+                return &[];
+            }
             unsafe {
                 core::slice::from_raw_parts(self.d, self.top as usize)
             }
@@ -1091,6 +1184,9 @@ mod repr_c {
 
         #[inline]
         pub fn limbs_mut(&mut self) -> &mut [limb::Limb] {
+            if self.top == 0 {
+                return &mut [];
+            }
             unsafe {
                 core::slice::from_raw_parts_mut(self.d, self.top as usize)
             }
@@ -1170,11 +1266,15 @@ extern {
 
 #[cfg(feature = "rsa_signing")]
 extern {
+    fn GFp_BN_mod_exp_scratch_size(top: c::int) -> c::size_t;
+
     // `r` and `a` may alias.
-    fn GFp_BN_mod_exp_mont_consttime(r: *mut BIGNUM, a_mont: *const BIGNUM,
-                                     p: &BIGNUM, p_bits: c::size_t,
-                                     one_mont: &BIGNUM, n: &BIGNUM,
-                                     n0: &N0) -> c::int;
+    fn GFp_BN_mod_exp_mont_consttime_scratch(r: *mut BIGNUM,
+                                             a_mont: *const BIGNUM, p: &BIGNUM,
+                                             p_bits: c::size_t,
+                                             one_mont: &BIGNUM, n: &BIGNUM,
+                                             n0: &N0, scratch: *mut u8,
+                                             scratch_len: c::size_t) -> c::int;
 
     // `r` and `a` may alias.
     fn LIMBS_add_mod(r: *mut limb::Limb, a: *const limb::Limb,
@@ -1247,7 +1347,9 @@ mod tests {
             let base = into_encoded(base, &m);
             let oneRR = One::newRR(&m).unwrap();
             let one = One::newR(&oneRR, &m).unwrap();
-            let actual_result = elem_exp_consttime(base, &e, &one, &m).unwrap();
+            let mut scratch = ExpScratch::new(&m);
+            let actual_result =
+                elem_exp_consttime(base, &e, &one, &m, &mut scratch).unwrap();
             assert_elem_eq(&actual_result, &expected_result);
 
             Ok(())
@@ -12,7 +12,7 @@
 // OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
 // CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
-use {error, rand};
+use {error, rand, std};
 use core;
 use super::{bigint, N};
 use arithmetic::montgomery::{R, RR};
@@ -30,7 +30,8 @@ impl Blinding {
 
     pub fn blind<F>(&mut self, x: bigint::Elem<N>,
                     e: bigint::PublicExponent, oneRR: &bigint::One<N, RR>,
-                    n: &bigint::Modulus<N>, rng: &rand::SecureRandom, f: F)
+                    n: &bigint::Modulus<N>, rng: &rand::SecureRandom,
+                    pool: Option<&Pool>, f: F)
                     -> Result<bigint::Elem<N>, error::Unspecified>
                     where F: FnOnce(bigint::Elem<N>)
                                     -> Result<bigint::Elem<N>,
@@ -53,15 +54,22 @@ impl Blinding {
                         blinding_factor_inv: blinding_factor_inv,
                         remaining: remaining - 1,
                     })
+                } else if let Some(contents) =
+                        pool.and_then(|pool| pool.take()) {
+                    Ok(contents)
                 } else {
                     reset(blinding_factor, blinding_factor_inv, e, oneRR, n, rng)
                 }
             },
 
             None => {
-                let elem1 = try!(bigint::Elem::zero());
-                let elem2 = try!(bigint::Elem::zero());
-                reset(elem1, elem2, e, oneRR, n, rng)
+                if let Some(contents) = pool.and_then(|pool| pool.take()) {
+                    Ok(contents)
+                } else {
+                    let elem1 = try!(bigint::Elem::zero());
+                    let elem2 = try!(bigint::Elem::zero());
+                    reset(elem1, elem2, e, oneRR, n, rng)
+                }
             },
         });
 
@@ -116,6 +124,54 @@ fn reset(elem1: bigint::Elem<N, R>, elem2: bigint::Elem<N, R>,
 }
 
 
+/// A pool of pre-generated blinding factor pairs.
+///
+/// Generating a replacement blinding pair costs a modular inversion and a
+/// public exponentiation, which `Blinding` otherwise pays on the signing
+/// critical path every `REMAINING_MAX` signatures. A pool lets that work be
+/// done ahead of time (e.g. by a background thread calling `refill`); the
+/// per-signature squaring update stays in the per-state `Blinding` and never
+/// touches the pool's lock.
+///
+/// The pool is only consulted when a `Blinding` is exhausted, and an empty
+/// pool just means the replacement pair is computed inline as before.
+pub struct Pool {
+    contents: std::sync::Mutex<std::vec::Vec<Contents>>,
+}
+
+impl Pool {
+    pub fn new() -> Pool {
+        Pool { contents: std::sync::Mutex::new(std::vec::Vec::new()) }
+    }
+
+    /// Tops the pool up to `target` pre-generated pairs. Each pair is
+    /// generated outside the pool's lock.
+    pub fn refill(&self, target: usize, e: bigint::PublicExponent,
+                  oneRR: &bigint::One<N, RR>, n: &bigint::Modulus<N>,
+                  rng: &rand::SecureRandom)
+                  -> Result<(), error::Unspecified> {
+        while self.len() < target {
+            let elem1 = try!(bigint::Elem::zero());
+            let elem2 = try!(bigint::Elem::zero());
+            let new_contents = try!(reset(elem1, elem2, e, oneRR, n, rng));
+            let mut contents = self.contents.lock().unwrap();
+            if contents.len() >= target {
+                break;
+            }
+            contents.push(new_contents);
+        }
+        Ok(())
+    }
+
+    /// The number of pre-generated pairs currently in the pool.
+    pub fn len(&self) -> usize { self.contents.lock().unwrap().len() }
+
+    fn take(&self) -> Option<Contents> {
+        self.contents.lock().unwrap().pop()
+    }
+}
+
+
 // The paper suggests reusing blinding factors 32 times. Note that this must
 // never be zero.
 // TODO: citation. TODO: Skepticism.
@@ -37,12 +37,18 @@ pub struct RSAKeyPair {
     qq: bigint::Modulus<QQ>,
     q_mod_n: bigint::Elem<N, R>,
     n_bits: bits::BitLength,
+    blinding_pool: blinding::Pool,
 }
 
 // `RSAKeyPair` is immutable. TODO: Make all the elements of `RSAKeyPair`
 // implement `Sync` so that it doesn't have to do this itself.
 unsafe impl Sync for RSAKeyPair {}
 
+// `RSAKeyPair` owns all of its heap allocations and the interior mutability
+// of `blinding_pool` is mediated by a `Mutex`, so a key pair may be moved to
+// (or, per `Sync` above, shared with) another thread.
+unsafe impl Send for RSAKeyPair {}
+
 impl RSAKeyPair {
     /// Parses an unencrypted PKCS#8-encoded RSA private key.
     ///
@@ -383,18 +389,138 @@ impl RSAKeyPair {
                     oneRR_mod_n,
                     q_mod_n,
                     qq,
-                    n_bits
+                    n_bits,
+                    blinding_pool: blinding::Pool::new()
                 })
             })
         })
     }
 
+    /// Parses all of `inputs` as DER-encoded `RSAPrivateKey`s, using up to
+    /// `num_threads` threads (including the calling thread).
+    ///
+    /// Each key gets exactly the same validation and precomputation as
+    /// `from_der()`. The per-key work is dominated by the Montgomery setup
+    /// for the moduli, which is independent across keys, so a server loading
+    /// many tenants' keys at startup can parse them in parallel instead of
+    /// one at a time. The result vector is allocated once, up front. If any
+    /// key fails to parse then the whole batch fails.
+    pub fn from_der_batch(inputs: &[untrusted::Input], num_threads: usize)
+                          -> Result<std::vec::Vec<RSAKeyPair>,
+                                    error::Unspecified> {
+        fn parse_slice(inputs: &[untrusted::Input],
+                       out: &mut [Option<RSAKeyPair>])
+                       -> Result<(), error::Unspecified> {
+            for (input, out) in inputs.iter().zip(out.iter_mut()) {
+                *out = Some(try!(RSAKeyPair::from_der(*input)));
+            }
+            Ok(())
+        }
+
+        let mut parsed = std::vec::Vec::with_capacity(inputs.len());
+        for _ in 0..inputs.len() {
+            parsed.push(None);
+        }
+
+        let num_threads = std::cmp::min(std::cmp::max(num_threads, 1),
+                                        std::cmp::max(inputs.len(), 1));
+        if num_threads == 1 {
+            try!(parse_slice(inputs, &mut parsed));
+        } else {
+            struct Partition {
+                inputs: *const untrusted::Input<'static>,
+                out: *mut Option<RSAKeyPair>,
+                num_keys: usize,
+            }
+
+            // This is safe because the partitions don't overlap, every
+            // thread is joined below before `inputs` and `parsed` go out of
+            // scope, and nothing between the spawns and the joins panics.
+            // The `'static` lifetime is only there to satisfy
+            // `std::thread::spawn`; the joins keep the borrowed inputs alive
+            // for as long as any thread can read them.
+            unsafe impl Send for Partition {}
+
+            fn parse_partition(partition: Partition)
+                               -> Result<(), error::Unspecified> {
+                let inputs = unsafe {
+                    std::slice::from_raw_parts(partition.inputs,
+                                               partition.num_keys)
+                };
+                let out = unsafe {
+                    std::slice::from_raw_parts_mut(partition.out,
+                                                   partition.num_keys)
+                };
+                parse_slice(inputs, out)
+            }
+
+            let keys_per_thread =
+                (inputs.len() + num_threads - 1) / num_threads;
+
+            let mut threads = std::vec::Vec::with_capacity(num_threads - 1);
+            for i in 1..num_threads {
+                let start = std::cmp::min(i * keys_per_thread, inputs.len());
+                let end =
+                    std::cmp::min(start + keys_per_thread, inputs.len());
+                let partition = Partition {
+                    inputs: inputs[start..].as_ptr()
+                        as *const untrusted::Input<'static>,
+                    out: parsed[start..].as_mut_ptr(),
+                    num_keys: end - start,
+                };
+                threads.push(
+                    std::thread::spawn(move || parse_partition(partition)));
+            }
+
+            // The calling thread parses the first partition itself.
+            let first = std::cmp::min(keys_per_thread, inputs.len());
+            let mut result = parse_slice(&inputs[..first],
+                                         &mut parsed[..first]);
+            for thread in threads {
+                let thread_result = thread.join().unwrap();
+                if thread_result.is_err() {
+                    result = thread_result;
+                }
+            }
+            try!(result);
+        }
+
+        let mut keys = std::vec::Vec::with_capacity(parsed.len());
+        for key in parsed {
+            keys.push(try!(key.ok_or(error::Unspecified)));
+        }
+        Ok(keys)
+    }
+
     /// Returns the length in bytes of the key pair's public modulus.
     ///
     /// A signature has the same length as the public modulus.
     pub fn public_modulus_len(&self) -> usize {
         self.n_bits.as_usize_bytes_rounded_up()
     }
+
+    /// Tops the key pair's blinding pool up to `target` pre-generated
+    /// blinding factor pairs.
+    ///
+    /// Every `blinding::REMAINING_MAX`-th signature needs a replacement
+    /// blinding pair, which costs a modular inversion plus a public
+    /// exponentiation; by default that is computed on the signing critical
+    /// path, producing a periodic latency spike. Calling this from a
+    /// background thread moves the computation off the critical path: all
+    /// `RSASigningState`s sharing this key pair take replacement pairs from
+    /// the pool when it is non-empty and only fall back to inline generation
+    /// when it runs dry. The per-signature blinding update itself never
+    /// touches the pool.
+    pub fn refill_blinding_pool(&self, target: usize,
+                                rng: &rand::SecureRandom)
+                                -> Result<(), error::Unspecified> {
+        self.blinding_pool.refill(target, self.e, &self.oneRR_mod_n, &self.n,
+                                  rng)
+    }
+
+    /// The number of pre-generated blinding pairs currently in the key
+    /// pair's blinding pool.
+    pub fn blinding_pool_len(&self) -> usize { self.blinding_pool.len() }
 }
 
 struct PrivatePrime<M: Prime> {
@@ -448,13 +574,70 @@ impl<M: Prime> PrivatePrime<M> {
     }
 }
 
-fn elem_exp_consttime<M, MM>(c: &bigint::Elem<MM>, p: &PrivatePrime<M>)
+fn elem_exp_consttime<M, MM>(c: &bigint::Elem<MM>, p: &PrivatePrime<M>,
+                             scratch: &mut bigint::ExpScratch)
                              -> Result<bigint::Elem<M>, error::Unspecified>
                              where M: bigint::NotMuchSmallerModulus<MM>,
                                    M: Prime {
     let c_mod_m = try!(bigint::elem_reduced(c, &p.modulus));
     let c_mod_m = try!(bigint::elem_mul(p.oneRRR.as_ref(), c_mod_m, &p.modulus));
-    bigint::elem_exp_consttime(c_mod_m, &p.exponent, &p.oneR, &p.modulus)
+    bigint::elem_exp_consttime(c_mod_m, &p.exponent, &p.oneR, &p.modulus,
+                               scratch)
+}
+
+/// Computes the mod-p and mod-q CRT exponentiations concurrently: the mod-q
+/// half runs on a freshly-spawned thread while the calling thread computes
+/// the mod-p half.
+fn elem_exp_consttime_parallel(
+        c: &bigint::Elem<N>, p: &PrivatePrime<P>, q: &PrivatePrime<Q>,
+        qq: &bigint::Modulus<QQ>, scratch_p: &mut bigint::ExpScratch,
+        scratch_q: &mut bigint::ExpScratch)
+        -> Result<(bigint::Elem<P>, bigint::Elem<Q>), error::Unspecified> {
+    let c_mod_qq = try!(bigint::elem_reduced_once(c, qq));
+
+    // The helper thread gets raw pointers to values this frame owns or
+    // borrows: it only reads `c_mod_qq` and `q`, it has exclusive use of
+    // `scratch_q` and `out`, and it is joined below before any of them are
+    // used (or freed) here, so the pointers stay valid for the thread's
+    // lifetime. Nothing between `spawn` and `join` panics, so the thread
+    // can't outlive the borrows.
+    struct QHalf {
+        c_mod_qq: *const bigint::Elem<QQ>,
+        q: *const PrivatePrime<Q>,
+        scratch: *mut bigint::ExpScratch,
+        out: *mut Option<Result<bigint::Elem<Q>, error::Unspecified>>,
+    }
+    unsafe impl Send for QHalf {}
+
+    let mut m_2_out: Option<Result<bigint::Elem<Q>, error::Unspecified>> =
+        None;
+    let q_half = {
+        let task = QHalf {
+            c_mod_qq: &c_mod_qq,
+            q: q,
+            scratch: scratch_q,
+            out: &mut m_2_out,
+        };
+        std::thread::spawn(move || {
+            let result = {
+                let c_mod_qq = unsafe { &*task.c_mod_qq };
+                let q = unsafe { &*task.q };
+                let scratch = unsafe { &mut *task.scratch };
+                elem_exp_consttime(c_mod_qq, q, scratch)
+            };
+            unsafe { *task.out = Some(result); }
+        })
+    };
+
+    let m_1 = elem_exp_consttime(c, p, scratch_p);
+    let joined = q_half.join();
+
+    let m_1 = try!(m_1);
+    if joined.is_err() {
+        return Err(error::Unspecified);
+    }
+    let m_2 = try!(try!(m_2_out.ok_or(error::Unspecified)));
+    Ok((m_1, m_2))
 }
 
 
@@ -520,15 +703,24 @@ unsafe impl bigint::NotMuchSmallerModulus<QQ> for Q {}
 pub struct RSASigningState {
     key_pair: std::sync::Arc<RSAKeyPair>,
     blinding: blinding::Blinding,
+    exp_scratch: bigint::ExpScratch,
+    // Scratch space for the helper thread of `sign_parallel`, created on
+    // first use so that sequential-only users don't pay for it.
+    exp_scratch_q: Option<bigint::ExpScratch>,
 }
 
 impl RSASigningState {
     /// Construct an `RSASigningState` for the given `RSAKeyPair`.
     pub fn new(key_pair: std::sync::Arc<RSAKeyPair>)
                -> Result<Self, error::Unspecified> {
+        // The scratch space is sized for the public modulus, which is wider
+        // than either of the private primes it is actually used with.
+        let exp_scratch = bigint::ExpScratch::new(&key_pair.n);
         Ok(RSASigningState {
             key_pair: key_pair,
             blinding: blinding::Blinding::new(),
+            exp_scratch: exp_scratch,
+            exp_scratch_q: None,
         })
     }
 
@@ -554,11 +746,40 @@ impl RSASigningState {
     /// platforms, it is done less perfectly. To help mitigate the current
     /// imperfections, and for defense-in-depth, base blinding is always done.
     /// Exponent blinding is not done, but it may be done in the future.
-    #[allow(non_shorthand_field_patterns)] // Work around compiler bug.
     pub fn sign(&mut self, padding_alg: &'static ::signature::RSAEncoding,
                 rng: &rand::SecureRandom, msg: &[u8], signature: &mut [u8])
                 -> Result<(), error::Unspecified> {
+        self.sign_impl(padding_alg, rng, msg, signature, false)
+    }
+
+    /// Like `sign`, except that the two CRT exponentiations are performed
+    /// concurrently: the mod-q half runs on a helper thread spawned for the
+    /// call while the calling thread computes the mod-p half. The resulting
+    /// signature is identical to the one `sign` produces.
+    ///
+    /// The two exponentiations dominate the cost of signing, so this cuts
+    /// signing latency nearly in half at the cost of using two cores and
+    /// spawning a thread per call. Use it when per-signature latency matters
+    /// more than total throughput; when all cores are already busy signing,
+    /// `sign` makes better use of them.
+    pub fn sign_parallel(&mut self,
+                         padding_alg: &'static ::signature::RSAEncoding,
+                         rng: &rand::SecureRandom, msg: &[u8],
+                         signature: &mut [u8])
+                         -> Result<(), error::Unspecified> {
+        self.sign_impl(padding_alg, rng, msg, signature, true)
+    }
+
+    #[allow(non_shorthand_field_patterns)] // Work around compiler bug.
+    fn sign_impl(&mut self, padding_alg: &'static ::signature::RSAEncoding,
+                 rng: &rand::SecureRandom, msg: &[u8], signature: &mut [u8],
+                 parallel: bool)
+                 -> Result<(), error::Unspecified> {
         let mod_bits = self.key_pair.n_bits;
+        if parallel && self.exp_scratch_q.is_none() {
+            self.exp_scratch_q =
+                Some(bigint::ExpScratch::new(&self.key_pair.n));
+        }
         if signature.len() != mod_bits.as_usize_bytes_rounded_up() {
             return Err(error::Unspecified);
         }
@@ -566,6 +787,8 @@ impl RSASigningState {
         let &mut RSASigningState {
             key_pair: ref key,
             blinding: ref mut blinding,
+            exp_scratch: ref mut exp_scratch,
+            exp_scratch_q: ref mut exp_scratch_q,
         } = self;
 
         let m_hash = digest::digest(padding_alg.digest_alg(), msg);
@@ -584,11 +807,20 @@ impl RSASigningState {
 
         // Step 2.
         let result = try!(blinding.blind(base, key.e, &key.oneRR_mod_n, &key.n,
-                                         rng, |c| {
+                                         rng, Some(&key.blinding_pool), |c| {
             // Step 2.b.i.
-            let m_1 = try!(elem_exp_consttime(&c, &key.p));
-            let c_mod_qq = try!(bigint::elem_reduced_once(&c, &key.qq));
-            let m_2 = try!(elem_exp_consttime(&c_mod_qq, &key.q));
+            let (m_1, m_2) = if parallel {
+                try!(elem_exp_consttime_parallel(
+                    &c, &key.p, &key.q, &key.qq, exp_scratch,
+                    exp_scratch_q.as_mut().unwrap()))
+            } else {
+                let m_1 = try!(elem_exp_consttime(&c, &key.p, exp_scratch));
+                let c_mod_qq =
+                    try!(bigint::elem_reduced_once(&c, &key.qq));
+                let m_2 =
+                    try!(elem_exp_consttime(&c_mod_qq, &key.q, exp_scratch));
+                (m_1, m_2)
+            };
 
             // Step 2.b.ii isn't needed since there are only two primes.
 
@@ -727,6 +959,91 @@ mod tests {
                                    &mut signature).is_err());
     }
 
+    // PKCS#1 signatures are deterministic (the blinding cancels out), so
+    // `sign_parallel` must produce exactly the same signature as `sign`.
+    #[test]
+    fn test_signature_rsa_pkcs1_sign_parallel() {
+        const MESSAGE: &'static [u8] = b"hello, world";
+        let rng = rand::SystemRandom::new();
+
+        const PRIVATE_KEY_DER: &'static [u8] =
+            include_bytes!("signature_rsa_example_private_key.der");
+        let key_bytes_der = untrusted::Input::from(PRIVATE_KEY_DER);
+        let key_pair = signature::RSAKeyPair::from_der(key_bytes_der).unwrap();
+        let key_pair = std::sync::Arc::new(key_pair);
+        let mut signing_state =
+            signature::RSASigningState::new(key_pair).unwrap();
+
+        let len = signing_state.key_pair().public_modulus_len();
+        let mut sequential = vec![0; len];
+        signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MESSAGE,
+                           &mut sequential).unwrap();
+
+        // Twice, so that both the first (scratch-creating) call and the
+        // scratch-reusing path are exercised.
+        for _ in 0..2 {
+            let mut parallel = vec![0; len];
+            signing_state.sign_parallel(&signature::RSA_PKCS1_SHA256, &rng,
+                                        MESSAGE, &mut parallel).unwrap();
+            assert_eq!(sequential, parallel);
+        }
+    }
+
+    // `from_der_batch` must produce key pairs equivalent to parsing each key
+    // with `from_der`, for every thread count, and must reject the whole
+    // batch when any key in it is malformed.
+    #[test]
+    fn test_signature_rsa_from_der_batch() {
+        const MESSAGE: &'static [u8] = b"hello, world";
+        let rng = rand::SystemRandom::new();
+
+        const PRIVATE_KEY_DER: &'static [u8] =
+            include_bytes!("signature_rsa_example_private_key.der");
+        let key_bytes_der = untrusted::Input::from(PRIVATE_KEY_DER);
+        let key_pair = signature::RSAKeyPair::from_der(key_bytes_der).unwrap();
+        let key_pair = std::sync::Arc::new(key_pair);
+        let mut signing_state =
+            signature::RSASigningState::new(key_pair).unwrap();
+
+        // RSASSA-PKCS1-v1_5 is deterministic, so a signature from a
+        // singly-parsed key is a usable fingerprint of the private key.
+        let len = signing_state.key_pair().public_modulus_len();
+        let mut expected = vec![0; len];
+        signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MESSAGE,
+                           &mut expected).unwrap();
+
+        let inputs = [key_bytes_der, key_bytes_der, key_bytes_der,
+                      key_bytes_der, key_bytes_der];
+        for num_threads in 0..4 {
+            let keys = signature::RSAKeyPair::from_der_batch(&inputs[..],
+                                                             num_threads)
+                .unwrap();
+            assert_eq!(keys.len(), inputs.len());
+            for key_pair in keys {
+                let mut signing_state = signature::RSASigningState::new(
+                    std::sync::Arc::new(key_pair)).unwrap();
+                let mut actual = vec![0; len];
+                signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng,
+                                   MESSAGE, &mut actual).unwrap();
+                assert_eq!(expected, actual);
+            }
+        }
+
+        // A malformed key anywhere in the batch fails the whole batch.
+        let truncated = untrusted::Input::from(&PRIVATE_KEY_DER[..7]);
+        let bad_inputs = [key_bytes_der, truncated, key_bytes_der];
+        for num_threads in 0..4 {
+            assert!(signature::RSAKeyPair::from_der_batch(&bad_inputs[..],
+                                                          num_threads)
+                .is_err());
+        }
+
+        // An empty batch parses to an empty vector.
+        assert!(signature::RSAKeyPair::from_der_batch(&[], 4)
+            .unwrap()
+            .is_empty());
+    }
+
     // Once the `Blinding` in an `RSAKeyPair` has been used
     // `blinding::REMAINING_MAX` times, a new blinding should be created. we
     // don't check that a new blinding was created; we just make sure to
@@ -756,6 +1073,45 @@ mod tests {
         }
     }
 
+    // Pre-generated blinding pairs in the key pair's pool are consumed
+    // whenever a `Blinding` needs a (re)placement pair, and the pool is
+    // never touched by the in-between signatures.
+    #[test]
+    fn test_signature_rsa_pkcs1_sign_blinding_pool() {
+        const MESSAGE: &'static [u8] = b"hello, world";
+        let rng = rand::SystemRandom::new();
+
+        const PRIVATE_KEY_DER: &'static [u8] =
+            include_bytes!("signature_rsa_example_private_key.der");
+        let key_bytes_der = untrusted::Input::from(PRIVATE_KEY_DER);
+        let key_pair = signature::RSAKeyPair::from_der(key_bytes_der).unwrap();
+        let key_pair = std::sync::Arc::new(key_pair);
+
+        key_pair.refill_blinding_pool(3, &rng).unwrap();
+        assert_eq!(key_pair.blinding_pool_len(), 3);
+
+        let mut signature = vec![0; key_pair.public_modulus_len()];
+        let mut signing_state =
+            signature::RSASigningState::new(key_pair.clone()).unwrap();
+
+        // The first signature takes its initial blinding pair from the pool.
+        signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MESSAGE,
+                           &mut signature).unwrap();
+        assert_eq!(key_pair.blinding_pool_len(), 2);
+
+        // The following signatures just square the pair they have.
+        for _ in 0..(blinding::REMAINING_MAX - 1) {
+            signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MESSAGE,
+                               &mut signature).unwrap();
+        }
+        assert_eq!(key_pair.blinding_pool_len(), 2);
+
+        // Exhaustion takes a replacement pair from the pool.
+        signing_state.sign(&signature::RSA_PKCS1_SHA256, &rng, MESSAGE,
+                           &mut signature).unwrap();
+        assert_eq!(key_pair.blinding_pool_len(), 1);
+    }
+
     // When we fail to randomly generate an invertible blinding factor too many
     // times in a loop, we fail. This checks that we fail in a reasonable way
     // when that happens.
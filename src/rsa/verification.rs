@@ -14,7 +14,8 @@
 
 /// RSA PKCS#1 1.5 signatures.
 
-use {bits, digest, error, private, signature};
+use {bits, digest, error, init, private, signature};
+use arithmetic::montgomery::RR;
 use super::{bigint, N, PUBLIC_KEY_PUBLIC_MODULUS_MAX_LEN, RSAParameters,
             parse_public_key};
 use untrusted;
@@ -80,37 +81,63 @@ rsa_params!(RSA_PSS_2048_8192_SHA512, 2048, &super::RSA_PSS_SHA512,
              `ring::signature`'s module-level documentation for more details.");
 
 
-/// Lower-level API for the verification of RSA signatures.
+/// An RSA public key that has been parsed and validated for use with
+/// `params`, with the modulus's Montgomery constants precomputed.
 ///
-/// When the public key is in DER-encoded PKCS#1 ASN.1 format, it is
-/// recommended to use `ring::signature::verify()` with
-/// `ring::signature::RSA_PKCS1_*`, because `ring::signature::verify()`
-/// will handle the parsing in that case. Otherwise, this function can be used
-/// to pass in the raw bytes for the public key components as
-/// `untrusted::Input` arguments.
+/// `signature::verify()` re-parses the public key and recomputes the
+/// Montgomery constants on every call. When many signatures from the same
+/// signer need to be checked, construct an `RSAVerificationKey` once and call
+/// its `verify()` method repeatedly to amortize that fixed per-key cost.
 ///
-/// `params` determine what algorithm parameters (padding, digest algorithm,
-/// key length range, etc.) are used in the verification. `msg` is the message
-/// and `signature` is the signature.
-///
-/// `n` is the public key modulus and `e` is the public key exponent. Both are
-/// interpreted as unsigned big-endian encoded values. Both must be positive
-/// and neither may have any leading zeros.
-//
-// There are a small number of tests that test `verify_rsa` directly, but the
-// test coverage for this function mostly depends on the test coverage for the
-// `signature::VerificationAlgorithm` implementation for `RSAParameters`. If we
-// change that, test coverage for `verify_rsa()` will need to be reconsidered.
-// (The NIST test vectors were originally in a form that was optimized for
-// testing `verify_rsa` directly, but the testing work for RSA PKCS#1
-// verification was done during the implementation of
-// `signature::VerificationAlgorithm`, before `verify_rsa` was factored out).
-pub fn verify_rsa(params: &RSAParameters,
-                  (n, e): (untrusted::Input, untrusted::Input),
-                  msg: untrusted::Input, signature: untrusted::Input)
+/// Only available in `use_heap` mode.
+pub struct RSAVerificationKey {
+    params: &'static RSAParameters,
+    n: bigint::Modulus<N>,
+    e: bigint::PublicExponent,
+    oneRR_mod_n: bigint::One<N, RR>,
+    n_bits: bits::BitLength,
+}
+
+impl RSAVerificationKey {
+    /// Parses a DER-encoded `RSAPublicKey` (see `ring::signature`'s
+    /// module-level documentation for the encoding) and validates it for use
+    /// with `params`.
+    pub fn from_der(params: &'static RSAParameters,
+                    public_key: untrusted::Input)
+                    -> Result<RSAVerificationKey, error::Unspecified> {
+        let (n, e) = try!(parse_public_key(public_key));
+        RSAVerificationKey::from_modulus_and_exponent(params, n, e)
+    }
+
+    /// Like `from_der`, but takes the raw big-endian bytes of the public key
+    /// components directly, as `verify_rsa` does. `n` is the public key
+    /// modulus and `e` is the public key exponent. Both must be positive and
+    /// neither may have any leading zeros.
+    pub fn from_modulus_and_exponent(params: &'static RSAParameters,
+                                     n: untrusted::Input, e: untrusted::Input)
+                                     -> Result<RSAVerificationKey,
+                                               error::Unspecified> {
+        init::init_once();
+        let (n, e, oneRR_mod_n, n_bits) = try!(check_public_key(params, n, e));
+        Ok(RSAVerificationKey { params, n, e, oneRR_mod_n, n_bits })
+    }
+
+    /// Verifies the signature `signature` of message `msg`.
+    pub fn verify(&self, msg: untrusted::Input, signature: untrusted::Input)
                   -> Result<(), error::Unspecified> {
-    // Partially validate the public key. See
-    // `check_public_modulus_and_exponent()` for more details.
+        verify_rsavp1(self.params, &self.n, self.e, &self.oneRR_mod_n,
+                      self.n_bits, msg, signature)
+    }
+}
+
+// Partially validate the public key and precompute the values needed by
+// `verify_rsavp1`. See `check_public_modulus_and_exponent()` for more details
+// on the validation.
+fn check_public_key(params: &RSAParameters, n: untrusted::Input,
+                    e: untrusted::Input)
+                    -> Result<(bigint::Modulus<N>, bigint::PublicExponent,
+                               bigint::One<N, RR>, bits::BitLength),
+                              error::Unspecified> {
     let n = try!(bigint::Positive::from_be_bytes(n));
     let e = try!(bigint::Positive::from_be_bytes(e));
     let max_bits = try!(bits::BitLength::from_usize_bytes(
@@ -127,26 +154,29 @@ pub fn verify_rsa(params: &RSAParameters,
                                                       max_bits, e_min_bits));
     let n_bits = n.bit_length();
     let n = try!(n.into_modulus::<N>());
+    let oneRR_mod_n = try!(bigint::One::newRR(&n));
+    Ok((n, e, oneRR_mod_n, n_bits))
+}
 
+// RFC 8017 Section 5.2.2: RSAVP1, plus the padding check.
+fn verify_rsavp1(params: &RSAParameters, n: &bigint::Modulus<N>,
+                 e: bigint::PublicExponent,
+                 oneRR_mod_n: &bigint::One<N, RR>, n_bits: bits::BitLength,
+                 msg: untrusted::Input, signature: untrusted::Input)
+                 -> Result<(), error::Unspecified> {
     // The signature must be the same length as the modulus, in bytes.
     if signature.len() != n_bits.as_usize_bytes_rounded_up() {
         return Err(error::Unspecified);
     }
 
-    // RFC 8017 Section 5.2.2: RSAVP1.
-
     // Step 1.
     let s = try!(bigint::Positive::from_be_bytes_padded(signature));
-    let s = try!(s.into_elem::<N>(&n));
+    let s = try!(s.into_elem::<N>(n));
 
-    // Step 2.
-    let s = {
-        // Montgomery encode `s`.
-        let oneRR = try!(bigint::One::newRR(&n));
-        try!(bigint::elem_mul(oneRR.as_ref(), s, &n))
-    };
-    let m = try!(bigint::elem_exp_vartime(s, e, &n));
-    let m = try!(m.into_unencoded(&n));
+    // Step 2. Montgomery encode `s`, then exponentiate.
+    let s = try!(bigint::elem_mul(oneRR_mod_n.as_ref(), s, n));
+    let m = try!(bigint::elem_exp_vartime(s, e, n));
+    let m = try!(m.into_unencoded(n));
 
     // Step 3.
     let mut decoded = [0u8; PUBLIC_KEY_PUBLIC_MODULUS_MAX_LEN];
@@ -161,6 +191,40 @@ pub fn verify_rsa(params: &RSAParameters,
 }
 
 
+/// Lower-level API for the verification of RSA signatures.
+///
+/// When the public key is in DER-encoded PKCS#1 ASN.1 format, it is
+/// recommended to use `ring::signature::verify()` with
+/// `ring::signature::RSA_PKCS1_*`, because `ring::signature::verify()`
+/// will handle the parsing in that case. Otherwise, this function can be used
+/// to pass in the raw bytes for the public key components as
+/// `untrusted::Input` arguments.
+///
+/// `params` determine what algorithm parameters (padding, digest algorithm,
+/// key length range, etc.) are used in the verification. `msg` is the message
+/// and `signature` is the signature.
+///
+/// `n` is the public key modulus and `e` is the public key exponent. Both are
+/// interpreted as unsigned big-endian encoded values. Both must be positive
+/// and neither may have any leading zeros.
+//
+// There are a small number of tests that test `verify_rsa` directly, but the
+// test coverage for this function mostly depends on the test coverage for the
+// `signature::VerificationAlgorithm` implementation for `RSAParameters`. If we
+// change that, test coverage for `verify_rsa()` will need to be reconsidered.
+// (The NIST test vectors were originally in a form that was optimized for
+// testing `verify_rsa` directly, but the testing work for RSA PKCS#1
+// verification was done during the implementation of
+// `signature::VerificationAlgorithm`, before `verify_rsa` was factored out).
+pub fn verify_rsa(params: &RSAParameters,
+                  (n, e): (untrusted::Input, untrusted::Input),
+                  msg: untrusted::Input, signature: untrusted::Input)
+                  -> Result<(), error::Unspecified> {
+    let (n, e, oneRR_mod_n, n_bits) = try!(check_public_key(params, n, e));
+    verify_rsavp1(params, &n, e, &oneRR_mod_n, n_bits, msg, signature)
+}
+
+
 #[cfg(test)]
 mod tests {
     // We intentionally avoid `use super::*` so that we are sure to use only
@@ -257,6 +321,47 @@ mod tests {
         });
     }
 
+    // Run the PKCS#1 verification test vectors through `RSAVerificationKey`,
+    // verifying twice per key to check that the precomputed state is
+    // reusable.
+    #[test]
+    fn test_signature_rsa_pkcs1_verify_preparsed_key() {
+        test::from_file("src/rsa/rsa_pkcs1_verify_tests.txt",
+                        |section, test_case| {
+            assert_eq!(section, "");
+
+            let digest_name = test_case.consume_string("Digest");
+            let alg = match digest_name.as_ref() {
+                "SHA1" => &signature::RSA_PKCS1_2048_8192_SHA1,
+                "SHA256" => &signature::RSA_PKCS1_2048_8192_SHA256,
+                "SHA384" => &signature::RSA_PKCS1_2048_8192_SHA384,
+                "SHA512" => &signature::RSA_PKCS1_2048_8192_SHA512,
+                _ =>  { panic!("Unsupported digest: {}", digest_name) }
+            };
+
+            let public_key = test_case.consume_bytes("Key");
+            let public_key = untrusted::Input::from(&public_key);
+
+            let msg = test_case.consume_bytes("Msg");
+            let msg = untrusted::Input::from(&msg);
+
+            let sig = test_case.consume_bytes("Sig");
+            let sig = untrusted::Input::from(&sig);
+
+            let expected_result = test_case.consume_string("Result");
+
+            let actual_result =
+                signature::RSAVerificationKey::from_der(alg, public_key)
+                    .and_then(|key| {
+                        try!(key.verify(msg, sig));
+                        key.verify(msg, sig)
+                    });
+            assert_eq!(actual_result.is_ok(), expected_result == "P");
+
+            Ok(())
+        });
+    }
+
     // Test for `primitive::verify()`. Read public key parts from a file
     // and use them to verify a signature.
     #[test]
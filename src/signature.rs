@@ -23,6 +23,11 @@
 //! algorithm that identifies the algorithm. See the documentation for `verify`
 //! for examples.
 //!
+//! When many RSA signatures from the same signer need to be verified,
+//! `RSAVerificationKey` can be used to parse the public key and precompute
+//! the modulus's Montgomery constants once, instead of on every call to
+//! `verify`.
+//!
 //! For signature verification, this API treats each combination of parameters
 //! as a separate algorithm. For example, instead of having a single "RSA"
 //! algorithm with a verification function that takes a bunch of parameters,
@@ -259,11 +264,12 @@
 //! ```
 
 
-use {error, init, private};
+use {core, error, init, private, std};
 use untrusted;
 
 pub use ec::suite_b::ecdsa::{
     ECDSAParameters,
+    ECDSAVerificationKey,
 
     ECDSA_P256_SHA256_ASN1, ECDSA_P256_SHA256_FIXED,
     ECDSA_P256_SHA384_ASN1,
@@ -281,6 +287,8 @@ pub use ec::curve25519::ed25519::{
     Ed25519KeyPairBytes
 };
 
+pub use ec::curve25519::ed25519::verify_batch as ed25519_verify_batch;
+
 #[cfg(all(feature = "rsa_signing", feature = "use_heap"))]
 pub use rsa::signing::{RSAKeyPair, RSASigningState};
 
@@ -306,6 +314,8 @@ pub use rsa::RSAParameters;
 
 #[cfg(feature = "use_heap")]
 pub use rsa::verification::{
+    RSAVerificationKey,
+
     RSA_PKCS1_2048_8192_SHA1,
     RSA_PKCS1_2048_8192_SHA256,
     RSA_PKCS1_2048_8192_SHA384,
@@ -385,9 +395,205 @@ pub fn verify(alg: &VerificationAlgorithm, public_key: untrusted::Input,
     alg.verify(public_key, msg, signature)
 }
 
+/// Verify a batch of independent signatures, using up to `num_threads`
+/// threads.
+///
+/// Each element of `batch` is a `(public_key, msg, signature)` triple that is
+/// verified exactly as `verify` would verify it, using the algorithm `alg`.
+/// `Ok(())` is returned only when every entry in the batch is valid;
+/// otherwise `Err(error::Unspecified)` is returned, with no indication of
+/// which entries failed.
+///
+/// The entries are verified independently, so the batch is simply partitioned
+/// evenly across the threads; with `num_threads <= 1`, or a batch of at most
+/// one entry, this is equivalent to calling `verify` in a loop.
+pub fn verify_batch(alg: &'static VerificationAlgorithm,
+                    batch: &[(untrusted::Input, untrusted::Input,
+                              untrusted::Input)],
+                    num_threads: usize) -> Result<(), error::Unspecified> {
+    init::init_once();
+
+    let num_threads = core::cmp::min(core::cmp::max(num_threads, 1),
+                                     core::cmp::max(batch.len(), 1));
+    if num_threads == 1 {
+        for &(public_key, msg, signature) in batch {
+            try!(alg.verify(public_key, msg, signature));
+        }
+        return Ok(());
+    }
+
+    // `untrusted::Input` borrows from the caller, which keeps it from
+    // crossing the `'static` bound that `std::thread::spawn` puts on its
+    // closure, so each entry is passed to the worker threads as raw parts
+    // and reconstituted there.
+    struct Entry {
+        public_key: *const u8,
+        public_key_len: usize,
+        msg: *const u8,
+        msg_len: usize,
+        signature: *const u8,
+        signature_len: usize,
+    }
+
+    struct Partition {
+        alg: &'static VerificationAlgorithm,
+        entries: *const Entry,
+        num_entries: usize,
+    }
+
+    unsafe impl Send for Partition {}
+
+    fn verify_partition(partition: Partition)
+                        -> Result<(), error::Unspecified> {
+        let entries = unsafe {
+            core::slice::from_raw_parts(partition.entries,
+                                        partition.num_entries)
+        };
+        for entry in entries {
+            let public_key = untrusted::Input::from(unsafe {
+                core::slice::from_raw_parts(entry.public_key,
+                                            entry.public_key_len)
+            });
+            let msg = untrusted::Input::from(unsafe {
+                core::slice::from_raw_parts(entry.msg, entry.msg_len)
+            });
+            let signature = untrusted::Input::from(unsafe {
+                core::slice::from_raw_parts(entry.signature,
+                                            entry.signature_len)
+            });
+            try!(partition.alg.verify(public_key, msg, signature));
+        }
+        Ok(())
+    }
+
+    let entries: std::vec::Vec<Entry> =
+        batch.iter().map(|&(public_key, msg, signature)| {
+            let public_key = public_key.as_slice_less_safe();
+            let msg = msg.as_slice_less_safe();
+            let signature = signature.as_slice_less_safe();
+            Entry {
+                public_key: public_key.as_ptr(),
+                public_key_len: public_key.len(),
+                msg: msg.as_ptr(),
+                msg_len: msg.len(),
+                signature: signature.as_ptr(),
+                signature_len: signature.len(),
+            }
+        }).collect();
+
+    let entries_per_thread =
+        (entries.len() + num_threads - 1) / num_threads;
+
+    let mut threads = std::vec::Vec::with_capacity(num_threads - 1);
+    for i in 1..num_threads {
+        let start = core::cmp::min(i * entries_per_thread, entries.len());
+        let end =
+            core::cmp::min(start + entries_per_thread, entries.len());
+        let partition = Partition {
+            alg: alg,
+            entries: entries[start..].as_ptr(),
+            num_entries: end - start,
+        };
+        // Safety: every thread is joined below before `entries` goes out of
+        // scope, and nothing between the spawns and the joins panics.
+        threads.push(std::thread::spawn(move || verify_partition(partition)));
+    }
+
+    // The calling thread takes the first partition.
+    let mut result = verify_partition(Partition {
+        alg: alg,
+        entries: entries.as_ptr(),
+        num_entries: core::cmp::min(entries_per_thread, entries.len()),
+    });
+
+    for thread in threads {
+        let thread_result = thread.join().unwrap();
+        if thread_result.is_err() {
+            result = thread_result;
+        }
+    }
+
+    result
+}
+
 
 #[cfg(test)]
 mod tests {
     // ECDSA tests are in crypto/ec/ecdsa.rs.
     // EdDSA tests are in crypto/ec/eddsa.rs.
+
+    use {signature, std, test};
+    use untrusted;
+
+    #[test]
+    fn test_verify_batch() {
+        let pub_key_1 =
+            test::from_hex("04e424dc61d4bb3cb7ef4344a7f8957a0c5134e16f7a67c074\
+                            f82e6e12f49abf3c970eed7aa2bc48651545949de1dddaf012\
+                            7e5965ac85d1243d6f60e7dfaee927").unwrap();
+        let msg_1 =
+            test::from_hex("e1130af6a38ccb412a9c8d13e15dbfc9e69a16385af3c3f1e5\
+                            da954fd5e7c45fd75e2b8c36699228e92840c0562fbf3772f0\
+                            7e17f1add56588dd45f7450e1217ad239922dd9c32695dc71f\
+                            f2424ca0dec1321aa47064a044b7fe3c2b97d03ce470a59230\
+                            4c5ef21eed9f93da56bb232d1eeb0035f9bf0dfafdcc460627\
+                            2b20a3").unwrap();
+        let sig_1 =
+            test::from_hex("3045022100bf96b99aa49c705c910be33142017c642ff540c7\
+                            6349b9dab72f981fd9347f4f022017c55095819089c2e03b9c\
+                            d415abdf12444e323075d98f31920b9e0f57ec871c")
+                           .unwrap();
+
+        let pub_key_2 =
+            test::from_hex("04e0fc6a6f50e1c57475673ee54e3a57f9a49f3328e743bf52\
+                            f335e3eeaa3d28647f59d689c91e463607d9194d99faf316e2\
+                            5432870816dde63f5d4b373f12f22a").unwrap();
+        let msg_2 =
+            test::from_hex("73c5f6a67456ae48209b5f85d1e7de7758bf235300c6ae2bdc\
+                            eb1dcb27a7730fb68c950b7fcada0ecc4661d3578230f225a8\
+                            75e69aaa17f1e71c6be5c831f22663bac63d0c7a9635edb004\
+                            3ff8c6f26470f02a7bc56556f1437f06dfa27b487a6c4290d8\
+                            bad38d4879b334e341ba092dde4e4ae694a9c09302e2dbf443\
+                            581c08").unwrap();
+        let sig_2 =
+            test::from_hex("304502201d75830cd36f4c9aa181b2c4221e87f176b7f05b7c\
+                            87824e82e396c88315c407022100cb2acb01dac96efc53a32d\
+                            4a0d85d0c2e48955214783ecf50a4f0414a319c05a")
+                           .unwrap();
+
+        let mut batch = std::vec::Vec::new();
+        for i in 0..7 {
+            if i % 2 == 0 {
+                batch.push((untrusted::Input::from(&pub_key_1),
+                            untrusted::Input::from(&msg_1),
+                            untrusted::Input::from(&sig_1)));
+            } else {
+                batch.push((untrusted::Input::from(&pub_key_2),
+                            untrusted::Input::from(&msg_2),
+                            untrusted::Input::from(&sig_2)));
+            }
+        }
+
+        for num_threads in 0..5 {
+            assert!(signature::verify_batch(
+                &signature::ECDSA_P256_SHA256_ASN1, &batch,
+                num_threads).is_ok());
+        }
+
+        assert!(signature::verify_batch(&signature::ECDSA_P256_SHA256_ASN1,
+                                        &[], 3).is_ok());
+
+        // One bad entry anywhere fails the whole batch.
+        let mut bad_sig = sig_2.clone();
+        let bad_sig_last = bad_sig.len() - 1;
+        bad_sig[bad_sig_last] ^= 1;
+        batch[5] = (untrusted::Input::from(&pub_key_2),
+                    untrusted::Input::from(&msg_2),
+                    untrusted::Input::from(&bad_sig));
+        for num_threads in 0..5 {
+            assert!(signature::verify_batch(
+                &signature::ECDSA_P256_SHA256_ASN1, &batch,
+                num_threads).is_err());
+        }
+    }
 }